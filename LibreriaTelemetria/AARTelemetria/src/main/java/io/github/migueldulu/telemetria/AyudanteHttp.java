@@ -8,13 +8,32 @@ import android.os.Looper;
 import android.util.Log;
 
 // Small HTTP helper used from native code via JNI.
-// It exposes a single static entry point (makeRequest) that performs
-// an HTTP request with HttpURLConnection and returns the raw response
+// makeRequest performs an HTTP request with HttpURLConnection and returns the raw response
 // bytes. If called on the main thread, it offloads the work to a
 // background executor to avoid NetworkOnMainThreadException.
+// makeRequestResult / makeRequestAsync are the entry points used by the native uploader: they only
+// report a small result (status, Retry-After, byte counts) and drop the response body unless debug is on.
 public class AyudanteHttp {
 
-    // Main entry point called from C++ (via AndroidUploader).
+    // Layout of the long[] returned by makeRequestResult (also the arguments of nativeOnRequestComplete).
+    public static final int RESULT_STATUS = 0;          // HTTP status code, -1 if no response was received
+    public static final int RESULT_RETRY_AFTER = 1;     // Retry-After header in seconds, 0 if missing
+    public static final int RESULT_BYTES_SENT = 2;      // request body bytes written
+    public static final int RESULT_BYTES_RECEIVED = 3;  // response body bytes read
+    private static final int RESULT_SIZE = 4;
+
+    // Executor used by makeRequestAsync. Two threads so a slow request does not hold the next one.
+    private static final ExecutorService ASYNC = Executors.newFixedThreadPool(2, r -> {
+        Thread t = new Thread(r, "telemetria-http");
+        t.setDaemon(true);
+        return t;
+    });
+
+    // Implemented in native code (JniHttpTransport.cpp), same fields as the makeRequestResult array.
+    private static native void nativeOnRequestComplete(long requestId, int status, int retryAfterSec,
+                                                       long bytesSent, long bytesReceived);
+
+    // Main entry point called from C++ (via JniHttpTransport).
     // - method: HTTP method ("GET", "POST", etc).
     // - url: full URL as a String.
     // - body: request body as bytes (for example JSON).
@@ -29,6 +48,44 @@ public class AyudanteHttp {
         }
     }
 
+    // Blocking entry point used by the native uploader. Returns the result array described above
+    // instead of the response body. The body is only read to count it (and logged if debug is true).
+    public static long[] makeRequestResult(String method, String url, byte[] body, Map<String,String> headers,
+                                           boolean debug) {
+        if (Looper.getMainLooper() == Looper.myLooper()) {
+            ExecutorService ex = Executors.newSingleThreadExecutor();
+            Future<long[]> fut = ex.submit(() -> doRequestResult(method, url, body, headers, debug));
+            try {
+                return fut.get(60, TimeUnit.SECONDS);
+            } catch (Exception e) {
+                Log.e("telemetria", "Worker exception", e);
+                return newResult();
+            } finally {
+                ex.shutdownNow();
+            }
+        }
+        return doRequestResult(method, url, body, headers, debug);
+    }
+
+    // Asynchronous entry point called from C++. Queues the request and returns immediately:
+    // true if it was accepted (nativeOnRequestComplete will be called exactly once with requestId),
+    // false if it could not be queued (nothing will be called back).
+    public static boolean makeRequestAsync(final long requestId, final String method, final String url,
+                                           final byte[] body, final Map<String,String> headers,
+                                           final boolean debug) {
+        try {
+            ASYNC.execute(() -> {
+                long[] r = doRequestResult(method, url, body, headers, debug);
+                nativeOnRequestComplete(requestId, (int) r[RESULT_STATUS], (int) r[RESULT_RETRY_AFTER],
+                        r[RESULT_BYTES_SENT], r[RESULT_BYTES_RECEIVED]);
+            });
+            return true;
+        } catch (RejectedExecutionException e) {
+            Log.e("telemetria", "makeRequestAsync rejected", e);
+            return false;
+        }
+    }
+
     // Runs doRequest(...) on a background executor.
     // This is used when makeRequest is invoked on the main thread, so that
     // we do not perform network input/output on the UserInterface thread.
@@ -49,40 +106,10 @@ public class AyudanteHttp {
     // Performs the actual HTTP request using HttpURLConnection. If the HTTP
     // status code is not in the 2xx range, it appends a trailing line "HTTP_STATUS:<code>" to the response body.
     private static byte[] doRequest(String method, String url, byte[] body, Map<String,String> headers) {
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
         try {
-            HttpURLConnection conn = (HttpURLConnection) new URL(url).openConnection();
-            conn.setRequestMethod(method);
-            conn.setConnectTimeout(15000);
-            conn.setReadTimeout(30000);
-            conn.setUseCaches(false);
-            conn.setDoInput(true);
-
-            // Apply all provided headers to the request.
-            if (headers != null) {
-                for (Map.Entry<String,String> e : headers.entrySet()) {
-                    conn.setRequestProperty(e.getKey(), e.getValue());
-                }
-            }
-            // If a request body is provided, write it to the output stream.
-            if (body != null && body.length > 0) {
-                conn.setDoOutput(true);
-                try (OutputStream os = conn.getOutputStream()) { os.write(body); }
-            }
-            // Perform the request and obtain the HTTP status code.
-            int code = conn.getResponseCode();
-            // For 2xx codes, use getInputStream(); otherwise, use getErrorStream()
-            InputStream is = (code >= 200 && code < 300) ? conn.getInputStream() : conn.getErrorStream();
-            ByteArrayOutputStream bos = new ByteArrayOutputStream();
-            if (is != null) {
-                try {
-                    byte[] buf = new byte[8192];
-                    int n;
-                    // Read the response body into memory.
-                    while ((n = is.read(buf)) > 0) bos.write(buf, 0, n);
-                } finally {
-                    try { is.close(); } catch (IOException ignore) {}
-                }
-            }
+            long[] r = execute(method, url, body, headers, bos);
+            int code = (int) r[RESULT_STATUS];
             // If the HTTP status is not 2xx, append an indicator line at the end
             if (code < 200 || code >= 300) {
                 bos.write(("\nHTTP_STATUS:" + code).getBytes());
@@ -94,6 +121,91 @@ public class AyudanteHttp {
         }
     }
 
+    // Request used by makeRequestResult / makeRequestAsync: never throws, status stays -1 on exceptions.
+    private static long[] doRequestResult(String method, String url, byte[] body, Map<String,String> headers,
+                                          boolean debug) {
+        ByteArrayOutputStream bos = debug ? new ByteArrayOutputStream() : null;
+        try {
+            long[] r = execute(method, url, body, headers, bos);
+            if (debug) {
+                String resp = bos.toString("UTF-8");
+                Log.i("telemetria", "HTTP " + r[RESULT_STATUS] + " response preview: "
+                        + (resp.length() > 200 ? resp.substring(0, 200) : resp));
+            }
+            return r;
+        } catch (Exception ex) {
+            Log.e("telemetria", "AyudanteHttp exception", ex);
+            long[] r = newResult();
+            r[RESULT_BYTES_SENT] = body != null ? body.length : 0;
+            return r;
+        }
+    }
+
+    // Shared HttpURLConnection code. The response body is copied into sink if it is not null, otherwise it
+    // is read and discarded (the stream must be consumed so the connection can be reused).
+    private static long[] execute(String method, String url, byte[] body, Map<String,String> headers,
+                                  OutputStream sink) throws IOException {
+        long[] result = newResult();
+        HttpURLConnection conn = (HttpURLConnection) new URL(url).openConnection();
+        conn.setRequestMethod(method);
+        conn.setConnectTimeout(15000);
+        conn.setReadTimeout(30000);
+        conn.setUseCaches(false);
+        conn.setDoInput(true);
+
+        // Apply all provided headers to the request.
+        if (headers != null) {
+            for (Map.Entry<String,String> e : headers.entrySet()) {
+                conn.setRequestProperty(e.getKey(), e.getValue());
+            }
+        }
+        // If a request body is provided, write it to the output stream.
+        if (body != null && body.length > 0) {
+            conn.setDoOutput(true);
+            conn.setFixedLengthStreamingMode(body.length);
+            try (OutputStream os = conn.getOutputStream()) { os.write(body); }
+            result[RESULT_BYTES_SENT] = body.length;
+        }
+        // Perform the request and obtain the HTTP status code.
+        int code = conn.getResponseCode();
+        result[RESULT_STATUS] = code;
+        result[RESULT_RETRY_AFTER] = parseRetryAfter(conn.getHeaderField("Retry-After"));
+        // For 2xx codes, use getInputStream(); otherwise, use getErrorStream()
+        InputStream is = (code >= 200 && code < 300) ? conn.getInputStream() : conn.getErrorStream();
+        if (is != null) {
+            try {
+                byte[] buf = new byte[8192];
+                int n;
+                long total = 0;
+                // Read the response body (into sink only if someone wants it).
+                while ((n = is.read(buf)) > 0) {
+                    total += n;
+                    if (sink != null) sink.write(buf, 0, n);
+                }
+                result[RESULT_BYTES_RECEIVED] = total;
+            } finally {
+                try { is.close(); } catch (IOException ignore) {}
+            }
+        }
+        return result;
+    }
+
+    private static long[] newResult() {
+        long[] r = new long[RESULT_SIZE];
+        r[RESULT_STATUS] = -1;
+        return r;
+    }
+
+    // Retry-After in seconds (the HTTP-date form is not used by Supabase/PostgREST, treated as missing).
+    private static long parseRetryAfter(String value) {
+        if (value == null) return 0;
+        try {
+            return Math.max(0, Long.parseLong(value.trim()));
+        } catch (NumberFormatException e) {
+            return 0;
+        }
+    }
+
     // Converts an Exception into a small JSON error object:
     private static byte[] errorBytes(Exception ex) {
         String msg = "{\"error\":\"" + ex.getClass().getSimpleName() + "\",\"msg\":\"" +
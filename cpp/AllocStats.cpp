@@ -0,0 +1,119 @@
+#include "AllocStats.h"
+
+#ifdef TELEMETRIA_ALLOC_STATS
+#include "TelemetriaLog.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Counting replacements of the global allocation functions. They are linked into the library, so they count
+// the allocations of the library (and of any other code the dynamic linker binds to them).
+namespace {
+    struct Counter {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> bytes{0};
+    };
+    Counter g_tags[kAllocTagCount];
+    std::atomic<uint64_t> g_checked{0};
+    std::atomic<uint64_t> g_violations{0};
+
+    // Plain thread locals: no constructor, safe to use from operator new at any point of a thread's life
+    thread_local int t_tag = kAllocUntagged;
+    thread_local uint64_t t_count = 0;
+
+    inline void account(size_t size) {
+        ++t_count;
+        Counter& c = g_tags[t_tag];
+        c.count.fetch_add(1, std::memory_order_relaxed);
+        c.bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    void* allocate(size_t size) {
+        account(size);
+        void* p = std::malloc(size ? size : 1);
+        if (!p) std::abort(); // built without exceptions: no bad_alloc
+        return p;
+    }
+
+    void* allocateAligned(size_t size, size_t align) {
+        account(size);
+        void* p = nullptr;
+        if (posix_memalign(&p, align < sizeof(void*) ? sizeof(void*) : align, size ? size : 1) != 0) std::abort();
+        return p;
+    }
+
+    void read(const Counter& c, TelemetryAllocPlain& out) {
+        out.count = c.count.load(std::memory_order_relaxed);
+        out.bytes = c.bytes.load(std::memory_order_relaxed);
+    }
+}
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    account(size);
+    return std::malloc(size ? size : 1);
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    account(size);
+    return std::malloc(size ? size : 1);
+}
+void* operator new(size_t size, std::align_val_t align) { return allocateAligned(size, (size_t)align); }
+void* operator new[](size_t size, std::align_val_t align) { return allocateAligned(size, (size_t)align); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+
+uint64_t AllocStats::threadAllocations() {
+    return t_count;
+}
+
+void AllocStats::snapshot(TelemetryAllocStatsPlain& out) {
+    out.enabled = 1;
+    read(g_tags[kAllocRecordFrame], out.recordFrame);
+    read(g_tags[kAllocSerialize], out.serialize);
+    read(g_tags[kAllocUpload], out.upload);
+    read(g_tags[kAllocC3D], out.c3d);
+    read(g_tags[kAllocUntagged], out.untagged);
+    out.recordFrameChecked = g_checked.load(std::memory_order_relaxed);
+    out.recordFrameAllocating = g_violations.load(std::memory_order_relaxed);
+}
+
+void AllocStats::reset() {
+    for (Counter& c : g_tags) {
+        c.count.store(0, std::memory_order_relaxed);
+        c.bytes.store(0, std::memory_order_relaxed);
+    }
+    g_checked.store(0, std::memory_order_relaxed);
+    g_violations.store(0, std::memory_order_relaxed);
+}
+
+AllocScope::AllocScope(AllocTag tag) : previous_(t_tag) {
+    t_tag = tag;
+}
+
+AllocScope::~AllocScope() {
+    t_tag = previous_;
+}
+
+NoAllocCheck::NoAllocCheck(const char* name, bool check) : name_(name), check_(check), start_(t_count) {}
+
+NoAllocCheck::~NoAllocCheck() {
+    if (!check_) return;
+    g_checked.fetch_add(1, std::memory_order_relaxed);
+    const uint64_t n = t_count - start_;
+    if (n > 0) {
+        g_violations.fetch_add(1, std::memory_order_relaxed);
+        LOGW("AllocStats: %s allocated %llu time(s) in steady state", name_, (unsigned long long)n);
+    }
+}
+
+#endif // TELEMETRIA_ALLOC_STATS
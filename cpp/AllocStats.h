@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+#include "TiposTelemetria.h"
+
+// Heap allocation accounting, compiled in with the TELEMETRIA_ALLOC_STATS CMake option (debug and soak
+// builds only). It replaces the global operator new / delete of the library with counting versions:
+// every allocation is added to the calling thread and to the stage of the innermost AllocScope on that
+// thread (untagged outside of any scope).
+//
+// NoAllocCheck turns that into an assertion: a scope that must not allocate once the pipeline is warm
+// (telemetry_record_frame). Violations are counted and logged, and telemetry_get_alloc_stats reports them.
+// RecordFrameAllocTest (ctest, its own copy of the library built with the option) and telemetria_soak fail when
+// there is any, so a regression is caught before it reaches the headset.
+//
+// Without the option every class here is empty and inline, there is no cost.
+
+enum AllocTag : int {
+    kAllocUntagged = 0,
+    kAllocRecordFrame,
+    kAllocSerialize,
+    kAllocUpload,
+    kAllocC3D,
+    kAllocTagCount
+};
+
+#ifdef TELEMETRIA_ALLOC_STATS
+
+class AllocStats {
+public:
+    static constexpr bool kEnabled = true;
+
+    // Allocations done so far by the calling thread.
+    static uint64_t threadAllocations();
+    // Fills out (per stage counters and the record frame check).
+    static void snapshot(TelemetryAllocStatsPlain& out);
+    static void reset();
+};
+
+// Tags the allocations of the calling thread while alive (nestable, the innermost wins).
+class AllocScope {
+public:
+    explicit AllocScope(AllocTag tag);
+    ~AllocScope();
+
+    AllocScope(const AllocScope&) = delete;
+    AllocScope& operator=(const AllocScope&) = delete;
+
+private:
+    int previous_;
+};
+
+// Checks that the calling thread does not allocate while alive; check = false skips it (warm-up).
+// name identifies the scope in the log.
+class NoAllocCheck {
+public:
+    NoAllocCheck(const char* name, bool check);
+    ~NoAllocCheck();
+
+    NoAllocCheck(const NoAllocCheck&) = delete;
+    NoAllocCheck& operator=(const NoAllocCheck&) = delete;
+
+private:
+    const char* name_;
+    bool check_;
+    uint64_t start_;
+};
+
+#else
+
+class AllocStats {
+public:
+    static constexpr bool kEnabled = false;
+
+    static uint64_t threadAllocations() { return 0; }
+    static void snapshot(TelemetryAllocStatsPlain&) {}
+    static void reset() {}
+};
+
+class AllocScope {
+public:
+    explicit AllocScope(AllocTag) {}
+};
+
+class NoAllocCheck {
+public:
+    NoAllocCheck(const char*, bool) {}
+};
+
+#endif
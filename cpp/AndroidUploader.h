@@ -1,50 +1,73 @@
 #pragma once
+#ifdef __ANDROID__
 #include <jni.h>
+#endif
 #include <string>
 #include <vector>
+#include <memory>
+#include <functional>
 #include "TiposTelemetria.h"
+#include "UploadTransport.h"
 
-// Uploader that calls the Java helper AyudanteHttp.makeRequest via JNI.
-// This class does NOT perform HTTP by itself; it just bridges between
-// C++ and Java, passing method, URL, body and headers to Java.
+// Uploader used by GestorTelemetria. It builds the request (endpoint, headers, body) and hands it to an
+// UploadTransport that actually sends it:
+//   - JniHttpTransport: the Java helper AyudanteHttp via JNI (default, required for https backends).
+//   - SocketHttpTransport: native HTTP/1.1 keep-alive for plain-HTTP collectors, no JVM involved.
+// The transport is chosen from UploaderConfig::transport (see configReader.h).
 class AndroidUploader {
 public:
+    // Completion callback of uploadJsonAsync, receives the status code, Retry-After hint and byte counts.
+    using UploadCallback = UploadTransport::Callback;
+
     AndroidUploader() = default;
     ~AndroidUploader() = default;
 
+#ifdef __ANDROID__
     // Stores the Java VM pointer and the global Activity reference.
-    // required later to obtain a JNIEnv* and to get the Activity class loader used to load the AyudanteHttp class.
+    // required later by JniHttpTransport to obtain a JNIEnv* and the Activity class loader that sees AyudanteHttp.
     void setJavaContext(JavaVM* vm, jobject activityGlobalRef);
+#endif
+
+    // Uses this transport instead of the one chosen from the configuration (e.g. a host build without JVM).
+    // Must be called before initialize().
+    void setTransport(std::unique_ptr<UploadTransport> transport);
 
-    //    // Initializes the uploader with the given configuration (endpoint URL, API key and other telemetry options)
-    //    // Returns false if vm_ or activity_ were not provided before, or if basic configuration is missing.
+    // Initializes the uploader with the given configuration (endpoint URL, API key and other telemetry options)
+    // and the selected transport. Returns false if basic configuration is missing or the transport cannot be used
+    // (for the JNI transport: vm_ or activity_ were not provided before).
     bool initialize(const UploaderConfig& cfg);
 
-    // Right now its a placeholder to mirror the other components, but no need yet due to java/android automatic shutdown
+    // Shuts the transport down: requests still running are dropped (their callbacks are not called).
     void shutdown();
 
     // Sends a JSON payload to the configured endpoint.
-    // Returns true if the Java call was executed successfully, false if configuration is missing or if the JNI call fails.
-    bool uploadJson(const std::string& jsonBody);
+    // Returns true if the server answered with a 2xx status, false if configuration is missing, the transport fails
+    // or the server returned an error. If result is not null it receives the status, Retry-After and byte counts.
+    bool uploadJson(const std::string& jsonBody, UploadResult* result = nullptr);
+
+    // Starts the upload of a JSON payload and returns right away; the transport reports the result by running
+    // `done` on one of its threads. Returns false if the request could not be started (`done` is never called).
+    bool uploadJsonAsync(const std::string& jsonBody, UploadCallback done);
+
+    // True if the current transport can run uploads asynchronously.
+    bool supportsAsync() const;
+
+    // True if cfg selects the JNI transport (the only one that needs the Java context).
+    static bool usesJniTransport(const UploaderConfig& cfg);
 
 private:
-    // Cached Java VM pointer, used to attach/detach threads and obtain JNIEnv*.
+#ifdef __ANDROID__
+    // Cached Java VM pointer and global Activity reference (not owned), passed to JniHttpTransport.
     JavaVM* vm_ = nullptr;
-    jobject activity_ = nullptr; // global ref, not owned
+    jobject activity_ = nullptr;
+#endif
 
     // Copy of the uploader configuration (endpoint URL, API key, flags).
     UploaderConfig cfg_;
 
-    // Internal helper that performs the actual JNI call:
-    // - method: HTTP method ("POST", "GET", etc.).
-    // - url: full URL for the request.
-    // - body: request body as a UTF-8 string (converted to byte[] in Java).
-    // - headers: key-value pairs for HTTP headers.
-    // This function attaches the thread to the JVM if necessary, calls AyudanteHttp.makeRequest, and detaches the thread if it was attached.
-    bool callJavaMakeRequest(const std::string& method,
-                             const std::string& url,
-                             const std::string& body,
-                             const std::vector<std::pair<std::string,std::string>>& headers);
-
+    std::unique_ptr<UploadTransport> transport_;
+    bool customTransport_ = false; // set through setTransport, kept across initialize()
 
+    // Headers sent with every upload (Content-Type, apikey, Authorization...).
+    HttpHeaders buildHeaders() const;
 };
@@ -0,0 +1,202 @@
+#include "AsyncFile.h"
+#include "ThreadPoolAsyncIo.h"
+#include "UringAsyncIo.h"
+#include <cerrno>
+#include <cstdlib>
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/falloc.h>
+
+#include "TelemetriaLog.h"
+
+// Page aligned buffers (what O_DIRECT and the io_uring fixed buffers would need) in whole pages.
+static constexpr size_t kBufferAlign = 4096;
+// Writer threads of the thread pool backend: one per buffer being written, more only adds contention.
+static constexpr size_t kPoolThreads = 2;
+
+std::unique_ptr<AsyncIo> createAsyncIo(const std::string& kind, unsigned depth) {
+    if (kind == "uring") {
+        std::unique_ptr<UringAsyncIo> uring(new UringAsyncIo());
+        if (uring->setup(depth)) return uring;
+        LOGI("AsyncIo: io_uring not usable, using the thread pool backend");
+    } else if (kind != "threads") {
+        return nullptr;
+    }
+    std::unique_ptr<ThreadPoolAsyncIo> pool(new ThreadPoolAsyncIo());
+    pool->start(kPoolThreads);
+    return pool;
+}
+
+AsyncFile::AsyncFile(size_t bufferSize, size_t bufferCount)
+    : bufferSize_((bufferSize + kBufferAlign - 1) / kBufferAlign * kBufferAlign),
+      bufs_(bufferCount) {
+}
+
+AsyncFile::~AsyncFile() {
+    flush();
+    freeBuffers();
+}
+
+void AsyncFile::freeBuffers() {
+    for (auto& b : bufs_) {
+        free(b.data);
+        b.data = nullptr;
+    }
+}
+
+void AsyncFile::setBackend(const std::string& kind) {
+    flush();
+    io_ = createAsyncIo(kind, (unsigned)bufs_.size());
+    if (!io_) freeBuffers();
+}
+
+const char* AsyncFile::backendName() const {
+    return io_ ? io_->name() : "sync";
+}
+
+void AsyncFile::attach(int fd) {
+    flush();
+    fd_ = fd;
+    error_ = false;
+}
+
+bool AsyncFile::writeNow(const char* data, size_t len, off_t off) {
+    while (len > 0) {
+        ssize_t n = ::pwrite(fd_, data, len, off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LOGE("AsyncFile: write failed: %s", strerror(errno));
+            error_ = true;
+            return false;
+        }
+        data += n;
+        len -= (size_t)n;
+        off += n;
+    }
+    return true;
+}
+
+bool AsyncFile::write(const void* data, size_t len, off_t off) {
+    if (error_ || fd_ < 0) return false;
+    const char* p = static_cast<const char*>(data);
+    if (!io_) return writeNow(p, len, off);
+    while (len > 0) {
+        if (fill_ >= 0) {
+            const Buffer& b = bufs_[fill_];
+            if (b.off + (off_t)b.len != off && !submitFill()) return false;
+        }
+        if (fill_ < 0) {
+            fill_ = acquireBuffer();
+            if (fill_ < 0) return false;
+            bufs_[fill_].len = 0;
+            bufs_[fill_].off = off;
+        }
+        Buffer& b = bufs_[fill_];
+        const size_t n = std::min(len, bufferSize_ - b.len);
+        memcpy(b.data + b.len, p, n);
+        b.len += n;
+        p += n;
+        len -= n;
+        off += (off_t)n;
+        if (b.len == bufferSize_ && !submitFill()) return false;
+    }
+    return !error_;
+}
+
+int AsyncFile::acquireBuffer() {
+    for (;;) {
+        for (size_t i = 0; i < bufs_.size(); ++i) {
+            Buffer& b = bufs_[i];
+            if (b.busy) continue;
+            if (!b.data) {
+                void* mem = nullptr;
+                if (posix_memalign(&mem, kBufferAlign, bufferSize_) != 0) {
+                    LOGE("AsyncFile: cannot allocate a %zu byte buffer", bufferSize_);
+                    error_ = true;
+                    return -1;
+                }
+                b.data = static_cast<char*>(mem);
+            }
+            return (int)i;
+        }
+        reapOne();
+        if (error_) return -1;
+    }
+}
+
+bool AsyncFile::submitFill() {
+    Buffer& b = bufs_[fill_];
+    const int index = fill_;
+    fill_ = -1;
+    if (b.len == 0) return true;
+    if (io_ && io_->submit(fd_, b.data, b.len, b.off, (uint32_t)index)) {
+        b.busy = true;
+        ++inFlight_;
+        return true;
+    }
+    // Backend queue full or failing: write it here
+    return writeNow(b.data, b.len, b.off);
+}
+
+void AsyncFile::reapOne() {
+    uint32_t tag = 0;
+    ssize_t result = 0;
+    io_->waitOne(tag, result);
+    if (tag == kAsyncIoBroken || tag >= bufs_.size() || !bufs_[tag].busy) {
+        // Nothing in flight can be trusted any more: drop the backend (it waits for the kernel or its
+        // threads before going away); after the next attach() writes are blocking.
+        LOGE("AsyncFile: %s backend failed, switching to blocking writes", io_->name());
+        io_.reset();
+        for (auto& b : bufs_) b.busy = false;
+        inFlight_ = 0;
+        error_ = true;
+        return;
+    }
+    Buffer& b = bufs_[tag];
+    b.busy = false;
+    --inFlight_;
+    if (result < 0) {
+        LOGE("AsyncFile: write failed: %s", strerror((int)-result));
+        error_ = true;
+    } else if ((size_t)result < b.len) {
+        // Short write (disk full shows up as ENOSPC on the retry)
+        writeNow(b.data + result, b.len - (size_t)result, b.off + result);
+    }
+}
+
+bool AsyncFile::submit() {
+    if (fill_ < 0) return !error_;
+    return submitFill() && !error_;
+}
+
+bool AsyncFile::flush() {
+    if (fill_ >= 0) submitFill();
+    while (inFlight_ > 0) reapOne();
+    return !error_;
+}
+
+bool AsyncFile::sync() {
+    if (!flush() || fd_ < 0) return false;
+    if (::fdatasync(fd_) != 0) {
+        LOGE("AsyncFile: fdatasync failed: %s", strerror(errno));
+        error_ = true;
+        return false;
+    }
+    return true;
+}
+
+bool AsyncFile::preallocate(int fd, off_t bytes) {
+    if (fd < 0 || bytes <= 0) return false;
+    int rc;
+    do {
+        rc = ::fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, bytes);
+    } while (rc != 0 && errno == EINTR);
+    if (rc != 0) {
+        // EOPNOTSUPP on FUSE / sdcardfs: the writes just allocate as they go
+        if (errno != EOPNOTSUPP) LOGI("AsyncFile: fallocate of %lld bytes failed: %s", (long long)bytes, strerror(errno));
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <sys/types.h>
+
+#include "AsyncIo.h"
+
+// Write side of a file through an AsyncIo backend: write() copies the data into one of a few aligned,
+// reusable buffers and returns; full buffers are written in the background, so the caller (the C3D writer
+// thread, the spool appender) never waits for the disk unless every buffer is still in flight.
+// Contiguous writes are coalesced into the same buffer. Writes are not ordered between them, so callers
+// must not write the same bytes twice without flush() in between.
+//
+// Errors are sticky: once a write fails every later call returns false until attach() is called again.
+// Without a backend (ioBackend "sync") every call is a plain blocking pwrite.
+// Not thread safe: one owner thread, like the file descriptor it writes to.
+class AsyncFile {
+public:
+    // bufferSize is rounded up to a multiple of 4 KiB.
+    explicit AsyncFile(size_t bufferSize = 256 * 1024, size_t bufferCount = 8);
+    // Waits for the writes in flight (the file descriptor is not closed here).
+    ~AsyncFile();
+
+    AsyncFile(const AsyncFile&) = delete;
+    AsyncFile& operator=(const AsyncFile&) = delete;
+
+    // Selects the backend by ioBackend config value ("threads", "uring" or "sync"). Waits for pending writes first.
+    void setBackend(const std::string& kind);
+    // Name of the backend in use ("sync" if none).
+    const char* backendName() const;
+
+    // Starts writing to fd (owned by the caller). Waits for the writes to the previous fd and clears the error.
+    void attach(int fd);
+
+    // Queues len bytes at offset off. Returns false on error.
+    bool write(const void* data, size_t len, off_t off);
+
+    // Starts writing the partly filled buffer now instead of waiting for more data.
+    bool submit();
+
+    // Waits until everything written so far has reached the file (page cache, not disk).
+    bool flush();
+
+    // flush() + fdatasync: everything written so far is on disk.
+    bool sync();
+
+    bool failed() const { return error_; }
+
+    // Reserves bytes of disk space for fd without changing its size, so the file does not fragment and the
+    // writes do not allocate blocks one by one. Best effort: false if the file system does not support it.
+    static bool preallocate(int fd, off_t bytes);
+
+private:
+    struct Buffer {
+        char* data = nullptr;
+        size_t len = 0;
+        off_t off = 0;
+        bool busy = false; // owned by the backend
+    };
+
+    size_t bufferSize_;
+    std::vector<Buffer> bufs_;
+    std::unique_ptr<AsyncIo> io_;
+    int fd_ = -1;
+    int fill_ = -1;         // buffer being filled, -1 = none
+    unsigned inFlight_ = 0;
+    bool error_ = false;
+
+    int acquireBuffer();
+    bool submitFill();
+    void reapOne();
+    bool writeNow(const char* data, size_t len, off_t off);
+    void freeBuffers();
+};
@@ -0,0 +1,37 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+
+// Tag returned by AsyncIo::waitOne when the backend cannot report completions any more.
+static constexpr uint32_t kAsyncIoBroken = 0xffffffffu;
+
+// Interface of the asynchronous write backends used by AsyncFile (C3D parts and upload spool segments).
+// A backend only starts positioned writes and reports their completions; buffering, ordering and
+// syncing are done by AsyncFile. Every method is called from the thread that owns the AsyncFile.
+// Implementations:
+//   - ThreadPoolAsyncIo: pwrite on a couple of background threads, works everywhere.
+//   - UringAsyncIo:      io_uring (Linux 5.6+) through raw syscalls, no extra threads.
+class AsyncIo {
+public:
+    virtual ~AsyncIo() = default;
+
+    // Backend name for the logs.
+    virtual const char* name() const = 0;
+
+    // Starts writing len bytes of data at offset off of fd. data must stay valid until the write completes.
+    // tag is returned by waitOne. Returns false if the write could not be started (the caller writes it itself).
+    virtual bool submit(int fd, const char* data, size_t len, off_t off, uint32_t tag) = 0;
+
+    // Blocks until one of the submitted writes completes. result: bytes written or -errno.
+    // Must only be called while at least one write is in flight. tag is kAsyncIoBroken if the backend
+    // itself failed; the writes in flight are then lost and the backend must not be used again.
+    virtual void waitOne(uint32_t& tag, ssize_t& result) = 0;
+};
+
+// Creates the backend for an ioBackend config value: "uring" (falls back to "threads" when io_uring is not
+// available) or "threads". Any other value, "sync" included, returns nullptr: plain blocking pwrite.
+// depth: maximum number of writes in flight.
+std::unique_ptr<AsyncIo> createAsyncIo(const std::string& kind, unsigned depth);
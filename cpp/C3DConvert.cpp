@@ -0,0 +1,774 @@
+#include "C3DConvert.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define C3D_HAVE_NEON 1
+#elif defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#include <immintrin.h>
+#define C3D_HAVE_X86 1
+#endif
+
+#include "TelemetriaLog.h"
+
+// Simple 3D vector helper used internally for geometry operations
+struct Vector3 {
+    float x, y, z;
+};
+
+// ---------------------------------------------------------------------------------------------------
+// Per-frame reference conversion
+// ---------------------------------------------------------------------------------------------------
+
+// helper to calculate 2 points from center-eye to match Gait Model front head points
+// First we rotate the given vector so we can add a fixed width
+void calculateHeadWidth(const VRPosePlain& midPos,Vector3& pointRight,Vector3& pointLeft, float headWidth) {
+
+    const float halfWidth = headWidth / 2.0f;
+
+    // Extract quaternion components
+    float qx = midPos.rotation[0], qy =  midPos.rotation[1], qz =  midPos.rotation[2], qw =  midPos.rotation[3];
+
+    // Lateral vector in local head space
+    Vector3 vLocal;
+    vLocal.x = halfWidth; vLocal.y = 0.0f; vLocal.z = 0.0f;
+
+    // Vector part of the quaternion
+    Vector3 qv;
+    qv.x = qx; qv.y = qy; qv.z = qz;
+
+    // t = 2 * cross(qv, vLocal)
+    Vector3 t;
+    t.x = 2.0f * (qv.y * vLocal.z - qv.z * vLocal.y);
+    t.y = 2.0f * (qv.z * vLocal.x - qv.x * vLocal.z);
+    t.z = 2.0f * (qv.x * vLocal.y - qv.y * vLocal.x);
+
+    // vWorld = vLocal + qw * t + cross(qv, t)
+    Vector3 vWorld;
+    vWorld.x = vLocal.x + qw * t.x + (qv.y * t.z - qv.z * t.y);
+    vWorld.y = vLocal.y + qw * t.y + (qv.z * t.x - qv.x * t.z);
+    vWorld.z = vLocal.z + qw * t.z + (qv.x * t.y - qv.y * t.x);
+
+    Vector3 worldOffset = vWorld;
+
+    // Apply to the head position
+    pointRight = {
+            midPos.position[0] + worldOffset.x,
+            midPos.position[1] + worldOffset.y,
+            midPos.position[2] + worldOffset.z
+    };
+
+    pointLeft = {
+            midPos.position[0] - worldOffset.x,
+            midPos.position[1] - worldOffset.y,
+            midPos.position[2] - worldOffset.z
+    };
+}
+
+//Same concept as HeadWith, but this time the data parameter is different
+void calculateWristWidthFromJoint(const JointSamplePlain& joint, Vector3& pointRight, Vector3& pointLeft, float wristWidth) {
+    const float halfWidth = wristWidth / 2.0f;
+
+    float qx = joint.qx;
+    float qy = joint.qy;
+    float qz = joint.qz;
+    float qw = joint.qw;
+
+    // Vector lateral en el sistema local de la muneca
+    Vector3 vLocal;
+    vLocal.x = halfWidth; vLocal.y = 0.0f; vLocal.z = 0.0f;
+
+    // Parte vectorial del cuaternion
+    Vector3 qv;
+    qv.x = qx; qv.y = qy; qv.z = qz;
+
+    // t = 2 * cross(qv, vLocal)
+    Vector3 t;
+    t.x = 2.0f * (qv.y * vLocal.z - qv.z * vLocal.y);
+    t.y = 2.0f * (qv.z * vLocal.x - qv.x * vLocal.z);
+    t.z = 2.0f * (qv.x * vLocal.y - qv.y * vLocal.x);
+
+    // vWorld = vLocal + qw * t + cross(qv, t)
+    Vector3 vWorld;
+    vWorld.x = vLocal.x + qw * t.x + (qv.y * t.z - qv.z * t.y);
+    vWorld.y = vLocal.y + qw * t.y + (qv.z * t.x - qv.x * t.z);
+    vWorld.z = vLocal.z + qw * t.z + (qv.x * t.y - qv.y * t.x);
+
+    // Aplicar a la posicion del joint
+    pointRight = {
+            joint.px + vWorld.x,
+            joint.py + vWorld.y,
+            joint.pz + vWorld.z
+    };
+
+    pointLeft = {
+            joint.px - vWorld.x,
+            joint.py - vWorld.y,
+            joint.pz - vWorld.z
+    };
+}
+
+// Convert from meters to millimeters (could be left as it is, but mm is more common with c3d files)
+inline void metersToMillimeters(float& x, float& y, float& z) {
+    const float k = 1000.0f;
+    x *= k;
+    y *= k;
+    z *= k;
+}
+inline void metersToMillimeters(Vector3& v) {
+    metersToMillimeters(v.x, v.y, v.z);
+}
+
+// // Axis conversion OpenXR -> Gait: X_g = -Z_old (towards)  Y_g = -X_old (left)  Z_g =  Y_old (up)
+inline void openxrToGaitAxes(float& x, float& y, float& z) {
+    const float ox = x;
+    const float oy = y;
+    const float oz = z;
+
+    x = -oz;  // delantero +
+    y = -ox;  // izquierda +
+    z =  oy;  // arriba +
+}
+inline void openxrToGaitAxes(Vector3& v) {
+    openxrToGaitAxes(v.x, v.y, v.z);
+}
+
+// Quaternion multiplication q_out = q_a * q_b (Hamilton product). Used in next method
+inline void quatMul(const float ax, const float ay, const float az, const float aw,
+                    const float bx, const float by, const float bz, const float bw,
+                    float& rx, float& ry, float& rz, float& rw) {
+    rx = aw*bx + ax*bw + ay*bz - az*by;
+    ry = aw*by - ax*bz + ay*bw + az*bx;
+    rz = aw*bz + ax*by - ay*bx + az*bw;
+    rw = aw*bw - ax*bx - ay*by - az*bz;
+}
+
+// Apply OpenXR -> Gait axis change to a quaternion (x,y,z,w).
+inline void openxrToGaitAxesQuat(float& qx, float& qy, float& qz, float& qw) {
+    // Cuaternion fijo que implementa la misma transformacion que openxrToGaitAxes en vectores
+    const float ax =  0.5f;
+    const float ay = -0.5f;
+    const float az = -0.5f;
+    const float aw =  0.5f;
+
+    float rx, ry, rz, rw;
+    quatMul(ax, ay, az, aw, qx, qy, qz, qw, rx, ry, rz, rw);
+
+    qx = rx;
+    qy = ry;
+    qz = rz;
+    qw = rw;
+}
+
+
+// Stores one point (x, y, z, residual) in a C3D record.
+static inline void setPoint(float* rec, size_t idx, float x, float y, float z, float residual) {
+    float* p = rec + idx * 4;
+    p[0] = x;
+    p[1] = y;
+    p[2] = z;
+    p[3] = residual;
+}
+
+// Converts one frame into a C3D record (see C3DWriter.h for the layout):
+// points in the order of buildPointNames(), then the analog channels of buildAnalogNames().
+void c3dConvertFrameReference(const VRFrameDataPlain& f, float* rec, size_t nbPoints, size_t nbAnalogs) {
+    // --- Puntos 3D ---
+    // Start by setting all points to (0,0,0) with residual -1 (missing marker).
+    for (size_t pi = 0; pi < nbPoints; ++pi) {
+        setPoint(rec, pi, 0.0f, 0.0f, 0.0f, -1.0f);
+    }
+
+    // Indices consistent with buildPointNames()
+    const size_t IDX_HEAD        = 0;
+    const size_t IDX_LFHD        = 1;
+    const size_t IDX_RFHD        = 2;
+    const size_t IDX_L_HAND_BASE = 3;                        // 26 joints L
+    const size_t IDX_R_HAND_BASE = IDX_L_HAND_BASE + 26;     // 26 joints R
+    const int FIN_JOINT_INDEX = 7; // en kHandJointNames[7] = "FIN"
+    const size_t IDX_LFIN = IDX_L_HAND_BASE + FIN_JOINT_INDEX;
+    const size_t IDX_RFIN = IDX_R_HAND_BASE + FIN_JOINT_INDEX;
+    const size_t IDX_LWRA        = IDX_R_HAND_BASE + 26;
+    const size_t IDX_LWRB        = IDX_LWRA + 1;
+    const size_t IDX_RWRA        = IDX_LWRA + 2;
+    const size_t IDX_RWRB        = IDX_LWRA + 3;
+
+    // HMD (HEAD)
+    {
+        float x = f.hmdPose.position[0];
+        float y = f.hmdPose.position[1];
+        float z = f.hmdPose.position[2];
+
+        openxrToGaitAxes(x, y, z);
+        metersToMillimeters(x, y, z);
+        setPoint(rec, IDX_HEAD, x, y, z, 0.0f);
+    }
+
+    // Extra head markers LFHD / RFHD from head width
+    Vector3 headRight, headLeft;
+    calculateHeadWidth(f.hmdPose, headRight, headLeft, 0.15f);
+
+    // LFHD = left side
+    openxrToGaitAxes(headLeft);
+    metersToMillimeters(headLeft);
+    setPoint(rec, IDX_LFHD, headLeft.x, headLeft.y, headLeft.z, 0.0f);
+
+    // RFHD = right side
+    openxrToGaitAxes(headRight);
+    metersToMillimeters(headRight);
+    setPoint(rec, IDX_RFHD, headRight.x, headRight.y, headRight.z, 0.0f);
+
+    // L_CTRL (if its valid it will have 0 joints but we do a double check)
+    if (f.leftCtrl.isActive && f.leftHandJointCount==0) {
+        float x = f.leftCtrl.pose.position[0];
+        float y = f.leftCtrl.pose.position[1];
+        float z = f.leftCtrl.pose.position[2];
+
+        const bool isZero = (x == 0.0f && y == 0.0f && z == 0.0f);
+        openxrToGaitAxes(x, y, z);
+        metersToMillimeters(x, y, z);
+
+        if (!isZero) setPoint(rec, IDX_LFIN, x, y, z, 0.0f);
+    }
+
+    // R_CTRL (if active)
+    if (f.rightCtrl.isActive && f.rightHandJointCount==0) {
+        float x = f.rightCtrl.pose.position[0];
+        float y = f.rightCtrl.pose.position[1];
+        float z = f.rightCtrl.pose.position[2];
+        const bool isZero = (x == 0.0f && y == 0.0f && z == 0.0f);
+
+        openxrToGaitAxes(x, y, z);
+        metersToMillimeters(x, y, z);
+
+        if (!isZero) setPoint(rec, IDX_RFIN, x, y, z, 0.0f);
+    }
+
+    // Hands: joints L
+    for (int j = 0; j < f.leftHandJointCount && j < 26; ++j) {
+        const auto& s = f.leftHandJoints[j];
+        float x = s.px;
+        float y = s.py;
+        float z = s.pz;
+
+        const bool isZero = (x == 0.0f && y == 0.0f && z == 0.0f);
+        openxrToGaitAxes(x, y, z);
+        metersToMillimeters(x, y, z);
+
+        if (!isZero) setPoint(rec, IDX_L_HAND_BASE + j, x, y, z, s.hasPose ? 0.0f : -1.0f);
+    }
+
+    // Hands: joints R
+    for (int j = 0; j < f.rightHandJointCount && j < 26; ++j) {
+        const auto& s = f.rightHandJoints[j];
+        float x = s.px;
+        float y = s.py;
+        float z = s.pz;
+
+        const bool isZero = (x == 0.0f && y == 0.0f && z == 0.0f);
+        openxrToGaitAxes(x, y, z);
+        metersToMillimeters(x, y, z);
+
+        if (!isZero) setPoint(rec, IDX_R_HAND_BASE + j, x, y, z, s.hasPose ? 0.0f : -1.0f);
+    }
+
+    // Extra wrist points LWRA/LWRB/RWRA/RWRB
+    // Left hand: joint 0 = WRIST
+    if (f.leftHandJointCount > 0) {
+        const auto& wrist = f.leftHandJoints[0];
+        if (wrist.hasPose) {
+            Vector3 wra, wrb;
+            calculateWristWidthFromJoint(wrist, wra, wrb, 0.06f);
+
+            const bool isZero = (wrist.px == 0.0f && wrist.py == 0.0f && wrist.pz == 0.0f);
+            openxrToGaitAxes(wra);
+            metersToMillimeters(wra);
+            openxrToGaitAxes(wrb);
+            metersToMillimeters(wrb);
+
+            if (!isZero) {
+                setPoint(rec, IDX_LWRA, wra.x, wra.y, wra.z, 0.0f);
+                setPoint(rec, IDX_LWRB, wrb.x, wrb.y, wrb.z, 0.0f);
+            }
+        }
+    }
+
+    // Right hand
+    if (f.rightHandJointCount > 0) {
+        const auto& wrist = f.rightHandJoints[0];
+        if (wrist.hasPose) {
+            Vector3 wra, wrb;
+            calculateWristWidthFromJoint(wrist, wra, wrb, 0.06f);
+
+            const bool isZero = (wrist.px == 0.0f && wrist.py == 0.0f && wrist.pz == 0.0f);
+            openxrToGaitAxes(wra);
+            metersToMillimeters(wra);
+            openxrToGaitAxes(wrb);
+            metersToMillimeters(wrb);
+
+            // OJO: invertimos A/B para que RWRA/RWRB no queden cruzados
+            if (!isZero) {
+                setPoint(rec, IDX_RWRA, wrb.x, wrb.y, wrb.z, 0.0f);
+                setPoint(rec, IDX_RWRB, wra.x, wra.y, wra.z, 0.0f);
+            }
+        }
+    }
+
+    // --- Analogs (cuaterniones + flag) ---
+    // Single sample per frame (ANALOG:RATE == POINT:RATE), right after the points.
+    float* analog = rec + nbPoints * 4;
+    size_t idx = 0;
+    auto setChan = [&](float value) { analog[idx++] = value; };
+
+    // HMD quaternion
+    {
+        float qx = f.hmdPose.rotation[0];
+        float qy = f.hmdPose.rotation[1];
+        float qz = f.hmdPose.rotation[2];
+        float qw = f.hmdPose.rotation[3];
+
+        openxrToGaitAxesQuat(qx, qy, qz, qw);
+        setChan(qx); setChan(qy); setChan(qz); setChan(qw);
+    }
+
+    // L_CTRL quaternion
+    if (f.leftCtrl.isActive && f.leftHandJointCount==0){
+        float qx = f.leftCtrl.pose.rotation[0];
+        float qy = f.leftCtrl.pose.rotation[1];
+        float qz = f.leftCtrl.pose.rotation[2];
+        float qw = f.leftCtrl.pose.rotation[3];
+
+        openxrToGaitAxesQuat(qx, qy, qz, qw);
+        setChan(qx); setChan(qy); setChan(qz); setChan(qw);
+    }
+
+    // R_CTRL quaternion
+    if (f.rightCtrl.isActive && f.rightHandJointCount==0){
+        float qx = f.rightCtrl.pose.rotation[0];
+        float qy = f.rightCtrl.pose.rotation[1];
+        float qz = f.rightCtrl.pose.rotation[2];
+        float qw = f.rightCtrl.pose.rotation[3];
+
+        openxrToGaitAxesQuat(qx, qy, qz, qw);
+        setChan(qx); setChan(qy); setChan(qz); setChan(qw);
+    }
+
+    // L_Joints quaternion
+    for (int j = 0; j < f.leftHandJointCount && j < 26; ++j) {
+        const auto& s = f.leftHandJoints[j];
+        float qx = s.qx, qy = s.qy, qz = s.qz, qw = s.qw;
+        openxrToGaitAxesQuat(qx, qy, qz, qw);
+        setChan(qx); setChan(qy); setChan(qz); setChan(qw);
+    }
+    // R_Joints quaternion
+    for (int j = 0; j < f.rightHandJointCount && j < 26; ++j) {
+        const auto& s = f.rightHandJoints[j];
+        float qx = s.qx, qy = s.qy, qz = s.qz, qw = s.qw;
+        openxrToGaitAxesQuat(qx, qy, qz, qw);
+        setChan(qx); setChan(qy); setChan(qz); setChan(qw);
+    }
+
+    while (idx + 1 < nbAnalogs) { // we leave the last for Realtime
+        setChan(0.0f);
+    }
+
+    // Extra channel for real time
+    if (nbAnalogs > 0) {
+        analog[nbAnalogs - 1] = static_cast<float>(f.timestampSec); // always last no matter size
+    }
+}
+
+
+// ---------------------------------------------------------------------------------------------------
+// Block conversion
+// ---------------------------------------------------------------------------------------------------
+
+namespace {
+    // Point slots, same order as buildPointNames()
+    constexpr size_t kIdxHead       = 0;
+    constexpr size_t kIdxLFHD       = 1;
+    constexpr size_t kIdxRFHD       = 2;
+    constexpr size_t kIdxLHandBase  = 3;
+    constexpr size_t kIdxRHandBase  = kIdxLHandBase + 26;
+    constexpr size_t kIdxLFIN       = kIdxLHandBase + 7; // kHandJointNames[7] = "FIN"
+    constexpr size_t kIdxRFIN       = kIdxRHandBase + 7;
+    constexpr size_t kIdxLWRA       = kIdxRHandBase + 26;
+    constexpr size_t kIdxLWRB       = kIdxLWRA + 1;
+    constexpr size_t kIdxRWRA       = kIdxLWRA + 2;
+    constexpr size_t kIdxRWRB       = kIdxLWRA + 3;
+    constexpr size_t kPointSlots    = kIdxRWRB + 1;
+
+    // Marker sources per frame: head (LFHD/RFHD), left wrist (LWRA/LWRB), right wrist (RWRA/RWRB)
+    constexpr size_t kMarkerSources = 3;
+    constexpr float kHeadWidth  = 0.15f;
+    constexpr float kWristWidth = 0.06f;
+
+    constexpr float kMm = 1000.0f;
+    // Fixed quaternion of openxrToGaitAxesQuat
+    constexpr float kAx = 0.5f, kAy = -0.5f, kAz = -0.5f, kAw = 0.5f;
+
+    constexpr float kMissing[4] = {0.0f, 0.0f, 0.0f, -1.0f};
+
+    struct MarkerArrays {
+        const float *px, *py, *pz, *qx, *qy, *qz, *qw, *h;
+        float *rx, *ry, *rz, *lx, *ly, *lz;
+    };
+
+    // --- Marker offsets over struct-of-arrays: p +- q * (h, 0, 0), same expressions as
+    // calculateHeadWidth. Scalar version first; the vector ones follow it operation by operation. ---
+
+    void markersScalar(const MarkerArrays& a, size_t begin, size_t n) {
+        for (size_t i = begin; i < n; ++i) {
+            const float qx = a.qx[i], qy = a.qy[i], qz = a.qz[i], qw = a.qw[i];
+            const float vx = a.h[i], vy = 0.0f, vz = 0.0f;
+            const float tx = 2.0f * (qy * vz - qz * vy);
+            const float ty = 2.0f * (qz * vx - qx * vz);
+            const float tz = 2.0f * (qx * vy - qy * vx);
+            const float wx = vx + qw * tx + (qy * tz - qz * ty);
+            const float wy = vy + qw * ty + (qz * tx - qx * tz);
+            const float wz = vz + qw * tz + (qx * ty - qy * tx);
+            a.rx[i] = a.px[i] + wx; a.ry[i] = a.py[i] + wy; a.rz[i] = a.pz[i] + wz;
+            a.lx[i] = a.px[i] - wx; a.ly[i] = a.py[i] - wy; a.lz[i] = a.pz[i] - wz;
+        }
+    }
+
+#if !C3D_HAVE_NEON && !C3D_HAVE_X86
+    void markersScalarAll(const MarkerArrays& a, size_t n) { markersScalar(a, 0, n); }
+#endif
+
+#if C3D_HAVE_NEON
+    void markersNeon(const MarkerArrays& a, size_t n) {
+        const float32x4_t zero = vdupq_n_f32(0.0f), two = vdupq_n_f32(2.0f);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            const float32x4_t qx = vld1q_f32(a.qx + i), qy = vld1q_f32(a.qy + i);
+            const float32x4_t qz = vld1q_f32(a.qz + i), qw = vld1q_f32(a.qw + i);
+            const float32x4_t vx = vld1q_f32(a.h + i), vy = zero, vz = zero;
+            const float32x4_t tx = vmulq_f32(two, vsubq_f32(vmulq_f32(qy, vz), vmulq_f32(qz, vy)));
+            const float32x4_t ty = vmulq_f32(two, vsubq_f32(vmulq_f32(qz, vx), vmulq_f32(qx, vz)));
+            const float32x4_t tz = vmulq_f32(two, vsubq_f32(vmulq_f32(qx, vy), vmulq_f32(qy, vx)));
+            const float32x4_t wx = vaddq_f32(vaddq_f32(vx, vmulq_f32(qw, tx)), vsubq_f32(vmulq_f32(qy, tz), vmulq_f32(qz, ty)));
+            const float32x4_t wy = vaddq_f32(vaddq_f32(vy, vmulq_f32(qw, ty)), vsubq_f32(vmulq_f32(qz, tx), vmulq_f32(qx, tz)));
+            const float32x4_t wz = vaddq_f32(vaddq_f32(vz, vmulq_f32(qw, tz)), vsubq_f32(vmulq_f32(qx, ty), vmulq_f32(qy, tx)));
+            const float32x4_t px = vld1q_f32(a.px + i), py = vld1q_f32(a.py + i), pz = vld1q_f32(a.pz + i);
+            vst1q_f32(a.rx + i, vaddq_f32(px, wx)); vst1q_f32(a.ry + i, vaddq_f32(py, wy)); vst1q_f32(a.rz + i, vaddq_f32(pz, wz));
+            vst1q_f32(a.lx + i, vsubq_f32(px, wx)); vst1q_f32(a.ly + i, vsubq_f32(py, wy)); vst1q_f32(a.lz + i, vsubq_f32(pz, wz));
+        }
+        markersScalar(a, i, n);
+    }
+#endif
+
+#if C3D_HAVE_X86
+    void markersSse2(const MarkerArrays& a, size_t n) {
+        const __m128 zero = _mm_set1_ps(0.0f), two = _mm_set1_ps(2.0f);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            const __m128 qx = _mm_loadu_ps(a.qx + i), qy = _mm_loadu_ps(a.qy + i);
+            const __m128 qz = _mm_loadu_ps(a.qz + i), qw = _mm_loadu_ps(a.qw + i);
+            const __m128 vx = _mm_loadu_ps(a.h + i), vy = zero, vz = zero;
+            const __m128 tx = _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(qy, vz), _mm_mul_ps(qz, vy)));
+            const __m128 ty = _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(qz, vx), _mm_mul_ps(qx, vz)));
+            const __m128 tz = _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(qx, vy), _mm_mul_ps(qy, vx)));
+            const __m128 wx = _mm_add_ps(_mm_add_ps(vx, _mm_mul_ps(qw, tx)), _mm_sub_ps(_mm_mul_ps(qy, tz), _mm_mul_ps(qz, ty)));
+            const __m128 wy = _mm_add_ps(_mm_add_ps(vy, _mm_mul_ps(qw, ty)), _mm_sub_ps(_mm_mul_ps(qz, tx), _mm_mul_ps(qx, tz)));
+            const __m128 wz = _mm_add_ps(_mm_add_ps(vz, _mm_mul_ps(qw, tz)), _mm_sub_ps(_mm_mul_ps(qx, ty), _mm_mul_ps(qy, tx)));
+            const __m128 px = _mm_loadu_ps(a.px + i), py = _mm_loadu_ps(a.py + i), pz = _mm_loadu_ps(a.pz + i);
+            _mm_storeu_ps(a.rx + i, _mm_add_ps(px, wx)); _mm_storeu_ps(a.ry + i, _mm_add_ps(py, wy)); _mm_storeu_ps(a.rz + i, _mm_add_ps(pz, wz));
+            _mm_storeu_ps(a.lx + i, _mm_sub_ps(px, wx)); _mm_storeu_ps(a.ly + i, _mm_sub_ps(py, wy)); _mm_storeu_ps(a.lz + i, _mm_sub_ps(pz, wz));
+        }
+        markersScalar(a, i, n);
+    }
+
+    // AVX, 8 lanes. Built with a target attribute and only used if the CPU has it.
+    __attribute__((target("avx")))
+    void markersAvx(const MarkerArrays& a, size_t n) {
+        const __m256 zero = _mm256_set1_ps(0.0f), two = _mm256_set1_ps(2.0f);
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            const __m256 qx = _mm256_loadu_ps(a.qx + i), qy = _mm256_loadu_ps(a.qy + i);
+            const __m256 qz = _mm256_loadu_ps(a.qz + i), qw = _mm256_loadu_ps(a.qw + i);
+            const __m256 vx = _mm256_loadu_ps(a.h + i), vy = zero, vz = zero;
+            const __m256 tx = _mm256_mul_ps(two, _mm256_sub_ps(_mm256_mul_ps(qy, vz), _mm256_mul_ps(qz, vy)));
+            const __m256 ty = _mm256_mul_ps(two, _mm256_sub_ps(_mm256_mul_ps(qz, vx), _mm256_mul_ps(qx, vz)));
+            const __m256 tz = _mm256_mul_ps(two, _mm256_sub_ps(_mm256_mul_ps(qx, vy), _mm256_mul_ps(qy, vx)));
+            const __m256 wx = _mm256_add_ps(_mm256_add_ps(vx, _mm256_mul_ps(qw, tx)), _mm256_sub_ps(_mm256_mul_ps(qy, tz), _mm256_mul_ps(qz, ty)));
+            const __m256 wy = _mm256_add_ps(_mm256_add_ps(vy, _mm256_mul_ps(qw, ty)), _mm256_sub_ps(_mm256_mul_ps(qz, tx), _mm256_mul_ps(qx, tz)));
+            const __m256 wz = _mm256_add_ps(_mm256_add_ps(vz, _mm256_mul_ps(qw, tz)), _mm256_sub_ps(_mm256_mul_ps(qx, ty), _mm256_mul_ps(qy, tx)));
+            const __m256 px = _mm256_loadu_ps(a.px + i), py = _mm256_loadu_ps(a.py + i), pz = _mm256_loadu_ps(a.pz + i);
+            _mm256_storeu_ps(a.rx + i, _mm256_add_ps(px, wx)); _mm256_storeu_ps(a.ry + i, _mm256_add_ps(py, wy)); _mm256_storeu_ps(a.rz + i, _mm256_add_ps(pz, wz));
+            _mm256_storeu_ps(a.lx + i, _mm256_sub_ps(px, wx)); _mm256_storeu_ps(a.ly + i, _mm256_sub_ps(py, wy)); _mm256_storeu_ps(a.lz + i, _mm256_sub_ps(pz, wz));
+        }
+        markersScalar(a, i, n);
+    }
+#endif
+
+    using MarkerKernel = void (*)(const MarkerArrays&, size_t);
+    struct Kernels {
+        const char* name;
+        MarkerKernel markers;
+    };
+
+    // Kernel sets this CPU can run, the preferred one first.
+    std::vector<Kernels> listKernels() {
+#if C3D_HAVE_NEON
+        return {{"neon", markersNeon}};
+#elif C3D_HAVE_X86
+        std::vector<Kernels> k;
+        if (__builtin_cpu_supports("avx")) k.push_back({"sse2+avx", markersAvx});
+        k.push_back({"sse2", markersSse2});
+        return k;
+#else
+        return {{"scalar", markersScalarAll}};
+#endif
+    }
+
+    const std::vector<Kernels>& supportedKernels() {
+        static const std::vector<Kernels> k = listKernels();
+        return k;
+    }
+
+    // Set by C3DConverter::forceKernels, null = the preferred set
+    std::atomic<const Kernels*> g_forcedKernels{nullptr};
+
+    const Kernels& kernels() {
+        const Kernels* forced = g_forcedKernels.load(std::memory_order_acquire);
+        return forced ? *forced : supportedKernels().front();
+    }
+
+    // --- One point / one quaternion per 128-bit register, straight from the frame into the record.
+    //
+    // putPoint: (x, y, z) -> (-z*k, -x*k, y*k, residual), openxrToGaitAxes + metersToMillimeters.
+    //   (-z)*k and z*(-k) are the same float, so it is a lane shuffle and one multiply by (-k, -k, k, 1).
+    //   Reads 4 floats at p; the 4th (the next field of the struct) is overwritten with the residual.
+    // putQuat: (0.5, -0.5, -0.5, 0.5) * q, openxrToGaitAxesQuat. Each output lane adds its four products
+    //   in the same order as quatMul (a - b is a + (-b) in IEEE), with the signs moved into the constants. ---
+
+#if C3D_HAVE_NEON
+    inline void putPoint(float* out, const float* p, float residual) {
+        static const float kScale[4] = {-kMm, -kMm, kMm, 1.0f};
+        const float32x4_t v = vld1q_f32(p);                 // (x, y, z, w)
+        float32x4_t t = vextq_f32(v, v, 3);                 // (w, x, y, z)
+        t = vcopyq_laneq_f32(t, 0, v, 2);                   // (z, x, y, z)
+        vst1q_f32(out, vmulq_f32(t, vld1q_f32(kScale)));
+        out[3] = residual;
+    }
+
+    inline void putQuat(float* out, const float* q) {
+        static const float kC1[4] = {kAw, kAw, kAw, kAw};
+        static const float kC2[4] = {kAx, -kAx, kAx, -kAx};
+        static const float kC3[4] = {kAy, kAy, -kAy, -kAy};
+        static const float kC4[4] = {-kAz, kAz, kAz, -kAz};
+        const float32x4_t b = vld1q_f32(q);                 // (bx, by, bz, bw)
+        const float32x4_t s2 = vextq_f32(b, b, 2);          // (bz, bw, bx, by)
+        const float32x4_t s1 = vrev64q_f32(s2);             // (bw, bz, by, bx)
+        const float32x4_t s3 = vrev64q_f32(b);              // (by, bx, bw, bz)
+        float32x4_t r = vaddq_f32(vmulq_f32(vld1q_f32(kC1), b), vmulq_f32(vld1q_f32(kC2), s1));
+        r = vaddq_f32(r, vmulq_f32(vld1q_f32(kC3), s2));
+        r = vaddq_f32(r, vmulq_f32(vld1q_f32(kC4), s3));
+        vst1q_f32(out, r);
+    }
+#elif C3D_HAVE_X86
+    inline void putPoint(float* out, const float* p, float residual) {
+        const __m128 v = _mm_loadu_ps(p);                                   // (x, y, z, w)
+        const __m128 t = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 1, 0, 2));     // (z, x, y, w)
+        _mm_storeu_ps(out, _mm_mul_ps(t, _mm_setr_ps(-kMm, -kMm, kMm, 1.0f)));
+        out[3] = residual;
+    }
+
+    inline void putQuat(float* out, const float* q) {
+        const __m128 b = _mm_loadu_ps(q);                                   // (bx, by, bz, bw)
+        const __m128 s1 = _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 1, 2, 3));    // (bw, bz, by, bx)
+        const __m128 s2 = _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 3, 2));    // (bz, bw, bx, by)
+        const __m128 s3 = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 3, 0, 1));    // (by, bx, bw, bz)
+        __m128 r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(kAw), b), _mm_mul_ps(_mm_setr_ps(kAx, -kAx, kAx, -kAx), s1));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_setr_ps(kAy, kAy, -kAy, -kAy), s2));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_setr_ps(-kAz, kAz, kAz, -kAz), s3));
+        _mm_storeu_ps(out, r);
+    }
+#else
+    inline void putPoint(float* out, const float* p, float residual) {
+        const float ox = p[0], oy = p[1], oz = p[2];
+        out[0] = -oz * kMm;
+        out[1] = -ox * kMm;
+        out[2] = oy * kMm;
+        out[3] = residual;
+    }
+
+    inline void putQuat(float* out, const float* q) {
+        const float bx = q[0], by = q[1], bz = q[2], bw = q[3];
+        out[0] = kAw*bx + kAx*bw + kAy*bz - kAz*by;
+        out[1] = kAw*by - kAx*bz + kAy*bw + kAz*bx;
+        out[2] = kAw*bz + kAx*by - kAy*bx + kAz*bw;
+        out[3] = kAw*bw - kAx*bx - kAy*by - kAz*bz;
+    }
+#endif
+
+    inline bool isZero(const float* p) { return p[0] == 0.0f && p[1] == 0.0f && p[2] == 0.0f; }
+
+#ifndef NDEBUG
+    // Same bits, or both NaN (payloads may differ between units)
+    bool sameFloat(float a, float b) {
+        return std::memcmp(&a, &b, sizeof(float)) == 0 || (std::isnan(a) && std::isnan(b));
+    }
+#endif
+}
+
+const char* C3DConverter::kernelName() {
+    return kernels().name;
+}
+
+std::vector<const char*> C3DConverter::kernelNames() {
+    std::vector<const char*> names;
+    for (const Kernels& k : supportedKernels()) names.push_back(k.name);
+    return names;
+}
+
+bool C3DConverter::forceKernels(const char* name) {
+    if (!name) {
+        g_forcedKernels.store(nullptr, std::memory_order_release);
+        return true;
+    }
+    for (const Kernels& k : supportedKernels()) {
+        if (std::strcmp(k.name, name) != 0) continue;
+        g_forcedKernels.store(&k, std::memory_order_release);
+        return true;
+    }
+    return false;
+}
+
+// Writes the records of the chunk except the head/wrist markers, with the same conditions as
+// c3dConvertFrameReference for which points are present and which quaternions go to the analog
+// channels, and collects the marker sources.
+void C3DConverter::writeFrames(const VRFrameDataPlain* frames, size_t n, float* records,
+                               size_t nbPoints, size_t nbAnalogs) {
+    const size_t stride = nbPoints * 4 + nbAnalogs;
+    const size_t nm = n * kMarkerSources;
+    for (auto* v : {&mpx_, &mpy_, &mpz_, &mqx_, &mqy_, &mqz_, &mqw_, &mh_}) v->resize(nm);
+    for (auto* v : {&rx_, &ry_, &rz_, &lx_, &ly_, &lz_}) v->resize(nm);
+    markerUsed_.assign(nm, 0);
+
+    for (size_t i = 0; i < n; ++i) {
+        const VRFrameDataPlain& f = frames[i];
+        float* rec = records + i * stride;
+        for (size_t p = 0; p < nbPoints; ++p) std::memcpy(rec + p * 4, kMissing, sizeof(kMissing));
+
+        auto setSource = [&](size_t m, const float* p, float qx, float qy, float qz, float qw, float width) {
+            const size_t k = i * kMarkerSources + m;
+            mpx_[k] = p[0]; mpy_[k] = p[1]; mpz_[k] = p[2];
+            mqx_[k] = qx; mqy_[k] = qy; mqz_[k] = qz; mqw_[k] = qw;
+            mh_[k] = width / 2.0f;
+            markerUsed_[k] = m == 0 || !isZero(p); // head markers are always written
+        };
+        float* analog = rec + nbPoints * 4;
+        size_t idx = 0;
+        auto addQuat = [&](const float* q) {
+            if (idx + 4 > nbAnalogs) return;
+            putQuat(analog + idx, q);
+            idx += 4;
+        };
+
+        // Head; LFHD/RFHD come from the marker kernel
+        const VRPosePlain& hmd = f.hmdPose;
+        putPoint(rec + kIdxHead * 4, hmd.position, 0.0f);
+        setSource(0, hmd.position, hmd.rotation[0], hmd.rotation[1], hmd.rotation[2], hmd.rotation[3], kHeadWidth);
+        addQuat(hmd.rotation);
+
+        // Controllers go to the FIN slot when the hand has no joints
+        if (f.leftCtrl.isActive && f.leftHandJointCount == 0) {
+            const float* p = f.leftCtrl.pose.position;
+            if (!isZero(p)) putPoint(rec + kIdxLFIN * 4, p, 0.0f);
+            addQuat(f.leftCtrl.pose.rotation);
+        }
+        if (f.rightCtrl.isActive && f.rightHandJointCount == 0) {
+            const float* p = f.rightCtrl.pose.position;
+            if (!isZero(p)) putPoint(rec + kIdxRFIN * 4, p, 0.0f);
+            addQuat(f.rightCtrl.pose.rotation);
+        }
+
+        // Hand joints (left then right, also the channel order) and the wrist as marker source
+        auto hand = [&](const JointSamplePlain* joints, int count, size_t slotBase, size_t source) {
+            for (int j = 0; j < count && j < 26; ++j) {
+                const JointSamplePlain& s = joints[j];
+                if (!isZero(&s.px)) putPoint(rec + (slotBase + j) * 4, &s.px, s.hasPose ? 0.0f : -1.0f);
+                addQuat(&s.qx);
+            }
+            if (count > 0 && joints[0].hasPose) {
+                const JointSamplePlain& w = joints[0];
+                setSource(source, &w.px, w.qx, w.qy, w.qz, w.qw, kWristWidth);
+            }
+        };
+        hand(f.leftHandJoints, f.leftHandJointCount, kIdxLHandBase, 1);
+        hand(f.rightHandJoints, f.rightHandJointCount, kIdxRHandBase, 2);
+
+        while (idx + 1 < nbAnalogs) analog[idx++] = 0.0f;
+        if (nbAnalogs > 0) analog[nbAnalogs - 1] = static_cast<float>(f.timestampSec);
+    }
+}
+
+void C3DConverter::convertBlock(const VRFrameDataPlain* frames, size_t n, float* records,
+                                size_t nbPoints, size_t nbAnalogs) {
+    const size_t stride = nbPoints * 4 + nbAnalogs;
+    if (nbPoints < kPointSlots) {
+        // Not the recorder layout
+        for (size_t i = 0; i < n; ++i) c3dConvertFrameReference(frames[i], records + i * stride, nbPoints, nbAnalogs);
+        return;
+    }
+    for (size_t off = 0; off < n; off += kChunkFrames) {
+        convertChunk(frames + off, std::min(kChunkFrames, n - off), records + off * stride, nbPoints, nbAnalogs);
+    }
+
+#ifndef NDEBUG
+    // Check against the original per-frame code. Only logged: the records are left as the kernels wrote them,
+    // so debug and release builds write the same files (C3DConvertTest compares them bit for bit).
+    check_.resize(stride);
+    for (size_t i = 0; i < n; ++i) {
+        float* rec = records + i * stride;
+        c3dConvertFrameReference(frames[i], check_.data(), nbPoints, nbAnalogs);
+        for (size_t v = 0; v < stride; ++v) {
+            if (sameFloat(rec[v], check_[v])) continue;
+            if (!mismatchLogged_) {
+                LOGE("C3DConverter: %s kernels differ from the reference at value %zu (%.9g vs %.9g)",
+                     kernels().name, v, rec[v], check_[v]);
+                mismatchLogged_ = true;
+            }
+            break;
+        }
+    }
+#endif
+}
+
+void C3DConverter::convertChunk(const VRFrameDataPlain* frames, size_t n, float* records,
+                                size_t nbPoints, size_t nbAnalogs) {
+    const size_t stride = nbPoints * 4 + nbAnalogs;
+    writeFrames(frames, n, records, nbPoints, nbAnalogs);
+
+    // Head and wrist markers of the whole chunk: source position +- rotated half width
+    const MarkerArrays m = {mpx_.data(), mpy_.data(), mpz_.data(), mqx_.data(), mqy_.data(), mqz_.data(),
+                            mqw_.data(), mh_.data(),
+                            rx_.data(), ry_.data(), rz_.data(), lx_.data(), ly_.data(), lz_.data()};
+    kernels().markers(m, n * kMarkerSources);
+
+    for (size_t i = 0; i < n; ++i) {
+        float* rec = records + i * stride;
+        const size_t s = i * kMarkerSources;
+        auto put = [&](size_t slot, const std::vector<float>& x, const std::vector<float>& y,
+                       const std::vector<float>& z, size_t src) {
+            const float p[4] = {x[src], y[src], z[src], 0.0f};
+            putPoint(rec + slot * 4, p, 0.0f);
+        };
+        put(kIdxLFHD, lx_, ly_, lz_, s);
+        put(kIdxRFHD, rx_, ry_, rz_, s);
+        if (markerUsed_[s + 1]) {
+            put(kIdxLWRA, rx_, ry_, rz_, s + 1);
+            put(kIdxLWRB, lx_, ly_, lz_, s + 1);
+        }
+        if (markerUsed_[s + 2]) {
+            // A/B swapped on the right hand so RWRA/RWRB do not cross
+            put(kIdxRWRA, lx_, ly_, lz_, s + 2);
+            put(kIdxRWRB, rx_, ry_, rz_, s + 2);
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "TiposVR.h"
+
+// Conversion of VR frames into C3D records (record layout in C3DWriter.h, point/channel order of
+// C3DRecorder::buildPointNames / buildAnalogNames), a chunk of frames at a time.
+//
+// Points and quaternions go straight from the frame into the record, one per 128-bit register: the
+// OpenXR -> Gait axis swap with the mm scaling is a lane shuffle and a multiply, and the quaternion
+// pre-multiplication is three shuffles, four multiplies and three adds. The head and wrist markers of the whole
+// chunk are gathered into struct-of-arrays (x[], y[], z[], qx[]...) and offset by a vector kernel.
+// NEON on arm64, SSE2 on x86-64 (AVX for the marker kernel when the CPU has it), scalar elsewhere.
+// Every version does exactly the same float operations as the per-frame code it replaces (this file is
+// built with -ffp-contract=off so nothing gets fused), so the records are bit-identical.
+class C3DConverter {
+public:
+    // Converts n frames into n consecutive records of nbPoints*4 + nbAnalogs floats.
+    // Debug builds (no NDEBUG) also convert the block with c3dConvertFrameReference and log the first
+    // difference; the records are not changed.
+    void convertBlock(const VRFrameDataPlain* frames, size_t n, float* records, size_t nbPoints, size_t nbAnalogs);
+
+    // Kernel set in use: "neon", "sse2", "sse2+avx" or "scalar".
+    static const char* kernelName();
+    // Kernel sets this CPU can run, the one used by default first.
+    static std::vector<const char*> kernelNames();
+    // Uses one of kernelNames() in every converter from now on (tests and benchmarks; call it while nothing
+    // is converting). nullptr goes back to the default. False if the CPU cannot run it.
+    static bool forceKernels(const char* name);
+
+private:
+    // Frames converted at a time, so the records are still in cache when the markers are written.
+    static constexpr size_t kChunkFrames = 32;
+
+    // Marker sources, kMarkerSources per frame: position, orientation and half width of the offset
+    std::vector<float> mpx_, mpy_, mpz_, mqx_, mqy_, mqz_, mqw_, mh_;
+    std::vector<float> rx_, ry_, rz_, lx_, ly_, lz_; // p + offset, p - offset
+    std::vector<uint8_t> markerUsed_;                 // 0 = its two markers stay missing
+#ifndef NDEBUG
+    std::vector<float> check_;
+    bool mismatchLogged_ = false;
+#endif
+
+    void convertChunk(const VRFrameDataPlain* frames, size_t n, float* records, size_t nbPoints, size_t nbAnalogs);
+    void writeFrames(const VRFrameDataPlain* frames, size_t n, float* records, size_t nbPoints, size_t nbAnalogs);
+};
+
+// Original one-frame scalar conversion, kept as the reference the kernels are checked against.
+void c3dConvertFrameReference(const VRFrameDataPlain& f, float* rec, size_t nbPoints, size_t nbAnalogs);
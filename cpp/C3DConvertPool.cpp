@@ -0,0 +1,109 @@
+#include "C3DConvertPool.h"
+#include "AllocStats.h"
+
+#include <algorithm>
+
+C3DConvertPool::~C3DConvertPool() {
+    stop();
+}
+
+size_t C3DConvertPool::resolveThreads(int configured) {
+    if (configured > 0) return (size_t)configured;
+    // hardware_concurrency() may return 0 when it cannot tell
+    const size_t cores = std::thread::hardware_concurrency();
+    return std::max<size_t>(1, std::min(cores, kMaxAutoThreads));
+}
+
+void C3DConvertPool::start(size_t threads) {
+    stop();
+    if (threads < 1) threads = 1;
+    converters_.clear();
+    converters_.resize(threads);
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stop_ = false;
+        active_ = 0;
+        generation = generation_;
+    }
+    // Workers start from the current generation, so they only wake up for the next convert()
+    workers_.reserve(threads - 1);
+    for (size_t i = 1; i < threads; ++i) {
+        workers_.emplace_back(&C3DConvertPool::workerLoop, this, i, generation);
+    }
+}
+
+void C3DConvertPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stop_ = true;
+    }
+    workCv_.notify_all();
+    for (auto& t : workers_) {
+        if (t.joinable()) t.join();
+    }
+    workers_.clear();
+}
+
+void C3DConvertPool::convert(const Task* tasks, size_t count, size_t nbPoints, size_t nbAnalogs) {
+    if (converters_.empty()) converters_.resize(1);
+    const size_t stride = nbPoints * 4 + nbAnalogs;
+
+    items_.clear();
+    for (size_t t = 0; t < count; ++t) {
+        for (size_t first = 0; first < tasks[t].n; first += kItemFrames) {
+            Task item;
+            item.frames = tasks[t].frames + first;
+            item.n = std::min(kItemFrames, tasks[t].n - first);
+            item.records = tasks[t].records + first * stride;
+            items_.push_back(item);
+        }
+    }
+    nbPoints_ = nbPoints;
+    nbAnalogs_ = nbAnalogs;
+    nextItem_.store(0, std::memory_order_relaxed);
+
+    // Not worth waking anybody for a single item.
+    if (workers_.empty() || items_.size() < 2) {
+        runItems(converters_[0]);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        active_ = workers_.size();
+        ++generation_;
+    }
+    workCv_.notify_all();
+    runItems(converters_[0]);
+
+    // Workers may still be finishing their last item.
+    std::unique_lock<std::mutex> lock(mtx_);
+    doneCv_.wait(lock, [&]{ return active_ == 0; });
+}
+
+void C3DConvertPool::runItems(C3DConverter& converter) {
+    for (;;) {
+        const size_t i = nextItem_.fetch_add(1, std::memory_order_relaxed);
+        if (i >= items_.size()) return;
+        const Task& item = items_[i];
+        converter.convertBlock(item.frames, item.n, item.records, nbPoints_, nbAnalogs_);
+    }
+}
+
+void C3DConvertPool::workerLoop(size_t index, uint64_t seen) {
+    AllocScope allocTag(kAllocC3D);
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            workCv_.wait(lock, [&]{ return stop_ || generation_ != seen; });
+            if (stop_) return;
+            seen = generation_;
+        }
+        runItems(converters_[index]);
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (--active_ == 0) doneCv_.notify_one();
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "TiposVR.h"
+#include "C3DConvert.h"
+
+// Small worker pool that converts frames into C3D records on several threads.
+// Every frame is converted independently, so convert() cuts its tasks into runs of kItemFrames frames and
+// the workers (plus the calling thread) take runs from a shared counter until none is left. Each thread
+// has its own C3DConverter (the converter keeps scratch buffers), and every run writes to its own slice of
+// the output, so the records come out exactly as a single-threaded conversion would leave them.
+class C3DConvertPool {
+public:
+    // Frames to convert and where their records go (n * (nbPoints*4 + nbAnalogs) floats).
+    struct Task {
+        const VRFrameDataPlain* frames = nullptr;
+        size_t n = 0;
+        float* records = nullptr;
+    };
+
+    C3DConvertPool() = default;
+    ~C3DConvertPool();
+
+    C3DConvertPool(const C3DConvertPool&) = delete;
+    C3DConvertPool& operator=(const C3DConvertPool&) = delete;
+
+    // Starts threads - 1 workers (the caller of convert() is the last one). 1 = everything on the caller.
+    void start(size_t threads);
+
+    // Stops and joins the workers. Safe to call more than once.
+    void stop();
+
+    // Threads taking part in convert(), caller included.
+    size_t threads() const { return converters_.empty() ? 1 : converters_.size(); }
+
+    // Converts every task and returns when all records are written. Called from one thread at a time.
+    void convert(const Task* tasks, size_t count, size_t nbPoints, size_t nbAnalogs);
+
+    // Thread count for a c3dConvertThreads config value: 0 = automatic (cores available, at most kMaxAutoThreads).
+    static size_t resolveThreads(int configured);
+
+private:
+    // Frames per work item: big enough to amortize the counter, small enough to balance a 256-frame block.
+    static constexpr size_t kItemFrames = 64;
+    static constexpr size_t kMaxAutoThreads = 4;
+
+    std::vector<std::thread> workers_;
+    std::vector<C3DConverter> converters_; // [0] is used by the caller, [i] by workers_[i - 1]
+
+    std::mutex mtx_;
+    std::condition_variable workCv_; // a new job (generation_ changed) or stop_
+    std::condition_variable doneCv_; // active_ reached 0
+    uint64_t generation_ = 0;
+    size_t active_ = 0;              // workers still running the current job
+    bool stop_ = false;
+
+    // Current job, written by convert() before generation_ is bumped.
+    std::vector<Task> items_;
+    std::atomic<size_t> nextItem_{0};
+    size_t nbPoints_ = 0;
+    size_t nbAnalogs_ = 0;
+
+    void workerLoop(size_t index, uint64_t seen);
+    void runItems(C3DConverter& converter);
+};
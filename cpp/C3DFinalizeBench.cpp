@@ -0,0 +1,114 @@
+// Finalize benchmark: converts and writes a synthetic session as one C3D file with 1..N conversion threads,
+// the same work C3DRecorder does when a whole backlog of blocks is waiting at finalize.
+// Built with -DTELEMETRIA_BUILD_BENCH=ON; on the headset:
+//   adb push c3d_finalize_bench /data/local/tmp && adb shell /data/local/tmp/c3d_finalize_bench
+// Arguments (all optional): output directory, max threads (default: cores), session seconds (default 3600).
+
+#include "C3DConvertPool.h"
+#include "C3DWriter.h"
+#include "SyntheticMotion.h"
+
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Same record as C3DRecorder: 59 points (HMD, controllers, 2 x 26 joints, head and wrist markers)
+// and 213 analog channels, 90 Hz like a Quest.
+constexpr size_t kPoints = 59;
+constexpr size_t kAnalogs = 213;
+constexpr int kFrameRate = 90;
+// Blocks converted at once, as C3DRecorder::kBlockFrames * kMaxBatchBlocks
+constexpr size_t kBatchFrames = 256 * 8;
+
+C3DWriter::Layout makeLayout() {
+    C3DWriter::Layout layout;
+    char name[16];
+    for (size_t i = 0; i < kPoints; ++i) {
+        std::snprintf(name, sizeof(name), "P%02zu", i);
+        layout.pointNames.emplace_back(name);
+    }
+    for (size_t i = 0; i < kAnalogs; ++i) {
+        std::snprintf(name, sizeof(name), "A%03zu", i);
+        layout.analogNames.emplace_back(name);
+    }
+    layout.frameRate = (float)kFrameRate;
+    return layout;
+}
+
+double secondsSince(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+#ifdef __ANDROID__
+    std::string dir = "/data/local/tmp";
+#else
+    std::string dir = ".";
+#endif
+    if (argc > 1) dir = argv[1];
+    size_t maxThreads = C3DConvertPool::resolveThreads(0);
+    if (argc > 2) maxThreads = (size_t)std::max(1, std::atoi(argv[2]));
+    int seconds = 3600;
+    if (argc > 3) seconds = std::max(1, std::atoi(argv[3]));
+
+    // A person walking around with controllers and tracked hands
+    SyntheticMotion::Options options;
+    options.rateHz = kFrameRate;
+    SyntheticMotion motion(options);
+    std::vector<VRFrameDataPlain> frames;
+    motion.generate(frames, (size_t)seconds * kFrameRate);
+    const C3DWriter::Layout layout = makeLayout();
+    const size_t stride = kPoints * 4 + kAnalogs;
+    const std::string path = dir + "/c3d_finalize_bench.c3d";
+
+    std::printf("%zu frames (%d s at %d Hz), %s kernels, %.1f MB of records\n", frames.size(), seconds, kFrameRate,
+                C3DConverter::kernelName(), frames.size() * stride * 4.0 / (1024.0 * 1024.0));
+    std::printf("threads  convert_s  write_s  finalize_s  speedup\n");
+
+    std::vector<float> records(kBatchFrames * stride);
+    double base = 0.0;
+    for (size_t threads = 1; threads <= maxThreads; ++threads) {
+        C3DConvertPool pool;
+        pool.start(threads);
+        C3DWriter writer;
+        if (!writer.open(path, layout)) {
+            std::fprintf(stderr, "cannot open %s\n", path.c_str());
+            return 1;
+        }
+
+        double convertSec = 0.0;
+        const auto t0 = std::chrono::steady_clock::now();
+        for (size_t first = 0; first < frames.size(); first += kBatchFrames) {
+            C3DConvertPool::Task task;
+            task.frames = frames.data() + first;
+            task.n = std::min(kBatchFrames, frames.size() - first);
+            task.records = records.data();
+            const auto c0 = std::chrono::steady_clock::now();
+            pool.convert(&task, 1, kPoints, kAnalogs);
+            convertSec += secondsSince(c0);
+            if (!writer.appendFrames(records.data(), task.n)) {
+                std::fprintf(stderr, "write failed\n");
+                return 1;
+            }
+        }
+        const bool ok = writer.finalize();
+        const double total = secondsSince(t0);
+        pool.stop();
+        unlink(path.c_str());
+        if (!ok) {
+            std::fprintf(stderr, "finalize failed\n");
+            return 1;
+        }
+
+        if (threads == 1) base = total;
+        std::printf("%7zu  %9.3f  %7.3f  %10.3f  %6.2fx\n", threads, convertSec, total - convertSec, total, base / total);
+    }
+    return 0;
+}
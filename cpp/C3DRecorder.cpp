@@ -1,30 +1,25 @@
 #include "C3DRecorder.h"
 #include "configReader.h"
-
-#include <android/log.h>
-#include <fstream>
-#include <sstream>
+#include "PipelineTrace.h"
+#include "AllocStats.h"
+#include "TelemetriaProbes.h"
+
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
 #include <algorithm>
+#include <chrono>
 
-#include <ezc3d/ezc3d.h> // Libreria externa open source para tratamiento de archivos c3d
-#include <ezc3d/Parameters.h>
-#include <ezc3d/Data.h>
-
-#define LOG_TAG "telemetria"
-#define LOGI(...) __android_log_print(ANDROID_LOG_INFO,  LOG_TAG, __VA_ARGS__)
-#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
-
-// Simple 3D vector helper used internally for geometry operations
-struct Vector3 {
-    float x, y, z;
-};
+#include "TelemetriaLog.h"
 
 C3DRecorder::C3DRecorder() {}
 C3DRecorder::~C3DRecorder() {
     // Safety, if someone forgets to call C3Dfinalize explicitly, we end it automatically to avoid losing data.
-    if (initialized_ && !finalized_) {
-        C3Dfinalize();
-    }
+    // Also waits for a finalization started with C3DfinalizeAsync that is still running.
+    C3Dfinalize();
 }
 
 bool C3DRecorder::C3DisInitialized() const {
@@ -32,6 +27,23 @@ bool C3DRecorder::C3DisInitialized() const {
     return initialized_;
 }
 
+void C3DRecorder::C3DgetStats(TelemetryStatsPlain& out) const {
+    // A frame is counted as recorded before it is written or dropped, so recorded is read last. The loads are
+    // not one snapshot though, hence the clamp.
+    const unsigned long long written = statFramesWritten_.load(std::memory_order_relaxed);
+    const unsigned long long dropped = statFramesDropped_.load(std::memory_order_relaxed);
+    const unsigned long long recorded = statFramesRecorded_.load(std::memory_order_relaxed);
+    out.c3dFramesRecorded = recorded;
+    out.c3dFramesDropped = dropped;
+    out.c3dFramesWritten = written;
+    out.c3dFramesBuffered = recorded > written + dropped ? recorded - written - dropped : 0;
+    out.memoryBytes += out.c3dFramesBuffered * sizeof(VRFrameDataPlain);
+}
+
+void C3DRecorder::C3DgetLatency(TelemetryLatencyStatsPlain& out) const {
+    finalizeLatency_.summarize(out.c3dFinalize);
+}
+
 std::string C3DRecorder::sanitizeSessionId(const std::string& raw) const {
     std::string s = raw;
     // Replace invalid characters with underscore
@@ -47,7 +59,7 @@ std::string C3DRecorder::sanitizeSessionId(const std::string& raw) const {
     return s;
 }
 
-// Builds /sdcard/Android/data/<pkg>/files/session_<sessionId>.c3d
+// Builds /sdcard/Android/data/<pkg>/files/session_<sessionId> (parts and manifest add their own suffix)
 // Reusing configReader::getExpectedConfigPath
 std::string C3DRecorder::buildOutputPath(const UploaderConfig& cfg) {
     std::string cfgPath;
@@ -66,35 +78,125 @@ std::string C3DRecorder::buildOutputPath(const UploaderConfig& cfg) {
     }
 
     std::string sid = sanitizeSessionId(cfg.sessionId);
-    std::string path = dir + "/session_" + sid + ".c3d";
+    std::string path = dir + "/session_" + sid;
     return path;
 }
 
+std::string C3DRecorder::outputDir() const {
+    return basePath_.substr(0, basePath_.find_last_of('/'));
+}
+
+// Staging directory in internal storage, or "" (no staging) if it cannot be created.
+// C3D files left there by a session that never finished are queued to be moved right away.
+std::string C3DRecorder::buildStageDir() {
+    std::string internal;
+    if (!configReader::getInternalFilesDir(internal)) return "";
+    const std::string dir = internal + "/c3d_stage";
+    if (::mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST) {
+        LOGE("C3DRecorder: cannot create staging dir '%s': %s", dir.c_str(), strerror(errno));
+        return "";
+    }
+    mover_.start();
+    if (DIR* d = ::opendir(dir.c_str())) {
+        while (dirent* e = ::readdir(d)) {
+            const std::string name = e->d_name;
+            if (name.compare(0, 8, "session_") == 0) {
+                LOGI("C3DRecorder: moving leftover '%s' from a previous session", name.c_str());
+                mover_.enqueue(dir + "/" + name, outputDir());
+            }
+        }
+        ::closedir(d);
+    }
+    return dir;
+}
+
+std::string C3DRecorder::partFileName(uint32_t index) const {
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), "_part%03u.c3d", index);
+    size_t slash = basePath_.find_last_of('/');
+    return (slash == std::string::npos ? basePath_ : basePath_.substr(slash + 1)) + suffix;
+}
+
 bool C3DRecorder::C3Dinitialize(const UploaderConfig& cfg, int frameRate) {
-    std::lock_guard<std::mutex> lock(mtx_);
-    if (initialized_) {
-        LOGI("C3DRecorder already initialized, ignoring.");
-        return true;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (initialized_ && !finalized_) {
+            LOGI("C3DRecorder already initialized, ignoring.");
+            return true;
+        }
     }
+    // A previous session may still be closing its files in the background.
+    if (writerThread_.joinable()) writerThread_.join();
 
-    filePath_ = buildOutputPath(cfg);
-    if (filePath_.empty()) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    basePath_ = buildOutputPath(cfg);
+    if (basePath_.empty()) {
         LOGE("C3DRecorder: empty file path, disabling C3D recording");
         initialized_ = false;
         return false;
     }
+    sessionId_ = cfg.sessionId;
+    stageDir_ = cfg.stageInternal ? buildStageDir() : "";
+    moveFailuresAtStart_ = mover_.failures();
 
     frameRate_ = frameRate;
     if (frameRate_ <= 0) frameRate_ = 60;
+    // A part never goes over the 16-bit last frame of the C3D header.
+    partMaxFrames_ = (uint32_t)std::min(std::max(cfg.c3dPartFrames, 1), 0xFFFF);
+    partMaxSeconds_ = cfg.c3dPartSeconds > 0 ? (double)cfg.c3dPartSeconds : 0.0;
+    convertThreads_ = C3DConvertPool::resolveThreads(cfg.c3dConvertThreads);
+    checkpointSeconds_ = std::max(cfg.c3dCheckpointSeconds, 0);
+    writer_.setIoBackend(cfg.ioBackend);
+
+    // Same layout for every part.
+    layout_ = C3DWriter::Layout();
+    buildPointNames(layout_.pointNames);
+    buildAnalogNames(layout_.analogNames);
+    layout_.analogUnits.assign(layout_.analogNames.size(), "");
+    layout_.analogUnits.back() = "s"; // RealTime
+    layout_.frameRate = static_cast<float>(frameRate_);
+    // int16 storage: the quaternion channels have a known +-1 range and RealTime is written relative to the
+    // part start (absolute start in the manifest) over the longest a part can last. The point scale comes
+    // from the config or, if 0, from the first frames of each part.
+    if (cfg.c3dFormat == "int16") {
+        C3DWriter::IntegerFormat& fmt = layout_.integer;
+        fmt.enabled = true;
+        fmt.pointScale = cfg.c3dPointResolutionUm * 0.001f;
+        fmt.analogScales.assign(layout_.analogNames.size(), 1.0f / kQuatIntRange);
+        fmt.analogOffsets.assign(layout_.analogNames.size(), 0);
+        // Without a time limit the part lasts partMaxFrames_ frames, with margin for a lower real frame rate
+        const double partSpan = partMaxSeconds_ > 0.0 ? partMaxSeconds_ : 2.0 * partMaxFrames_ / frameRate_;
+        fmt.analogScales.back() = (float)(partSpan / 65534.0);
+        fmt.analogOffsets.back() = -32767; // raw -32767 = part start
+    }
+
+    // First part is opened now so a bad path is reported here, later parts by the writer thread.
+    parts_.clear();
+    partIndex_ = 0;
+    if (!openPart()) {
+        LOGE("C3DRecorder: cannot open first part, disabling C3D recording");
+        return false;
+    }
+
+    block_.clear();
+    block_.reserve(kBlockFrames);
+    pending_.reset(kMaxPendingBlocks + 1);
+    droppedFrames_ = 0;
+    statFramesRecorded_.store(0, std::memory_order_relaxed);
+    statFramesDropped_.store(0, std::memory_order_relaxed);
+    statFramesWritten_.store(0, std::memory_order_relaxed);
+    finalizeLatency_.reset();
+    ioError_ = false;
+    stopWriter_ = false;
+    writerThread_ = std::thread(&C3DRecorder::writerLoop, this);
 
-    frames_.clear();
     finalized_ = false;
     initialized_ = true;
+    status_ = TELEMETRY_C3D_RECORDING;
 
-    LOGI("C3DRecorder initialized. Path='%s', frameRate=%d",
-         filePath_.c_str(), frameRate_);
-
-    // We do not open any file yet; ezc3d will write everything in finalize.
+    LOGI("C3DRecorder initialized. Path='%s_partNNN.c3d', frameRate=%d, part limit %u frames / %.0f s, %s kernels, %zu conversion threads, %s, %s I/O",
+         basePath_.c_str(), frameRate_, partMaxFrames_, partMaxSeconds_, C3DConverter::kernelName(), convertThreads_,
+         layout_.integer.enabled ? "int16" : "float", writer_.ioBackendName());
     return true;
 }
 
@@ -103,31 +205,300 @@ void C3DRecorder::C3DrecordFrame(const VRFrameDataPlain& frame) {
     if (!initialized_ || finalized_) {
         return;
     }
-    frames_.push_back(frame);
+    block_.push_back(frame);
+    statFramesRecorded_.fetch_add(1, std::memory_order_relaxed);
+    if (block_.size() >= kBlockFrames) {
+        handOffBlockLocked(false);
+    }
 }
 
-void C3DRecorder::C3Dflush() {
-    // nothing until longer time session requires it
+void C3DRecorder::handOffBlockLocked(bool closePart) {
+    if (block_.empty() && !closePart) return;
+    if (pending_.size() >= kMaxPendingBlocks) {
+        // Writer is far behind (very slow storage): drop this block instead of growing without limit.
+        droppedFrames_ += block_.size();
+        statFramesDropped_.fetch_add(block_.size(), std::memory_order_relaxed);
+        LOGE("C3DRecorder: writer is behind, dropped %zu frames (total %zu)", block_.size(), droppedFrames_);
+        block_.clear();
+        return;
+    }
+    Block b;
+    b.frames = std::move(block_);
+    b.closePart = closePart;
+    pending_.push_back(std::move(b));
+    if (!freeBlocks_.empty()) {
+        block_ = std::move(freeBlocks_.back());
+        freeBlocks_.pop_back();
+    } else {
+        block_ = std::vector<VRFrameDataPlain>();
+    }
+    block_.clear();
+    block_.reserve(kBlockFrames);
+    writerCv_.notify_one();
 }
 
-void C3DRecorder::C3Dfinalize() {
+void C3DRecorder::writerLoop() {
+    const size_t nbPoints = layout_.pointNames.size();
+    const size_t nbAnalogs = layout_.analogNames.size();
+    const size_t stride = nbPoints * 4 + nbAnalogs;
+    PipelineTrace::setThreadName("c3d writer");
+    AllocScope allocTag(kAllocC3D);
+    convertPool_.start(convertThreads_);
+    const std::chrono::seconds checkpointEvery(checkpointSeconds_);
+    auto nextCheckpoint = std::chrono::steady_clock::now() + checkpointEvery;
+
+    // Record buffers of one batch, reused for the whole session.
+    std::vector<Block> batch;
+    std::vector<std::vector<float>> records;
+    std::vector<C3DConvertPool::Task> tasks;
+    for (;;) {
+        batch.clear();
+        bool checkpointDue = false;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            auto ready = [&]{ return stopWriter_ || !pending_.empty(); };
+            if (checkpointSeconds_ > 0) {
+                writerCv_.wait_until(lock, nextCheckpoint, ready);
+                checkpointDue = std::chrono::steady_clock::now() >= nextCheckpoint;
+                // The frames of the block still being filled go into the checkpoint too
+                if (checkpointDue && !stopWriter_ && pending_.size() < kMaxPendingBlocks) handOffBlockLocked(false);
+            } else {
+                writerCv_.wait(lock, ready);
+            }
+            if (stopWriter_ && pending_.empty()) break; // nothing left
+            // While recording this is usually one block; at finalize or after a slow write it is the backlog.
+            while (!pending_.empty() && batch.size() < kMaxBatchBlocks) {
+                batch.push_back(std::move(pending_.front()));
+                pending_.pop_front();
+            }
+        }
+
+        // Conversion of the whole batch on the pool, then the blocks are appended in queue order.
+        // (Empty when only the checkpoint woke the thread up.)
+        if (records.size() < batch.size()) records.resize(batch.size());
+        tasks.resize(batch.size());
+        for (size_t i = 0; i < batch.size(); ++i) {
+            records[i].resize(batch[i].frames.size() * stride);
+            tasks[i].frames = batch[i].frames.data();
+            tasks[i].n = batch[i].frames.size();
+            tasks[i].records = records[i].data();
+        }
+        if (!batch.empty()) {
+            TraceSpan span("c3d_convert", batch.size());
+            convertPool_.convert(tasks.data(), tasks.size(), nbPoints, nbAnalogs);
+        }
+
+        for (size_t i = 0; i < batch.size(); ++i) {
+            {
+                TraceSpan span("c3d_write", batch[i].frames.size());
+                writeBlock(batch[i].frames, records[i].data());
+            }
+            if (batch[i].closePart && part_.frames > 0) {
+                closePart();
+                openPart();
+            }
+        }
+        {
+            // Keep a couple of blocks for reuse, the rest is freed.
+            std::lock_guard<std::mutex> lock(mtx_);
+            for (auto& b : batch) {
+                if (freeBlocks_.size() < 2) freeBlocks_.push_back(std::move(b.frames));
+            }
+        }
+        if (checkpointDue) {
+            TraceSpan span("c3d_checkpoint");
+            checkpointPart();
+            nextCheckpoint = std::chrono::steady_clock::now() + checkpointEvery;
+        }
+    }
+    convertPool_.stop();
+    finishSession();
+}
+
+void C3DRecorder::finishSession() {
+    closePart();
+    if (!stageDir_.empty()) {
+        // The session is done (and the manifest says so) only once every part is in the output dir
+        mover_.waitIdle(-1);
+        if (mover_.failures() != moveFailuresAtStart_) {
+            LOGE("C3DRecorder: some parts could not be moved out of '%s'", stageDir_.c_str());
+            ioError_ = true;
+        }
+    }
+    writeManifest(true);
+    uint64_t total = 0;
+    for (const auto& p : parts_) total += p.frames;
+    if (parts_.empty()) {
+        LOGI("C3DRecorder: no frames to write, skipping C3D file.");
+    } else {
+        LOGI("C3DRecorder: session written %s: %zu part(s), %llu frames, %zu dropped",
+             ioError_ ? "WITH ERRORS" : "OK", parts_.size(), (unsigned long long)total, droppedFrames_);
+    }
+
+    TelemetryC3DCallback cb;
+    void* user;
+    int status;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        freeBlocks_.clear();
+        finalizeLatency_.recordSince(finalizeStart_);
+        status_ = ioError_ ? TELEMETRY_C3D_FAILED : TELEMETRY_C3D_DONE;
+        status = status_;
+        cb = doneCb_;
+        user = doneUserData_;
+    }
+    statusCv_.notify_all();
+    if (cb) cb(status, user);
+}
+
+void C3DRecorder::C3Dflush() {
     std::lock_guard<std::mutex> lock(mtx_);
     if (!initialized_ || finalized_) {
         return;
     }
+    handOffBlockLocked(true);
+}
 
-    if (frames_.empty()) {
-        LOGI("C3DRecorder: no frames to write, skipping C3D file.");
+void C3DRecorder::C3DfinalizeAsync() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!initialized_ || finalized_) {
+            return;
+        }
+        // From here C3DrecordFrame ignores new frames; the last partial block goes to the writer.
         finalized_ = true;
-        return;
+        status_ = TELEMETRY_C3D_FINALIZING;
+        finalizeStart_ = std::chrono::steady_clock::now();
+        if (!block_.empty()) {
+            Block b;
+            b.frames = std::move(block_);
+            pending_.push_back(std::move(b));
+            block_ = std::vector<VRFrameDataPlain>();
+        }
+        stopWriter_ = true;
     }
+    writerCv_.notify_one();
+}
 
-    LOGI("C3DRecorder: writing C3D file '%s' with %zu frames",
-         filePath_.c_str(), frames_.size());
+void C3DRecorder::C3Dfinalize() {
+    C3DfinalizeAsync();
+    C3DwaitFinalized(-1);
+    if (writerThread_.joinable() && writerThread_.get_id() != std::this_thread::get_id()) {
+        writerThread_.join();
+    }
+}
+
+int C3DRecorder::C3Dstatus() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return status_;
+}
+
+int C3DRecorder::C3DwaitFinalized(int timeoutMs) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    auto finished = [&]{ return status_ != TELEMETRY_C3D_FINALIZING; };
+    if (timeoutMs < 0) {
+        statusCv_.wait(lock, finished);
+    } else {
+        statusCv_.wait_for(lock, std::chrono::milliseconds(timeoutMs), finished);
+    }
+    return status_;
+}
+
+void C3DRecorder::C3DsetCompletionCallback(TelemetryC3DCallback cb, void* userData) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    doneCb_ = cb;
+    doneUserData_ = userData;
+}
+
+bool C3DRecorder::openPart() {
+    part_ = PartInfo();
+    part_.file = partFileName(++partIndex_);
+    // Staged parts are written to internal storage and moved to the output dir once closed
+    const std::string dir = stageDir_.empty() ? outputDir() : stageDir_;
+    // Disk space of a full part is reserved up front
+    uint32_t expectedFrames = partMaxFrames_;
+    if (partMaxSeconds_ > 0.0) expectedFrames = std::min(expectedFrames, (uint32_t)(partMaxSeconds_ * frameRate_) + 1);
+    if (!writer_.open(dir + "/" + part_.file, layout_, expectedFrames)) {
+        LOGE("C3DRecorder: cannot open part '%s'", part_.file.c_str());
+        return false;
+    }
+    // Listed right away, so the part can be found after a crash
+    writeManifest(false);
+    openPartStartListed_ = false;
+    return true;
+}
 
-    writeC3D();
+// Crash safety point (writer thread): the frames of the open part written so far become durable and
+// readable. closePart/finalize do the same at the end of each part.
+void C3DRecorder::checkpointPart() {
+    if (!writer_.isOpen() || part_.frames == 0) return;
+    if (!writer_.checkpoint()) {
+        LOGE("C3DRecorder: checkpoint of part '%s' failed", part_.file.c_str());
+        ioError_ = true;
+    }
+    // Once per part: the manifest gets its start time (origin of RealTime in int16 files)
+    if (!openPartStartListed_) {
+        writeManifest(false);
+        openPartStartListed_ = true;
+    }
+}
+
+// Finalizes the current part (header counts patched, synced) and adds it to the manifest.
+// An empty part is removed instead.
+void C3DRecorder::closePart() {
+    if (!writer_.isOpen()) return;
+    if (part_.frames == 0) {
+        const std::string path = writer_.path();
+        writer_.close();
+        ::unlink(path.c_str());
+        --partIndex_; // the name is reused by the next part
+        return;
+    }
+    const std::string path = writer_.path();
+    if (!writer_.finalize()) {
+        LOGE("C3DRecorder: could not finalize part '%s'", part_.file.c_str());
+        ioError_ = true;
+    }
+    if (!stageDir_.empty()) mover_.enqueue(path, outputDir());
+    parts_.push_back(part_);
+    writeManifest(false);
+    LOGI("C3DRecorder: part '%s' closed (%u frames, %.2f s - %.2f s)",
+         part_.file.c_str(), part_.frames, part_.startSec, part_.endSec);
+}
 
-    finalized_ = true;
+void C3DRecorder::writeManifest(bool complete) const {
+    const std::string path = basePath_ + "_manifest.json";
+    const std::string tmp = path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "w");
+    if (!f) {
+        LOGE("C3DRecorder: cannot write manifest '%s'", tmp.c_str());
+        return;
+    }
+    // sessionId comes from the engine: escape what would break the JSON string
+    std::string sid;
+    for (char c : sessionId_) {
+        if (c == '"' || c == '\\') sid += '\\';
+        if ((unsigned char)c >= 0x20) sid += c;
+    }
+    fprintf(f, "{\"sessionId\":\"%s\",\"frameRate\":%d,\"complete\":%s,\"parts\":[",
+            sid.c_str(), frameRate_, complete ? "true" : "false");
+    for (size_t i = 0; i < parts_.size(); ++i) {
+        const PartInfo& p = parts_[i];
+        fprintf(f, "%s{\"file\":\"%s\",\"frames\":%u,\"startSec\":%.6f,\"endSec\":%.6f}",
+                i ? "," : "", p.file.c_str(), p.frames, p.startSec, p.endSec);
+    }
+    // Part still being written: its frame count is the one in its C3D header (last checkpoint)
+    if (writer_.isOpen()) {
+        fprintf(f, "%s{\"file\":\"%s\",\"open\":true", parts_.empty() ? "" : ",", part_.file.c_str());
+        if (part_.frames > 0) fprintf(f, ",\"startSec\":%.6f", part_.startSec);
+        fprintf(f, "}");
+    }
+    fprintf(f, "]}\n");
+    const bool ok = fflush(f) == 0 && fsync(fileno(f)) == 0;
+    fclose(f);
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        LOGE("C3DRecorder: cannot replace manifest '%s'", path.c_str());
+    }
 }
 
 // OpenXRHandJoints names, but changing palm and wrist order bc thats how its received via unity/unreal
@@ -214,524 +585,41 @@ void C3DRecorder::buildAnalogNames(std::vector<std::string>& outAnalogNames) con
     outAnalogNames.emplace_back("RealTime");
 }
 
-// helper to calculate 2 points from center-eye to match Gait Model front head points
-// First we rotate the given vector so we can add a fixed width
-void calculateHeadWidth(const VRPosePlain& midPos,Vector3& pointRight,Vector3& pointLeft, float headWidth) {
-
-    const float halfWidth = headWidth / 2.0f;
-
-    // Extract quaternion components
-    float qx = midPos.rotation[0], qy =  midPos.rotation[1], qz =  midPos.rotation[2], qw =  midPos.rotation[3];
-
-    // Lateral vector in local head space
-    Vector3 vLocal;
-    vLocal.x = halfWidth; vLocal.y = 0.0f; vLocal.z = 0.0f;
-
-    // Vector part of the quaternion
-    Vector3 qv;
-    qv.x = qx; qv.y = qy; qv.z = qz;
-
-    // t = 2 * cross(qv, vLocal)
-    Vector3 t;
-    t.x = 2.0f * (qv.y * vLocal.z - qv.z * vLocal.y);
-    t.y = 2.0f * (qv.z * vLocal.x - qv.x * vLocal.z);
-    t.z = 2.0f * (qv.x * vLocal.y - qv.y * vLocal.x);
-
-    // vWorld = vLocal + qw * t + cross(qv, t)
-    Vector3 vWorld;
-    vWorld.x = vLocal.x + qw * t.x + (qv.y * t.z - qv.z * t.y);
-    vWorld.y = vLocal.y + qw * t.y + (qv.z * t.x - qv.x * t.z);
-    vWorld.z = vLocal.z + qw * t.z + (qv.x * t.y - qv.y * t.x);
-
-    Vector3 worldOffset = vWorld;
-
-    // Apply to the head position
-    pointRight = {
-            midPos.position[0] + worldOffset.x,
-            midPos.position[1] + worldOffset.y,
-            midPos.position[2] + worldOffset.z
-    };
-
-    pointLeft = {
-            midPos.position[0] - worldOffset.x,
-            midPos.position[1] - worldOffset.y,
-            midPos.position[2] - worldOffset.z
-    };
-}
-
-//Same concept as HeadWith, but this time the data parameter is different
-void calculateWristWidthFromJoint(const JointSamplePlain& joint, Vector3& pointRight, Vector3& pointLeft, float wristWidth) {
-    const float halfWidth = wristWidth / 2.0f;
-
-    float qx = joint.qx;
-    float qy = joint.qy;
-    float qz = joint.qz;
-    float qw = joint.qw;
-
-    // Vector lateral en el sistema local de la muneca
-    Vector3 vLocal;
-    vLocal.x = halfWidth; vLocal.y = 0.0f; vLocal.z = 0.0f;
-
-    // Parte vectorial del cuaternion
-    Vector3 qv;
-    qv.x = qx; qv.y = qy; qv.z = qz;
-
-    // t = 2 * cross(qv, vLocal)
-    Vector3 t;
-    t.x = 2.0f * (qv.y * vLocal.z - qv.z * vLocal.y);
-    t.y = 2.0f * (qv.z * vLocal.x - qv.x * vLocal.z);
-    t.z = 2.0f * (qv.x * vLocal.y - qv.y * vLocal.x);
-
-    // vWorld = vLocal + qw * t + cross(qv, t)
-    Vector3 vWorld;
-    vWorld.x = vLocal.x + qw * t.x + (qv.y * t.z - qv.z * t.y);
-    vWorld.y = vLocal.y + qw * t.y + (qv.z * t.x - qv.x * t.z);
-    vWorld.z = vLocal.z + qw * t.z + (qv.x * t.y - qv.y * t.x);
-
-    // Aplicar a la posicion del joint
-    pointRight = {
-            joint.px + vWorld.x,
-            joint.py + vWorld.y,
-            joint.pz + vWorld.z
-    };
-
-    pointLeft = {
-            joint.px - vWorld.x,
-            joint.py - vWorld.y,
-            joint.pz - vWorld.z
-    };
-}
-
-// Convert from meters to millimeters (could be left as it is, but mm is more common with c3d files)
-inline void metersToMillimeters(float& x, float& y, float& z) {
-    const float k = 1000.0f;
-    x *= k;
-    y *= k;
-    z *= k;
-}
-inline void metersToMillimeters(Vector3& v) {
-    metersToMillimeters(v.x, v.y, v.z);
-}
-
-// // Axis conversion OpenXR -> Gait: X_g = -Z_old (towards)  Y_g = -X_old (left)  Z_g =  Y_old (up)
-inline void openxrToGaitAxes(float& x, float& y, float& z) {
-    const float ox = x;
-    const float oy = y;
-    const float oz = z;
-
-    x = -oz;  // delantero +
-    y = -ox;  // izquierda +
-    z =  oy;  // arriba +
-}
-inline void openxrToGaitAxes(Vector3& v) {
-    openxrToGaitAxes(v.x, v.y, v.z);
-}
-
-// Quaternion multiplication q_out = q_a * q_b (Hamilton product). Used in next method
-inline void quatMul(const float ax, const float ay, const float az, const float aw,
-                    const float bx, const float by, const float bz, const float bw,
-                    float& rx, float& ry, float& rz, float& rw) {
-    rx = aw*bx + ax*bw + ay*bz - az*by;
-    ry = aw*by - ax*bz + ay*bw + az*bx;
-    rz = aw*bz + ax*by - ay*bx + az*bw;
-    rw = aw*bw - ax*bx - ay*by - az*bz;
-}
-
-// Apply OpenXR -> Gait axis change to a quaternion (x,y,z,w).
-inline void openxrToGaitAxesQuat(float& qx, float& qy, float& qz, float& qw) {
-    // Cuaternion fijo que implementa la misma transformacion que openxrToGaitAxes en vectores
-    const float ax =  0.5f;
-    const float ay = -0.5f;
-    const float az = -0.5f;
-    const float aw =  0.5f;
-
-    float rx, ry, rz, rw;
-    quatMul(ax, ay, az, aw, qx, qy, qz, qw, rx, ry, rz, rw);
-
-    qx = rx;
-    qy = ry;
-    qz = rz;
-    qw = rw;
-}
-
-// Main function that builds an ezc3d::c3d object in memory and writes it to disk
-// using the information stored in frames_
-void C3DRecorder::writeC3D() {
-    // Create an empty C3D
-    ezc3d::c3d c3d;
-
-    // Point and analog channel names
-    std::vector<std::string> pointNames;
-    std::vector<std::string> analogNames;
-    buildPointNames(pointNames);
-    buildAnalogNames(analogNames);
-
-    const size_t nbPoints  = pointNames.size();
-    const size_t nbAnalogs = analogNames.size();
-    const size_t nbFrames  = frames_.size();
-
-    // Declare points and analog channels so that parameters are consistent.
-    for (const auto& name : pointNames) {
-        c3d.point(name);
-    }
-    for (const auto& name : analogNames) {
-        c3d.analog(name);
-    }
-
-    // Basic RATE and UNITS parameters
-    {
-        // POINT:UNITS
-        ezc3d::ParametersNS::GroupNS::Parameter pointUnits("UNITS");
-        pointUnits.set(std::vector<std::string>{"mm"});
-        c3d.parameter("POINT", pointUnits);
-        // POINT:RATE
-        ezc3d::ParametersNS::GroupNS::Parameter pointRate("RATE");
-        pointRate.set(std::vector<double>{ static_cast<double>(frameRate_) });
-        c3d.parameter("POINT", pointRate);
-
-        // ANALOG:RATE = frameRate as well (1 analog sample per frame).
-        ezc3d::ParametersNS::GroupNS::Parameter analogRate("RATE");
-        analogRate.set(std::vector<double>{ static_cast<double>(frameRate_) });
-        c3d.parameter("ANALOG", analogRate);
-    }
-
-    // For each recorded frame, create a C3D frame and fill points + analogs.
-    for (size_t i = 0; i < nbFrames; ++i) {
-        const VRFrameDataPlain& f = frames_[i];
-
-        ezc3d::DataNS::Frame frame;
-
-        // --- Puntos 3D ---
-        {
-            using ezc3d::DataNS::Points3dNS::Point;
-            using ezc3d::DataNS::Points3dNS::Points;
-
-            Points points(nbPoints);
-
-            // Start by setting all points to (0,0,0) with residual -1 (missing marker).
-            for (size_t pi = 0; pi < nbPoints; ++pi) {
-                Point p;
-                p.x(0.0);
-                p.y(0.0);
-                p.z(0.0);
-                p.residual(-1.0);
-                points.point(p, static_cast<int>(pi));
-            }
-
-            // Indices consistent with buildPointNames()
-            const size_t IDX_HEAD        = 0;
-            const size_t IDX_LFHD        = 1;
-            const size_t IDX_RFHD        = 2;
-            const size_t IDX_L_HAND_BASE = 3;                        // 26 joints L
-            const size_t IDX_R_HAND_BASE = IDX_L_HAND_BASE + 26;     // 26 joints R
-            const int FIN_JOINT_INDEX = 7; // en kHandJointNames[7] = "FIN"
-            const size_t IDX_LFIN = IDX_L_HAND_BASE + FIN_JOINT_INDEX;
-            const size_t IDX_RFIN = IDX_R_HAND_BASE + FIN_JOINT_INDEX;
-            const size_t IDX_LWRA        = IDX_R_HAND_BASE + 26;
-            const size_t IDX_LWRB        = IDX_LWRA + 1;
-            const size_t IDX_RWRA        = IDX_LWRA + 2;
-            const size_t IDX_RWRB        = IDX_LWRA + 3;
-
-            // HMD (HEAD)
-            {
-                float x = f.hmdPose.position[0];
-                float y = f.hmdPose.position[1];
-                float z = f.hmdPose.position[2];
-
-                openxrToGaitAxes(x, y, z);
-                metersToMillimeters(x, y, z);
-
-                Point p;
-                p.x(x);
-                p.y(y);
-                p.z(z);
-                p.residual(0.0);
-                points.point(p, static_cast<int>(IDX_HEAD));
-            }
-
-            // Extra head markers LFHD / RFHD from head width
-            Vector3 headRight, headLeft;
-            calculateHeadWidth(f.hmdPose, headRight, headLeft, 0.15f);
-
-            // LFHD = left side
-            openxrToGaitAxes(headLeft);
-            metersToMillimeters(headLeft);
-            {
-                Point p;
-                p.x(headLeft.x);
-                p.y(headLeft.y);
-                p.z(headLeft.z);
-                p.residual(0.0);
-                points.point(p, static_cast<int>(IDX_LFHD));
-            }
-
-            // RFHD = right side
-            openxrToGaitAxes(headRight);
-            metersToMillimeters(headRight);
-            {
-                Point p;
-                p.x(headRight.x);
-                p.y(headRight.y);
-                p.z(headRight.z);
-                p.residual(0.0);
-                points.point(p, static_cast<int>(IDX_RFHD));
-            }
-
-            // L_CTRL (if its valid it will have 0 joints but we do a double check)
-            if (f.leftCtrl.isActive && f.leftHandJointCount==0) {
-                float x = f.leftCtrl.pose.position[0];
-                float y = f.leftCtrl.pose.position[1];
-                float z = f.leftCtrl.pose.position[2];
-
-                const bool isZero = (x == 0.0f && y == 0.0f && z == 0.0f);
-                openxrToGaitAxes(x, y, z);
-                metersToMillimeters(x, y, z);
-
-                if (!isZero) {
-                    Point p;
-                    p.x(x);
-                    p.y(y);
-                    p.z(z);
-                    p.residual(0.0);
-                    points.point(p, static_cast<int>(IDX_LFIN));
-                }
-            }
-
-            // R_CTRL (if active)
-            if (f.rightCtrl.isActive && f.rightHandJointCount==0) {
-                float x = f.rightCtrl.pose.position[0];
-                float y = f.rightCtrl.pose.position[1];
-                float z = f.rightCtrl.pose.position[2];
-                const bool isZero = (x == 0.0f && y == 0.0f && z == 0.0f);
-
-                openxrToGaitAxes(x, y, z);
-                metersToMillimeters(x, y, z);
-
-                if (!isZero) {
-                    Point p;
-                    p.x(x);
-                    p.y(y);
-                    p.z(z);
-                    p.residual(0.0);
-                    points.point(p, static_cast<int>(IDX_RFIN));
-                }
-            }
-
-            // Hands: joints L
-            for (int j = 0; j < f.leftHandJointCount && j < 26; ++j) {
-                const auto& s = f.leftHandJoints[j];
-                float x = s.px;
-                float y = s.py;
-                float z = s.pz;
-
-                const bool isZero = (x == 0.0f && y == 0.0f && z == 0.0f);
-                openxrToGaitAxes(x, y, z);
-                metersToMillimeters(x, y, z);
-
-                if(!isZero) {
-                    Point p;
-                    p.x(x);
-                    p.y(y);
-                    p.z(z);
-                    p.residual(s.hasPose ? 0.0 : -1.0);
-                    points.point(p, static_cast<int>(IDX_L_HAND_BASE + j));
-                }
-            }
-
-            // Hands: joints R
-            for (int j = 0; j < f.rightHandJointCount && j < 26; ++j) {
-                const auto& s = f.rightHandJoints[j];
-                float x = s.px;
-                float y = s.py;
-                float z = s.pz;
-
-                const bool isZero = (x == 0.0f && y == 0.0f && z == 0.0f);
-                openxrToGaitAxes(x, y, z);
-                metersToMillimeters(x, y, z);
-
-                if(!isZero) {
-                    Point p;
-                    p.x(x);
-                    p.y(y);
-                    p.z(z);
-                    p.residual(s.hasPose ? 0.0 : -1.0);
-                    points.point(p, static_cast<int>(IDX_R_HAND_BASE + j));
-                }
-            }
-
-            // Extra wrist points LWRA/LWRB/RWRA/RWRB
-            // Left hand: joint 0 = WRIST
-            if (f.leftHandJointCount > 0) {
-                const auto& wrist = f.leftHandJoints[0];
-                if (wrist.hasPose) {
-                    Vector3 wra, wrb;
-                    calculateWristWidthFromJoint(wrist, wra, wrb, 0.06f);
-
-                    const bool isZero = (wrist.px == 0.0f && wrist.py == 0.0f && wrist.pz == 0.0f);
-                    openxrToGaitAxes(wra);
-                    metersToMillimeters(wra);
-                    openxrToGaitAxes(wrb);
-                    metersToMillimeters(wrb);
-
-                    if(!isZero){
-                        Point p;
-                        p.x(wra.x);
-                        p.y(wra.y);
-                        p.z(wra.z);
-                        p.residual(0.0);
-                        points.point(p, static_cast<int>(IDX_LWRA));
-                    }
-                    if(!isZero){
-                        Point p;
-                        p.x(wrb.x);
-                        p.y(wrb.y);
-                        p.z(wrb.z);
-                        p.residual(0.0);
-                        points.point(p, static_cast<int>(IDX_LWRB));
-                    }
-                }
-            }
-
-            // Right hand
-            if (f.rightHandJointCount > 0) {
-                const auto& wrist = f.rightHandJoints[0];
-                if (wrist.hasPose) {
-                    Vector3 wra, wrb;
-                    calculateWristWidthFromJoint(wrist, wra, wrb, 0.06f);
-
-                    const bool isZero = (wrist.px == 0.0f && wrist.py == 0.0f && wrist.pz == 0.0f);
-                    openxrToGaitAxes(wra);
-                    metersToMillimeters(wra);
-                    openxrToGaitAxes(wrb);
-                    metersToMillimeters(wrb);
-
-                    // OJO: invertimos A/B para que RWRA/RWRB no queden cruzados
-                    if(!isZero){
-                        Point p;
-                        p.x(wrb.x);
-                        p.y(wrb.y);
-                        p.z(wrb.z);
-                        p.residual(0.0);
-                        points.point(p, static_cast<int>(IDX_RWRA));
-                    }
-                    if(!isZero){
-                        Point p;
-                        p.x(wra.x);
-                        p.y(wra.y);
-                        p.z(wra.z);
-                        p.residual(0.0);
-                        points.point(p, static_cast<int>(IDX_RWRB));
-                    }
-                }
-            }
-
-            frame.points() = points;
+// Appends a converted block to the current part (writer thread).
+// The block is cut wherever the part reaches its frame or time limit.
+void C3DRecorder::writeBlock(const std::vector<VRFrameDataPlain>& frames, float* records) {
+    const size_t stride = layout_.pointNames.size() * 4 + layout_.analogNames.size();
+    const bool relativeTime = layout_.integer.enabled;
+    TELEMETRIA_PROBE2(c3d_block_start, partIndex_, frames.size());
+
+    size_t runStart = 0; // first frame not appended yet
+    auto appendRun = [&](size_t end) {
+        if (end == runStart) return;
+        const size_t n = end - runStart;
+        if (!writer_.isOpen() || !writer_.appendFrames(records + runStart * stride, n)) {
+            LOGE("C3DRecorder: failed to append %zu frames to '%s'", n, part_.file.c_str());
+            ioError_ = true;
+            statFramesDropped_.fetch_add(n, std::memory_order_relaxed);
+        } else {
+            statFramesWritten_.fetch_add(n, std::memory_order_relaxed);
         }
+        runStart = end;
+    };
 
-        // --- Analogs (cuaterniones + flag) ---
-        {
-            using ezc3d::DataNS::AnalogsNS::Channel;
-            using ezc3d::DataNS::AnalogsNS::SubFrame;
-            using ezc3d::DataNS::AnalogsNS::Analogs;
-            const size_t nbAnalogs = analogNames.size();
-            // Single subframe per frame (ANALOG:RATE == POINT:RATE)
-            SubFrame subframe;
-            subframe.nbChannels(nbAnalogs);
-
-            auto setChan = [&](size_t idx, float value) {
-                Channel ch;
-                ch.data(value);
-                subframe.channel(ch, idx);
-            };
-
-            size_t idx = 0;
-
-            // HMD quaternion
-            {
-                float qx = f.hmdPose.rotation[0];
-                float qy = f.hmdPose.rotation[1];
-                float qz = f.hmdPose.rotation[2];
-                float qw = f.hmdPose.rotation[3];
-
-                openxrToGaitAxesQuat(qx, qy, qz, qw);
-
-                setChan(idx++, qx);
-                setChan(idx++, qy);
-                setChan(idx++, qz);
-                setChan(idx++, qw);
-            }
-
-            // L_CTRL quaternion
-            if (f.leftCtrl.isActive && f.leftHandJointCount==0){
-                float qx = f.leftCtrl.pose.rotation[0];
-                float qy = f.leftCtrl.pose.rotation[1];
-                float qz = f.leftCtrl.pose.rotation[2];
-                float qw = f.leftCtrl.pose.rotation[3];
-
-                openxrToGaitAxesQuat(qx, qy, qz, qw);
-
-                setChan(idx++, qx);
-                setChan(idx++, qy);
-                setChan(idx++, qz);
-                setChan(idx++, qw);
-            }
-
-            // R_CTRL quaternion
-            if (f.rightCtrl.isActive && f.rightHandJointCount==0){
-                float qx = f.rightCtrl.pose.rotation[0];
-                float qy = f.rightCtrl.pose.rotation[1];
-                float qz = f.rightCtrl.pose.rotation[2];
-                float qw = f.rightCtrl.pose.rotation[3];
-
-                openxrToGaitAxesQuat(qx, qy, qz, qw);
-
-                setChan(idx++, qx);
-                setChan(idx++, qy);
-                setChan(idx++, qz);
-                setChan(idx++, qw);
-            }
-
-            // L_Joints quaternion
-            for (int j = 0; j < f.leftHandJointCount && j < 26; ++j) {
-                const auto& s = f.leftHandJoints[j];
-                float qx = s.qx, qy = s.qy, qz = s.qz, qw = s.qw;
-                openxrToGaitAxesQuat(qx, qy, qz, qw);
-                setChan(idx++, qx);
-                setChan(idx++, qy);
-                setChan(idx++, qz);
-                setChan(idx++, qw);
-            }
-            // R_Joints quaternion
-            for (int j = 0; j < f.rightHandJointCount && j < 26; ++j) {
-                const auto& s = f.rightHandJoints[j];
-                float qx = s.qx, qy = s.qy, qz = s.qz, qw = s.qw;
-                openxrToGaitAxesQuat(qx, qy, qz, qw);
-                setChan(idx++, qx);
-                setChan(idx++, qy);
-                setChan(idx++, qz);
-                setChan(idx++, qw);
-            }
-
-            while (idx + 1 < nbAnalogs) { // we leave the last for Realtime
-                setChan(idx++, 0.0f);
-            }
-
-            // Extra channel for real time
-            if (nbAnalogs > 0) {
-                const size_t timeIdx = nbAnalogs - 1; // always last no matter size
-                setChan(timeIdx, static_cast<float>(f.timestampSec));
-            }
-
-            Analogs analogs;
-            analogs.subframe(subframe, 0);
-            frame.analogs() = analogs;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        const VRFrameDataPlain& f = frames[i];
+        const bool full = part_.frames >= partMaxFrames_ ||
+                          (partMaxSeconds_ > 0.0 && part_.frames > 0 && f.timestampSec - part_.startSec >= partMaxSeconds_);
+        if (full) {
+            appendRun(i);
+            closePart();
+            openPart();
         }
-
-        // Here we finally add the frame to c3d file
-        c3d.frame(frame);
+        if (part_.frames == 0) part_.startSec = f.timestampSec;
+        part_.endSec = f.timestampSec;
+        if (relativeTime) records[i * stride + stride - 1] = (float)(f.timestampSec - part_.startSec);
+        ++part_.frames;
     }
-
-    // Last, write the full c3d file to disk
-    c3d.write(filePath_);
-    LOGI("C3DRecorder: file written OK: '%s'", filePath_.c_str());
+    appendRun(frames.size());
+    TELEMETRIA_PROBE3(c3d_block_end, partIndex_, frames.size(), part_.frames);
 }
@@ -2,12 +2,34 @@
 #include <string>
 #include <vector>
 #include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
 
 #include "TiposTelemetria.h"
 #include "TiposVR.h"
+#include "C3DWriter.h"
+#include "C3DConvertPool.h"
+#include "FixedRing.h"
+#include "FileMover.h"
+#include "LatencyHistogram.h"
 
-// Small helper that records one C3D file per VR session.
+// Small helper that records the C3D files of a VR session.
 // It is called from TelemetriaAPI: initialize -> recordFrame (many times) -> finalize.
+// The file is written while recording: frames are grouped in blocks, and a background thread converts
+// each full block into C3D records and appends it to the file, so memory does not grow with the session.
+// When several blocks are waiting (finalize, or a writer that fell behind) they are converted together on
+// a small worker pool (c3dConvertThreads) and then appended in order.
+//
+// Long sessions are split in parts (session_<id>_part001.c3d, _part002...), because the C3D header only
+// stores a 16-bit last frame. A part is closed when it reaches c3dPartFrames or c3dPartSeconds, and
+// session_<id>_manifest.json lists every part with its frame count and time range.
+// Every c3dCheckpointSeconds the open part (including the block still being filled) is synced and its header
+// counts patched, so if the app is killed or the battery dies the files on disk are valid C3D files missing
+// at most the last interval; the manifest lists the open part with "open": true.
+// With stageInternal the parts are written to internal storage (c3d_stage) and moved to the output dir
+// by a low-priority FileMover thread as each one is closed; the manifest is always in the output dir.
+// With c3dFormat "int16" the parts store quantized int16 records instead of floats (see C3DWriter.h).
 
 class C3DRecorder {
 public:
@@ -23,32 +45,115 @@ public:
     bool C3Dinitialize(const UploaderConfig& cfg, int frameRate);
 
     // Records a single frame of VR data (HMD, controllers, hands).
-    // The frame is simply pushed into an internal vector and will be converted into C3D data later when finalize is called.
+    // The frame is copied into the current block; full blocks are handed to the writer thread.
     void C3DrecordFrame(const VRFrameDataPlain& frame);
 
-    // Later on, if larger time sessions are needed, the C3D will be split into multiple files.
+    // Closes the current part right after the frames recorded so far; the next frame starts a new part.
+    // Closing happens on the writer thread, this call only hands the block off.
     void C3Dflush();
 
-    // Finalizes the recorder and writes the C3D file to disk. Calling it more than once is safe
+    // Writes the frames still in memory, closes the last part (patching its frame count) and marks the
+    // manifest as complete, waiting until it is done. Calling it more than once is safe
     void C3Dfinalize();
 
+    // Same as C3Dfinalize but returns right after handing the last block to the writer thread, which
+    // closes the files in the background. Progress: C3Dstatus(), C3DwaitFinalized() or the callback.
+    void C3DfinalizeAsync();
+
+    // Current TelemetryC3DStatus.
+    int C3Dstatus() const;
+
+    // Waits until finalization ends or timeoutMs elapses (negative = no limit). Returns the status at that point.
+    int C3DwaitFinalized(int timeoutMs);
+
+    // Callback run on the writer thread when finalization ends (nullptr to remove it).
+    void C3DsetCompletionCallback(TelemetryC3DCallback cb, void* userData);
+
     // Returns true if the recorder has been successfully initialized.
     bool C3DisInitialized() const;
 
+    // Fills the C3D fields of out and adds the memory held by queued frames to out.memoryBytes (lock free).
+    void C3DgetStats(TelemetryStatsPlain& out) const;
+    // Fills the c3dFinalize latency of out (lock free).
+    void C3DgetLatency(TelemetryLatencyStatsPlain& out) const;
+
+    // Frames per block handed to the writer thread (~2.5 KB per frame).
+    static constexpr size_t kBlockFrames = 256;
+
 private:
-    // Mutex protecting internal state (file path, flags, frame buffer).
+    // Blocks allowed to wait for the writer; beyond that new blocks are dropped (disk is not keeping up).
+    static constexpr size_t kMaxPendingBlocks = 32;
+    // Blocks the writer takes from the queue at once and converts in parallel (~0.5 MB of records each).
+    static constexpr size_t kMaxBatchBlocks = 8;
+    // int16 storage: quaternion components (+-1) are stored as value * kQuatIntRange.
+    static constexpr float kQuatIntRange = 32000.0f;
+
+    // Mutex protecting internal state (file path, flags, frame blocks).
     mutable std::mutex mtx_;
 
     // Flags to track the lifecycle of the recorder.
     bool initialized_ = false;
     bool finalized_   = false;
+    int status_ = TELEMETRY_C3D_IDLE;
+    std::condition_variable statusCv_;
+    TelemetryC3DCallback doneCb_ = nullptr;
+    void* doneUserData_ = nullptr;
 
-    // Full path of the C3D file that will be written on finalize.
-    std::string filePath_;
+    // Output path without the part suffix: <files>/session_<sessionId>
+    std::string basePath_;
+    // Internal staging dir for the part files, "" = write them directly next to basePath_
+    std::string stageDir_;
+    FileMover mover_;
+    size_t moveFailuresAtStart_ = 0;
+    std::string sessionId_;
     int frameRate_ = 60;
+    // Limits of a part (0 seconds = no time limit)
+    uint32_t partMaxFrames_ = 0xFFFF;
+    double partMaxSeconds_ = 0.0;
+
+    // Frames handed to the writer thread; closePart closes the current part after these frames.
+    struct Block {
+        std::vector<VRFrameDataPlain> frames;
+        bool closePart = false;
+    };
 
-    // We store all frames during the session and then write the C3D complete
-    std::vector<VRFrameDataPlain> frames_;
+    // Block being filled by C3DrecordFrame, full blocks waiting for the writer thread, and empty blocks to reuse.
+    // pending_ has kMaxPendingBlocks slots plus one for the last partial block handed off by finalize.
+    std::vector<VRFrameDataPlain> block_;
+    FixedRing<Block> pending_;
+    std::vector<std::vector<VRFrameDataPlain>> freeBlocks_;
+    size_t droppedFrames_ = 0;
+
+    // Statistics for telemetry_get_stats, relaxed atomics read without mtx_.
+    std::atomic<unsigned long long> statFramesRecorded_{0};
+    std::atomic<unsigned long long> statFramesDropped_{0}; // droppedFrames_ + frames whose append failed
+    std::atomic<unsigned long long> statFramesWritten_{0};
+    // C3DfinalizeAsync until finishSession is done (one sample per session)
+    std::chrono::steady_clock::time_point finalizeStart_;
+    LatencyHistogram finalizeLatency_;
+
+    // Writer thread: converts blocks and appends them to writer_.
+    std::thread writerThread_;
+    std::condition_variable writerCv_;
+    bool stopWriter_ = false;
+    C3DWriter::Layout layout_;
+
+    // Writer thread only: current part and the parts already closed.
+    struct PartInfo {
+        std::string file; // file name, relative to the manifest
+        uint32_t frames = 0;
+        double startSec = 0.0;
+        double endSec = 0.0;
+    };
+    C3DWriter writer_;
+    C3DConvertPool convertPool_;
+    size_t convertThreads_ = 1;
+    int checkpointSeconds_ = 0; // 0 = only at the end of each part
+    PartInfo part_;
+    std::vector<PartInfo> parts_;
+    uint32_t partIndex_ = 0;
+    bool openPartStartListed_ = false; // manifest already has the start time of the open part
+    bool ioError_ = false; // some append/finalize failed, reported as TELEMETRY_C3D_FAILED
 
     // Builds the output file path for the C3D, same path to initialConfig.json
     std::string buildOutputPath(const UploaderConfig& cfg);
@@ -59,6 +164,27 @@ private:
     void buildPointNames(std::vector<std::string>& outPointNames) const;
     void buildAnalogNames(std::vector<std::string>& outAnalogNames) const;
 
-    // The core method to write the C3D file from accumulated frames.
-    void writeC3D();
+    // Moves the current block to the writer queue (mtx_ must be held).
+    void handOffBlockLocked(bool closePart);
+
+    // Writer thread loop, runs until stopWriter_ is set and the queue is empty, then closes the last part.
+    void writerLoop();
+
+    // End of the session on the writer thread: last part, manifest, status and callback.
+    void finishSession();
+
+    // Appends the records of a converted block to the current part, rolling over to a new part whenever
+    // the limits are reached.
+    // In int16 mode the RealTime channel is rewritten relative to the part start.
+    void writeBlock(const std::vector<VRFrameDataPlain>& frames, float* records);
+
+    // Part handling (writer thread, except the first openPart from C3Dinitialize).
+    bool openPart();
+    void closePart();
+    void checkpointPart();
+    std::string partFileName(uint32_t index) const;
+    std::string outputDir() const;
+    std::string buildStageDir();
+    // Rewrites <base>_manifest.json (temporary file + rename, so it is never half written).
+    void writeManifest(bool complete) const;
 };
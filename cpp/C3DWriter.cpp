@@ -0,0 +1,466 @@
+#include "C3DWriter.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#include "TelemetriaLog.h"
+
+// C3D works in 512-byte blocks: block 1 is the header, parameters start at block 2.
+static constexpr size_t kBlockSize = 512;
+static constexpr uint8_t kParamStartBlock = 2;
+static constexpr uint8_t kC3DKey = 0x50;
+static constexpr uint8_t kProcessorIntel = 84;
+
+// Parameter data types
+static constexpr int8_t kTypeChar  = -1;
+static constexpr int8_t kTypeInt16 = 2;
+static constexpr int8_t kTypeFloat = 4;
+
+// Group ids (stored negative in the group record, positive in its parameters)
+static constexpr int8_t kGroupPoint  = 1;
+static constexpr int8_t kGroupAnalog = 2;
+static constexpr int8_t kGroupTrial  = 3;
+
+// Integer mode: quantized values stay within +-kIntRange. Scales chosen from the first frames leave room
+// for values beyond what those frames contain (a player walking away from the origin, a wider gesture).
+static constexpr float kIntRange = 32000.0f;
+static constexpr float kPointHeadroom = 2.0f;     // POINT:SCALE covers twice the largest coordinate seen...
+static constexpr float kMinPointRangeMm = 1000.0f; // ...and at least +-1 m
+static constexpr float kAnalogHeadroom = 4.0f;    // ANALOG:SCALE covers 4 times the range seen around its center
+static constexpr off_t kHeaderScaleOffset = 12;   // header word 7
+
+namespace {
+    // Builds the parameter section in memory. Every group/parameter record has an int16 "offset to next
+    // record", counted from that field; the last record of the section has 0 there.
+    struct ParamSection {
+        std::vector<uint8_t> bytes;
+        size_t lastNextPos = 0; // position of the "next" field of the last record (0 = none yet)
+
+        void put8(int v) { bytes.push_back((uint8_t)(v & 0xFF)); }
+        void put16(int v) { put8(v); put8(v >> 8); }
+        void putStr(const std::string& s) { bytes.insert(bytes.end(), s.begin(), s.end()); }
+
+        ParamSection() {
+            // Section header: reserved, key, number of blocks (patched by finish), processor type
+            put8(1); put8(kC3DKey); put8(0); put8(kProcessorIntel);
+        }
+
+        void beginRecord(int8_t id, const std::string& name) {
+            linkPrevious();
+            put8((int)name.size());
+            put8(id);
+            putStr(name);
+            lastNextPos = bytes.size();
+            put16(0);
+        }
+
+        void linkPrevious() {
+            if (lastNextPos == 0) return;
+            const size_t off = bytes.size() - lastNextPos;
+            bytes[lastNextPos] = (uint8_t)(off & 0xFF);
+            bytes[lastNextPos + 1] = (uint8_t)((off >> 8) & 0xFF);
+        }
+
+        void group(int8_t id, const std::string& name, const std::string& desc) {
+            beginRecord((int8_t)-id, name);
+            put8((int)desc.size());
+            putStr(desc);
+        }
+
+        // Returns the position of the parameter data inside the section.
+        size_t param(int8_t group, const std::string& name, int8_t type, const std::vector<int>& dims,
+                     const void* data, size_t dataBytes, const std::string& desc = "") {
+            beginRecord(group, name);
+            put8(type);
+            put8((int)dims.size());
+            for (int d : dims) put8(d);
+            const size_t dataPos = bytes.size();
+            const uint8_t* p = static_cast<const uint8_t*>(data);
+            bytes.insert(bytes.end(), p, p + dataBytes);
+            put8((int)desc.size());
+            putStr(desc);
+            return dataPos;
+        }
+
+        size_t paramInt16(int8_t group, const std::string& name, int16_t v, const std::string& desc = "") {
+            return param(group, name, kTypeInt16, {}, &v, sizeof(v), desc);
+        }
+        size_t paramFloat(int8_t group, const std::string& name, float v, const std::string& desc = "") {
+            return param(group, name, kTypeFloat, {}, &v, sizeof(v), desc);
+        }
+        size_t paramString(int8_t group, const std::string& name, const std::string& v) {
+            const std::string s = v.empty() ? " " : v;
+            return param(group, name, kTypeChar, {(int)s.size()}, s.data(), s.size());
+        }
+        // Array of strings, padded with spaces to the longest one.
+        size_t paramStrings(int8_t group, const std::string& name, const std::vector<std::string>& v) {
+            size_t width = 1;
+            for (const auto& s : v) width = std::max(width, s.size());
+            std::string data;
+            data.reserve(width * v.size());
+            for (const auto& s : v) {
+                data += s;
+                data.append(width - s.size(), ' ');
+            }
+            return param(group, name, kTypeChar, {(int)width, (int)v.size()}, data.data(), data.size());
+        }
+
+        // Pads to whole blocks and stores the block count. Returns the number of blocks.
+        size_t finish() {
+            size_t blocks = (bytes.size() + kBlockSize - 1) / kBlockSize;
+            bytes.resize(blocks * kBlockSize, 0);
+            bytes[2] = (uint8_t)blocks;
+            return blocks;
+        }
+    };
+}
+
+C3DWriter::~C3DWriter() {
+    close();
+}
+
+void C3DWriter::close() {
+    if (fd_ >= 0) {
+        data_.attach(-1);
+        ::close(fd_);
+    }
+    fd_ = -1;
+}
+
+bool C3DWriter::writeAt(const void* data, size_t len, off_t offset) {
+    const char* p = static_cast<const char*>(data);
+    while (len > 0) {
+        ssize_t n = ::pwrite(fd_, p, len, offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LOGE("C3DWriter: write to '%s' failed: %s", path_.c_str(), strerror(errno));
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+        offset += n;
+    }
+    return true;
+}
+
+bool C3DWriter::open(const std::string& path, const Layout& layout, uint32_t expectedFrames) {
+    close();
+    const size_t nPoints = layout.pointNames.size();
+    const size_t nAnalogs = layout.analogNames.size();
+    if (nPoints > 255 || nAnalogs > 255) {
+        LOGE("C3DWriter: too many points (%zu) or analog channels (%zu)", nPoints, nAnalogs);
+        return false;
+    }
+    path_ = path;
+    floatsPerFrame_ = nPoints * 4 + nAnalogs;
+    frames_ = 0;
+    checkpointFrames_ = 0;
+
+    // Integer mode: scales not given by the caller are written as 1 here and patched by the first append.
+    integer_ = layout.integer;
+    scalesPending_ = false;
+    float pointScale = -1.0f; // negative = float data
+    std::vector<float> analogScale(nAnalogs, 1.0f);
+    std::vector<int16_t> analogOffset(nAnalogs, 0);
+    if (integer_.enabled) {
+        integer_.analogScales.resize(nAnalogs, 0.0f);
+        integer_.analogOffsets.resize(nAnalogs, 0);
+        scalesPending_ = integer_.pointScale <= 0.0f;
+        pointScale = scalesPending_ ? 1.0f : integer_.pointScale;
+        for (size_t i = 0; i < nAnalogs; ++i) {
+            if (integer_.analogScales[i] > 0.0f) {
+                analogScale[i] = integer_.analogScales[i];
+                analogOffset[i] = integer_.analogOffsets[i];
+            } else {
+                integer_.analogOffsets[i] = 0;
+                scalesPending_ = true;
+            }
+        }
+        pointNames_ = layout.pointNames;
+        analogNames_ = layout.analogNames;
+        maxError_.assign(nPoints + nAnalogs, 0.0f);
+        clipped_.assign(nPoints + nAnalogs, 0);
+    }
+
+    // --- Parameter section ---
+    ParamSection ps;
+    ps.group(kGroupPoint, "POINT", "3-D point parameters");
+    ps.paramInt16(kGroupPoint, "USED", (int16_t)nPoints);
+    const size_t pointScalePos = ps.paramFloat(kGroupPoint, "SCALE", pointScale);
+    ps.paramFloat(kGroupPoint, "RATE", layout.frameRate);
+    const size_t dataStartPos = ps.paramInt16(kGroupPoint, "DATA_START", 0); // patched below
+    const size_t framesPos = ps.paramInt16(kGroupPoint, "FRAMES", 0);
+    ps.paramString(kGroupPoint, "UNITS", layout.pointUnits);
+    ps.paramStrings(kGroupPoint, "LABELS", layout.pointNames);
+    ps.paramStrings(kGroupPoint, "DESCRIPTIONS", std::vector<std::string>(nPoints, ""));
+
+    ps.group(kGroupAnalog, "ANALOG", "Analog data parameters");
+    ps.paramInt16(kGroupAnalog, "USED", (int16_t)nAnalogs);
+    ps.paramFloat(kGroupAnalog, "RATE", layout.frameRate);
+    ps.paramFloat(kGroupAnalog, "GEN_SCALE", 1.0f);
+    const size_t analogScalePos = ps.param(kGroupAnalog, "SCALE", kTypeFloat, {(int)nAnalogs},
+                                           analogScale.data(), analogScale.size() * sizeof(float));
+    const size_t analogOffsetPos = ps.param(kGroupAnalog, "OFFSET", kTypeInt16, {(int)nAnalogs},
+                                            analogOffset.data(), analogOffset.size() * sizeof(int16_t));
+    ps.paramStrings(kGroupAnalog, "LABELS", layout.analogNames);
+    ps.paramStrings(kGroupAnalog, "DESCRIPTIONS", std::vector<std::string>(nAnalogs, ""));
+    ps.paramStrings(kGroupAnalog, "UNITS", layout.analogUnits.size() == nAnalogs
+                                           ? layout.analogUnits : std::vector<std::string>(nAnalogs, ""));
+    ps.paramString(kGroupAnalog, "FORMAT", "SIGNED");
+    ps.paramInt16(kGroupAnalog, "BITS", 16);
+
+    // Frame range as two 16-bit words (low, high), the only place where more than 65535 frames fit.
+    ps.group(kGroupTrial, "TRIAL", "Trial parameters");
+    {
+        const int16_t start[2] = {1, 0};
+        const int16_t end[2] = {0, 0};
+        ps.param(kGroupTrial, "ACTUAL_START_FIELD", kTypeInt16, {2}, start, sizeof(start));
+        const size_t endPos = ps.param(kGroupTrial, "ACTUAL_END_FIELD", kTypeInt16, {2}, end, sizeof(end));
+        endFieldParamOffset_ = (off_t)(kBlockSize + endPos);
+    }
+    const size_t paramBlocks = ps.finish();
+    const int16_t dataStartBlock = (int16_t)(kParamStartBlock + paramBlocks);
+    std::memcpy(&ps.bytes[dataStartPos], &dataStartBlock, sizeof(dataStartBlock));
+    framesParamOffset_ = (off_t)(kBlockSize + framesPos);
+    pointScaleParamOffset_ = (off_t)(kBlockSize + pointScalePos);
+    analogScaleParamOffset_ = (off_t)(kBlockSize + analogScalePos);
+    analogOffsetParamOffset_ = (off_t)(kBlockSize + analogOffsetPos);
+
+    // --- Header (block 1) ---
+    uint8_t header[kBlockSize] = {0};
+    auto put16 = [&](size_t word, int16_t v) { std::memcpy(&header[(word - 1) * 2], &v, sizeof(v)); };
+    auto putFloat = [&](size_t word, float v) { std::memcpy(&header[(word - 1) * 2], &v, sizeof(v)); };
+    header[0] = kParamStartBlock;
+    header[1] = kC3DKey;
+    put16(2, (int16_t)nPoints);
+    put16(3, (int16_t)nAnalogs);  // analog values per 3D frame (1 sample per frame)
+    put16(4, 1);                  // first frame
+    put16(5, 0);                  // last frame, patched by finalize
+    put16(6, 10);                 // max interpolation gap
+    putFloat(7, pointScale);      // scale, negative = float data
+    put16(9, dataStartBlock);
+    put16(10, 1);                 // analog samples per 3D frame
+    putFloat(11, layout.frameRate);
+
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        LOGE("C3DWriter: cannot create '%s': %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    if (!writeAt(header, sizeof(header), 0) || !writeAt(ps.bytes.data(), ps.bytes.size(), kBlockSize)) {
+        close();
+        return false;
+    }
+    writeOffset_ = (off_t)((dataStartBlock - 1) * kBlockSize);
+    data_.attach(fd_);
+    if (expectedFrames > 0) {
+        AsyncFile::preallocate(fd_, writeOffset_ + (off_t)expectedFrames * (off_t)(floatsPerFrame_ * bytesPerValue()));
+    }
+    return true;
+}
+
+bool C3DWriter::appendFrames(const float* records, size_t nFrames) {
+    if (fd_ < 0 || nFrames == 0) return fd_ >= 0;
+    const size_t bytes = nFrames * floatsPerFrame_ * bytesPerValue();
+    const void* data = records;
+    if (integer_.enabled) {
+        if (scalesPending_ && !chooseScales(records, nFrames)) return false;
+        quantize(records, nFrames);
+        data = intRecords_.data();
+    }
+    if (!data_.write(data, bytes, writeOffset_)) {
+        LOGE("C3DWriter: write to '%s' failed", path_.c_str());
+        return false;
+    }
+    writeOffset_ += (off_t)bytes;
+    frames_ += (uint32_t)nFrames;
+    return true;
+}
+
+bool C3DWriter::patchFrameCount() {
+    // 16-bit fields hold at most 65535 frames (read as unsigned), TRIAL:ACTUAL_END_FIELD has the full count.
+    const uint16_t last16 = (uint16_t)std::min<uint32_t>(frames_, 0xFFFF);
+    const uint16_t end[2] = {(uint16_t)(frames_ & 0xFFFF), (uint16_t)(frames_ >> 16)};
+    return writeAt(&last16, sizeof(last16), 8) &&
+           writeAt(&last16, sizeof(last16), framesParamOffset_) &&
+           writeAt(end, sizeof(end), endFieldParamOffset_);
+}
+
+// Scales still at 0 are taken from these frames: one POINT:SCALE from the largest coordinate of the valid
+// markers, and per analog channel a scale and offset that center its range. The chosen values are written
+// over the placeholders of the header and parameter section.
+bool C3DWriter::chooseScales(const float* records, size_t nFrames) {
+    const size_t nPoints = pointNames_.size();
+    const size_t nAnalogs = analogNames_.size();
+
+    if (integer_.pointScale <= 0.0f) {
+        float maxAbs = 0.0f;
+        for (size_t f = 0; f < nFrames; ++f) {
+            const float* rec = records + f * floatsPerFrame_;
+            for (size_t p = 0; p < nPoints; ++p) {
+                const float* r = rec + p * 4;
+                if (!(r[3] >= 0.0f)) continue; // missing marker
+                for (int c = 0; c < 3; ++c) {
+                    if (std::isfinite(r[c])) maxAbs = std::max(maxAbs, std::fabs(r[c]));
+                }
+            }
+        }
+        integer_.pointScale = std::max(maxAbs * kPointHeadroom, kMinPointRangeMm) / kIntRange;
+    }
+
+    for (size_t a = 0; a < nAnalogs; ++a) {
+        if (integer_.analogScales[a] > 0.0f) continue;
+        float lo = 0.0f, hi = 0.0f;
+        bool any = false;
+        for (size_t f = 0; f < nFrames; ++f) {
+            const float v = records[f * floatsPerFrame_ + nPoints * 4 + a];
+            if (!std::isfinite(v)) continue;
+            lo = any ? std::min(lo, v) : v;
+            hi = any ? std::max(hi, v) : v;
+            any = true;
+        }
+        const float center = 0.5f * (lo + hi);
+        const float half = std::max(0.5f * (hi - lo) * kAnalogHeadroom, 1e-3f * std::max(1.0f, std::fabs(center)));
+        // The offset is an int16 too, so a channel far from 0 needs a coarser scale to reach its center.
+        const float scale = std::max(half, std::fabs(center)) / kIntRange;
+        integer_.analogScales[a] = scale;
+        integer_.analogOffsets[a] = (int16_t)std::lrint(std::min(kIntRange, std::max(-kIntRange, -center / scale)));
+    }
+    scalesPending_ = false;
+
+    const size_t nA = integer_.analogScales.size();
+    if (!writeAt(&integer_.pointScale, sizeof(float), kHeaderScaleOffset) ||
+        !writeAt(&integer_.pointScale, sizeof(float), pointScaleParamOffset_) ||
+        !writeAt(integer_.analogScales.data(), nA * sizeof(float), analogScaleParamOffset_) ||
+        !writeAt(integer_.analogOffsets.data(), nA * sizeof(int16_t), analogOffsetParamOffset_)) {
+        return false;
+    }
+    LOGI("C3DWriter: '%s' int16 point scale %.4f mm", path_.c_str(), integer_.pointScale);
+    return true;
+}
+
+// Float records -> int16 records, keeping the worst error and the clipped values of every point/channel.
+void C3DWriter::quantize(const float* records, size_t nFrames) {
+    const size_t nPoints = pointNames_.size();
+    const size_t nAnalogs = analogNames_.size();
+    intRecords_.resize(nFrames * floatsPerFrame_);
+
+    auto toInt = [&](float v, float scale, int16_t offset, size_t channel) -> int16_t {
+        const float q = v / scale + (float)offset;
+        long raw;
+        if (q >= -32767.0f && q <= 32767.0f) {
+            raw = std::lrint(q);
+        } else {
+            raw = q > 0.0f ? 32767 : -32767; // NaN ends here too
+            ++clipped_[channel];
+        }
+        const float err = std::fabs(v - (float)(raw - offset) * scale);
+        if (err > maxError_[channel]) maxError_[channel] = err;
+        return (int16_t)raw;
+    };
+
+    const float pointScale = integer_.pointScale;
+    for (size_t f = 0; f < nFrames; ++f) {
+        const float* rec = records + f * floatsPerFrame_;
+        int16_t* out = intRecords_.data() + f * floatsPerFrame_;
+        for (size_t p = 0; p < nPoints; ++p) {
+            const float* r = rec + p * 4;
+            int16_t* o = out + p * 4;
+            if (!(r[3] >= 0.0f)) {
+                o[0] = o[1] = o[2] = 0;
+                o[3] = -1; // missing marker
+                continue;
+            }
+            o[0] = toInt(r[0], pointScale, 0, p);
+            o[1] = toInt(r[1], pointScale, 0, p);
+            o[2] = toInt(r[2], pointScale, 0, p);
+            // Residual in the low byte, in POINT:SCALE units; camera mask (high byte) unused
+            o[3] = (int16_t)std::min(255L, std::lrint(r[3] / pointScale));
+        }
+        const float* analog = rec + nPoints * 4;
+        int16_t* outAnalog = out + nPoints * 4;
+        for (size_t a = 0; a < nAnalogs; ++a) {
+            outAnalog[a] = toInt(analog[a], integer_.analogScales[a], integer_.analogOffsets[a], nPoints + a);
+        }
+    }
+}
+
+// One summary line, then the worst error of every point and channel, a few per line.
+void C3DWriter::logQuantizationError() const {
+    const size_t nPoints = pointNames_.size();
+    size_t worstPoint = 0, worstAnalog = nPoints;
+    uint32_t clipped = 0;
+    for (size_t i = 0; i < maxError_.size(); ++i) {
+        if (i < nPoints && maxError_[i] > maxError_[worstPoint]) worstPoint = i;
+        if (i >= nPoints && maxError_[i] > maxError_[worstAnalog]) worstAnalog = i;
+        clipped += clipped_[i];
+    }
+    auto name = [&](size_t i) -> const std::string& {
+        return i < nPoints ? pointNames_[i] : analogNames_[i - nPoints];
+    };
+    // Clipped values mean the scale was too small for this part, worth an error
+    TELEMETRIA_LOG(clipped > 0 ? kLogError : kLogInfo, "C3DWriter: '%s' int16 worst error %.4f mm (%s), analog %.6g (%s), %u values clipped",
+         path_.c_str(), nPoints ? maxError_[worstPoint] : 0.0f, nPoints ? name(worstPoint).c_str() : "-",
+         worstAnalog < maxError_.size() ? maxError_[worstAnalog] : 0.0f,
+         worstAnalog < maxError_.size() ? name(worstAnalog).c_str() : "-", clipped);
+
+    static constexpr size_t kPerLine = 8;
+    std::string line;
+    char item[96];
+    for (size_t i = 0; i < maxError_.size(); ++i) {
+        if (clipped_[i] > 0) {
+            std::snprintf(item, sizeof(item), " %s=%.4g(%u clipped)", name(i).c_str(), maxError_[i], clipped_[i]);
+        } else {
+            std::snprintf(item, sizeof(item), " %s=%.4g", name(i).c_str(), maxError_[i]);
+        }
+        line += item;
+        if ((i + 1) % kPerLine == 0 || i + 1 == maxError_.size()) {
+            LOGI("C3DWriter: int16 error%s", line.c_str());
+            line.clear();
+        }
+    }
+}
+
+bool C3DWriter::checkpoint() {
+    if (fd_ < 0) return false;
+    if (frames_ == checkpointFrames_) return true;
+    // Data first: the counts patched below are only synced by the next checkpoint (or finalize). If power is
+    // lost before that the file has the previous count or the new one, both backed by data already on disk.
+    if (!data_.sync()) {
+        LOGE("C3DWriter: sync of '%s' failed", path_.c_str());
+        return false;
+    }
+    if (!patchFrameCount()) return false;
+    checkpointFrames_ = frames_;
+    return true;
+}
+
+bool C3DWriter::finalize() {
+    if (fd_ < 0) return false;
+    if (integer_.enabled && frames_ > 0) logQuantizationError();
+    bool ok = data_.flush();
+    if (!ok) LOGE("C3DWriter: write to '%s' failed", path_.c_str());
+    ok = ok && patchFrameCount();
+    // Pad the last data block with zeros, some readers expect whole blocks.
+    const size_t tail = (size_t)(writeOffset_ % (off_t)kBlockSize);
+    if (ok && tail != 0) {
+        static const uint8_t kZeros[kBlockSize] = {0};
+        ok = writeAt(kZeros, kBlockSize - tail, writeOffset_);
+        writeOffset_ += (off_t)(kBlockSize - tail);
+    }
+    // Give back the preallocated space that was not used
+    if (ok && ::ftruncate(fd_, writeOffset_) != 0) {
+        LOGE("C3DWriter: ftruncate failed: %s", strerror(errno));
+        ok = false;
+    }
+    if (ok && ::fdatasync(fd_) != 0) {
+        LOGE("C3DWriter: fdatasync failed: %s", strerror(errno));
+        ok = false;
+    }
+    close();
+    return ok;
+}
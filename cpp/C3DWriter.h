@@ -0,0 +1,114 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <sys/types.h>
+
+#include "AsyncFile.h"
+
+// Streaming writer for C3D files (float format, Intel byte order, one analog sample per 3D frame).
+// The 512-byte header and the parameter section are written by open() with a frame count of 0, frames
+// are appended at the end of the file as they come, and finalize() patches the frame count fields.
+// That way the recorder never has to keep the session in memory.
+//
+// Record layout expected by appendFrames, per frame (all float32):
+//   pointCount * [x, y, z, residual]   (residual 0 = valid, -1 = missing marker)
+//   analogCount * [value]
+//
+// With Layout::integer.enabled the file stores int16 records instead (half the size): appendFrames still
+// takes floats and quantizes them with POINT:SCALE and the per-channel ANALOG:SCALE / ANALOG:OFFSET.
+// Scales left at 0 are chosen from the range of the first frames appended and patched into the header
+// and parameters; finalize() logs the worst quantization error of every point and channel.
+//
+// Frame data goes through an AsyncFile (background writes, see setIoBackend); header and parameter
+// patches are small blocking writes to their own blocks.
+class C3DWriter {
+public:
+    // Int16 storage. Analog values are decoded as (raw - offset) * scale.
+    struct IntegerFormat {
+        bool enabled = false;
+        float pointScale = 0.0f;             // mm per unit, 0 = from the first frames
+        std::vector<float> analogScales;     // per channel, 0 or missing = from the first frames
+        std::vector<int16_t> analogOffsets;  // per channel, only used with a scale given here
+    };
+
+    // Description of the file contents, fixed for the whole file.
+    struct Layout {
+        std::vector<std::string> pointNames;
+        std::vector<std::string> analogNames;
+        std::vector<std::string> analogUnits; // optional, one per analog channel
+        float frameRate = 60.0f;              // POINT:RATE and ANALOG:RATE
+        std::string pointUnits = "mm";
+        IntegerFormat integer;
+    };
+
+    C3DWriter() = default;
+    // Closes the file without patching it (a file that was not finalized keeps 0 frames in the header).
+    ~C3DWriter();
+
+    C3DWriter(const C3DWriter&) = delete;
+    C3DWriter& operator=(const C3DWriter&) = delete;
+
+    // Backend for the frame data ("threads", "uring" or "sync", see AsyncIo.h). Call before open().
+    void setIoBackend(const std::string& kind) { data_.setBackend(kind); }
+    const char* ioBackendName() const { return data_.backendName(); }
+
+    // Creates path (truncating it) and writes header + parameters. Returns false on I/O error
+    // or if the layout does not fit in a C3D file (more than 255 points or analog channels).
+    // expectedFrames > 0 preallocates the disk space of that many frames (released by finalize if unused).
+    bool open(const std::string& path, const Layout& layout, uint32_t expectedFrames = 0);
+
+    bool isOpen() const { return fd_ >= 0; }
+
+    // Appends nFrames records of floatsPerFrame() floats each (converted to int16 in integer mode).
+    bool appendFrames(const float* records, size_t nFrames);
+
+    // Makes the frames appended so far durable and readable after a crash: syncs the data, then patches the
+    // frame counts (three small writes, each one inside a single sector). The counts never get ahead of the
+    // data on disk, so the file always reads as a valid C3D with the frames of the last checkpoint.
+    bool checkpoint();
+
+    // Patches header word 5 (last frame, 16 bits), POINT:FRAMES and TRIAL:ACTUAL_END_FIELD (32 bits, for
+    // files over 65535 frames), pads the data section to a full block, syncs and closes the file.
+    bool finalize();
+
+    // Waits for the frame writes in flight and closes the file descriptor without patching anything.
+    void close();
+
+    size_t floatsPerFrame() const { return floatsPerFrame_; }
+    uint32_t framesWritten() const { return frames_; }
+    const std::string& path() const { return path_; }
+    // Scales in use, complete once the first frames are appended.
+    const IntegerFormat& integerFormat() const { return integer_; }
+
+private:
+    int fd_ = -1;
+    std::string path_;
+    size_t floatsPerFrame_ = 0;
+    uint32_t frames_ = 0;
+    uint32_t checkpointFrames_ = 0; // frames_ at the last checkpoint
+    off_t writeOffset_ = 0;  // end of the data written so far
+    AsyncFile data_;         // frame data writes
+
+    // File offsets of the values patched by finalize()
+    off_t framesParamOffset_ = -1;   // POINT:FRAMES (int16)
+    off_t endFieldParamOffset_ = -1; // TRIAL:ACTUAL_END_FIELD (2 x int16)
+
+    // Integer mode
+    IntegerFormat integer_;
+    bool scalesPending_ = false;             // some scale is still 0, chosen on the first append
+    off_t pointScaleParamOffset_ = -1;       // POINT:SCALE (float)
+    off_t analogScaleParamOffset_ = -1;      // ANALOG:SCALE (float array)
+    off_t analogOffsetParamOffset_ = -1;     // ANALOG:OFFSET (int16 array)
+    std::vector<int16_t> intRecords_;        // quantized records of one append
+    std::vector<std::string> pointNames_, analogNames_; // for the error report
+    std::vector<float> maxError_;            // per point (worst of x, y, z), then per analog channel
+    std::vector<uint32_t> clipped_;          // values out of the int16 range, same order
+
+    bool writeAt(const void* data, size_t len, off_t offset);
+    bool patchFrameCount();
+    size_t bytesPerValue() const { return integer_.enabled ? sizeof(int16_t) : sizeof(float); }
+    bool chooseScales(const float* records, size_t nFrames);
+    void quantize(const float* records, size_t nFrames);
+    void logQuantizationError() const;
+};
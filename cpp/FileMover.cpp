@@ -0,0 +1,168 @@
+#include "FileMover.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#include "TelemetriaLog.h"
+
+// Copy buffer, big enough to keep the number of FUSE round trips low.
+static constexpr size_t kCopyChunk = 1024 * 1024;
+
+// Lowest CPU priority, and lowest best-effort I/O priority (no <linux/ioprio.h> in the NDK).
+static constexpr int kMoverNice = 19;
+static constexpr int kIoprioWhoProcess = 1;
+static constexpr int kIoprioClassBe = 2;
+static constexpr int kIoprioClassShift = 13;
+static constexpr int kIoprioLowestBe = (kIoprioClassBe << kIoprioClassShift) | 7;
+
+static bool writeAll(int fd, const char* p, size_t len) {
+    while (len > 0) {
+        ssize_t n = ::write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+static bool copyFile(const std::string& src, const std::string& dst) {
+    int in = ::open(src.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        LOGE("FileMover: cannot open '%s': %s", src.c_str(), strerror(errno));
+        return false;
+    }
+    int out = ::open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0) {
+        LOGE("FileMover: cannot create '%s': %s", dst.c_str(), strerror(errno));
+        ::close(in);
+        return false;
+    }
+    std::vector<char> buf(kCopyChunk);
+    bool ok = true;
+    for (;;) {
+        ssize_t n = ::read(in, buf.data(), buf.size());
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            ok = n == 0;
+            break;
+        }
+        if (!writeAll(out, buf.data(), (size_t)n)) {
+            ok = false;
+            break;
+        }
+    }
+    if (ok && ::fsync(out) != 0) ok = false;
+    if (!ok) LOGE("FileMover: copy '%s' -> '%s' failed: %s", src.c_str(), dst.c_str(), strerror(errno));
+    ::close(out);
+    ::close(in);
+    return ok;
+}
+
+bool FileMover::moveFile(const std::string& src, const std::string& dstDir) {
+    const size_t slash = src.find_last_of('/');
+    const std::string dst = dstDir + "/" + (slash == std::string::npos ? src : src.substr(slash + 1));
+    // Same file system (staging disabled at the OS level, tests...): a rename is enough
+    if (::rename(src.c_str(), dst.c_str()) == 0) return true;
+    if (errno != EXDEV) {
+        LOGE("FileMover: rename '%s' -> '%s' failed: %s", src.c_str(), dst.c_str(), strerror(errno));
+        return false;
+    }
+    // The destination name only appears once the copy is complete and on disk
+    const std::string tmp = dst + ".tmp";
+    if (!copyFile(src, tmp) || ::rename(tmp.c_str(), dst.c_str()) != 0) {
+        ::unlink(tmp.c_str());
+        return false;
+    }
+    ::unlink(src.c_str());
+    return true;
+}
+
+FileMover::~FileMover() {
+    stop();
+}
+
+void FileMover::start() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (thread_.joinable()) return;
+    stop_ = false;
+    failures_ = 0;
+    running_ = true;
+    thread_ = std::thread(&FileMover::loop, this);
+}
+
+void FileMover::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+void FileMover::enqueue(const std::string& src, const std::string& dstDir) {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        jobs_.push_back(Job{src, dstDir});
+    }
+    cv_.notify_one();
+}
+
+bool FileMover::waitIdle(int timeoutMs) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    auto idle = [&]{ return (jobs_.empty() && !busy_) || !running_; };
+    if (timeoutMs < 0) {
+        idleCv_.wait(lock, idle);
+        return true;
+    }
+    return idleCv_.wait_for(lock, std::chrono::milliseconds(timeoutMs), idle);
+}
+
+size_t FileMover::failures() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return failures_;
+}
+
+void FileMover::loop() {
+    // On Linux both calls act on the calling thread only (who = 0 is this thread's id).
+    if (::setpriority(PRIO_PROCESS, 0, kMoverNice) != 0) {
+        LOGI("FileMover: setpriority failed: %s", strerror(errno));
+    }
+    ::syscall(SYS_ioprio_set, kIoprioWhoProcess, 0, kIoprioLowestBe);
+
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            busy_ = false;
+            if (jobs_.empty()) idleCv_.notify_all();
+            cv_.wait(lock, [&]{ return stop_ || !jobs_.empty(); });
+            if (jobs_.empty()) break; // stop_ and nothing left
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+            busy_ = true;
+        }
+        const auto t0 = std::chrono::steady_clock::now();
+        const bool ok = moveFile(job.src, job.dstDir);
+        const long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - t0).count();
+        if (ok) {
+            LOGI("FileMover: moved '%s' to '%s' (%lld ms)", job.src.c_str(), job.dstDir.c_str(), ms);
+        } else {
+            std::lock_guard<std::mutex> lock(mtx_);
+            ++failures_;
+        }
+    }
+    std::lock_guard<std::mutex> lock(mtx_);
+    busy_ = false;
+    running_ = false;
+    idleCv_.notify_all();
+}
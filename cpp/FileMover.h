@@ -0,0 +1,60 @@
+#pragma once
+#include <string>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+// Moves finished files from the internal staging directory (/data/data/<package>/files, plain ext4/f2fs)
+// to the external files directory (/sdcard/Android/data/<package>/files, behind FUSE/sdcardfs) on a
+// background thread with low CPU and I/O priority, so recording only ever writes to internal storage.
+//
+// Both directories are usually on different file systems, so a move is: copy to <dst>.tmp, fsync, rename
+// over <dst>, unlink the source. A move that fails leaves the source where it was (it is picked up again by
+// the next leftover scan).
+class FileMover {
+public:
+    FileMover() = default;
+    // Finishes the queued moves and stops the thread.
+    ~FileMover();
+
+    FileMover(const FileMover&) = delete;
+    FileMover& operator=(const FileMover&) = delete;
+
+    // Starts the thread if it is not running.
+    void start();
+
+    // Finishes the queued moves and joins the thread. Safe to call more than once.
+    void stop();
+
+    // Queues src to be moved into dstDir with the same file name. Moves happen in queue order.
+    void enqueue(const std::string& src, const std::string& dstDir);
+
+    // Waits until the queue is empty and the current move is done (negative timeout = no limit).
+    // Returns false on timeout.
+    bool waitIdle(int timeoutMs);
+
+    // Moves that failed since start().
+    size_t failures() const;
+
+    // Same move done on the calling thread. Returns false (source kept) on error.
+    static bool moveFile(const std::string& src, const std::string& dstDir);
+
+private:
+    struct Job {
+        std::string src;
+        std::string dstDir;
+    };
+
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;     // new job or stop_
+    std::condition_variable idleCv_; // queue drained
+    std::deque<Job> jobs_;
+    bool busy_ = false;
+    bool stop_ = false;
+    bool running_ = false;
+    size_t failures_ = 0;
+    std::thread thread_;
+
+    void loop();
+};
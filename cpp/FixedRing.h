@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// FIFO with a fixed number of slots, allocated once by reset(). Used instead of std::deque on paths that must
+// not allocate once running (libstdc++'s deque allocates a new block every few hundred bytes pushed).
+// Not thread safe. push_back on a full ring is a bug: callers make room first.
+template <typename T>
+class FixedRing {
+public:
+    // Drops the content and makes room for capacity elements.
+    void reset(size_t capacity) {
+        slots_.clear();
+        slots_.resize(capacity);
+        head_ = 0;
+        size_ = 0;
+    }
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return slots_.size(); }
+    bool empty() const { return size_ == 0; }
+    bool full() const { return size_ == slots_.size(); }
+
+    T& front() { return slots_[head_]; }
+    const T& front() const { return slots_[head_]; }
+
+    void push_back(T&& value) {
+        slots_[(head_ + size_) % slots_.size()] = std::move(value);
+        ++size_;
+    }
+
+    // Releases what is left in the front slot (usually nothing, it was moved out).
+    void pop_front() {
+        slots_[head_] = T();
+        head_ = (head_ + 1) % slots_.size();
+        --size_;
+    }
+
+    void clear() {
+        while (!empty()) pop_front();
+    }
+
+private:
+    std::vector<T> slots_;
+    size_t head_ = 0;
+    size_t size_ = 0;
+};
@@ -1,22 +1,58 @@
 #include "GestorTelemetria.h"
 #include "AndroidUploader.h"
-#include <android/log.h>
 #include <sstream>
 #include "configReader.h"
+#include "FileMover.h"
+#include "PipelineTrace.h"
+#include "TelemetriaProbes.h"
+#include <dirent.h>
+#include <sys/stat.h>
+#include <cerrno>
 #include <chrono>
 #include <deque>
 #include <condition_variable>
 #include <thread>
+#include <memory>
+#include <algorithm>
 
-#define LOG_TAG "telemetria"
-#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#include "TelemetriaLog.h"
 
 // Bit masks used for controller button states. (see VRFrameDataPlain in TiposVR.h)
 static constexpr unsigned BTN_PRIMARY   = 0x1u; // A/X
 static constexpr unsigned BTN_SECONDARY = 0x2u; // B/Y
 static constexpr unsigned BTN_JOYSTICK  = 0x4u; // Stick press
 
-GestorTelemetria::GestorTelemetria() {}
+// Retry delays of the spool drainer while the network is down.
+static constexpr std::chrono::seconds kDrainMinBackoff(2);
+static constexpr std::chrono::seconds kDrainMaxBackoff(60);
+// Max wait for asynchronous uploads at shutdown (AyudanteHttp connect + read timeouts).
+static constexpr std::chrono::seconds kInFlightShutdownWait(45);
+
+// With stageInternal the spool lives in internal storage. The first time, segments left in the external spool
+// by runs without it are moved over, so they are still uploaded. Only when the internal spool does not exist
+// yet: the segment numbers of two spools would overlap.
+static void adoptExternalSpool(const std::string& from, const std::string& to) {
+    struct stat st;
+    if (::stat(to.c_str(), &st) == 0) return;
+    DIR* d = ::opendir(from.c_str());
+    if (!d) return;
+    if (::mkdir(to.c_str(), 0700) != 0) {
+        ::closedir(d);
+        return;
+    }
+    size_t moved = 0;
+    while (dirent* e = ::readdir(d)) {
+        if (e->d_name[0] == '.') continue;
+        if (FileMover::moveFile(from + "/" + e->d_name, to)) ++moved;
+    }
+    ::closedir(d);
+    if (moved > 0) LOGI("GestorTelemetria: moved %zu spool files from %s to %s", moved, from.c_str(), to.c_str());
+}
+
+GestorTelemetria::GestorTelemetria() {
+    // Usable before initialize too: telemetry_record_frame may be called first
+    queue_.reset(maxQueuedChunks_);
+}
 // Destructor, is a safety fallback in case shutdown() was not called explicitly.
 GestorTelemetria::~GestorTelemetria() {
     // Signal stop to the worker thread.
@@ -31,6 +67,15 @@ GestorTelemetria::~GestorTelemetria() {
     if (worker_.joinable()) {
         worker_.join();
     }
+    // Same for the spool drainer.
+    {
+        std::lock_guard<std::mutex> lk(qmtx_);
+        stopDrainer_ = true;
+    }
+    dcv_.notify_all();
+    if (drainer_.joinable()) {
+        drainer_.join();
+    }
 }
 
 bool GestorTelemetria::initialize(const UploaderConfig& cfg, AndroidUploader* uploader) {
@@ -46,15 +91,53 @@ bool GestorTelemetria::initialize(const UploaderConfig& cfg, AndroidUploader* up
             // Reserve space to minimize reallocations and reduce the risk of
             // losing frames due to allocations at high frequency.
             buffer_.reserve(cfg_.framesPerFile);
+            spareChunks_.clear();
+            spareChunks_.reserve(kMaxSpareChunks);
         }
     // --- Start background worker thread ---
+    // --- Open the offline spool next to initialConfig.json (or in internal storage with stageInternal) ---
+    // Segments left by a previous run are kept and uploaded by the drainer.
+    spoolEnabled_ = false;
+    std::string filesDir, spoolDir;
+    if (cfg.spoolEnabled && configReader::getFilesDir(filesDir)) {
+        spoolDir = filesDir + "/spool";
+        std::string internalDir;
+        if (cfg.stageInternal && configReader::getInternalFilesDir(internalDir)) {
+            adoptExternalSpool(spoolDir, internalDir + "/spool");
+            spoolDir = internalDir + "/spool";
+        }
+    }
+    if (!spoolDir.empty()) {
+        const size_t maxBytes = (size_t)cfg.spoolMaxMB * 1024u * 1024u;
+        spool_.setIoBackend(cfg.ioBackend);
+        spoolEnabled_ = spool_.open(spoolDir, maxBytes);
+        if (!spoolEnabled_) {
+            LOGE("GestorTelemetria: spool unavailable, chunks will be dropped while offline");
+        }
+    }
+    resetStats();
+    // Front buffer plus the spare chunk vectors it is recycled from
+    stats_.bufferFrames.store((long long)std::max(cfg.framesPerFile, 0) * (long long)(1 + kMaxSpareChunks),
+                              std::memory_order_relaxed);
     {
         std::lock_guard<std::mutex> lk(qmtx_);
         stopWorker_ = false;
-        queue_.clear();
+        queue_.reset(maxQueuedChunks_);
+        coalesceWindow_ = std::chrono::milliseconds(std::max(cfg.coalesceWindowMs, 0));
+        maxRequestBytes_ = (size_t)std::max(cfg.maxRequestKB, 1) * 1024;
+        spill_.clear();
+        spillIds_.clear();
+        stopDrainer_ = false;
+        inFlight_ = 0;
+        // Pending data from a previous run: try to send it right away.
+        drainKick_ = spoolEnabled_ && !spool_.empty();
+        offline_ = false;
     }
     // Launch the worker thread which will run workerLoop().
     worker_ = std::thread(&GestorTelemetria::workerLoop, this);
+    if (spoolEnabled_) {
+        drainer_ = std::thread(&GestorTelemetria::drainerLoop, this);
+    }
     return true;
 }
 
@@ -69,23 +152,62 @@ void GestorTelemetria::recordFrame(const VRFrameDataPlain& frame) {
         if (cfg_.framesPerFile > 0 && framesCount_ >= cfg_.framesPerFile) {
             chunk.swap(buffer_);
             framesCount_ = 0;
-            buffer_.reserve(cfg_.framesPerFile);
+            renewBufferLocked();
         }
     }
+    stats_.framesRecorded.fetch_add(1, std::memory_order_relaxed);
     // If we produced a full chunk, enqueue it for asynchronous upload.
     if (!chunk.empty()) {
         std::unique_lock<std::mutex> lk(qmtx_);
-        // Simple backpressure: if the queue is too large, drop the oldest chunk (as said before this should never happen).
-        if (queue_.size() >= maxQueuedChunks_) {
-            queue_.pop_front();
-        }
-        queue_.push_back(std::move(chunk));
+        enqueueChunkLocked(std::move(chunk));
         lk.unlock();
         // Wake up the worker thread so it can process the new chunk.
         qcv_.notify_one();
     }
 }
 
+void GestorTelemetria::renewBufferLocked() {
+    if (!spareChunks_.empty()) {
+        buffer_.swap(spareChunks_.back());
+        spareChunks_.pop_back();
+        buffer_.clear();
+    }
+    buffer_.reserve(cfg_.framesPerFile);
+}
+
+void GestorTelemetria::enqueueChunkLocked(std::vector<VRFrameDataPlain>&& chunk) {
+    const uint64_t id = ++chunkSeq_;
+    TraceSpan span("seal", id);
+    PipelineTrace::flowStart(id);
+    TELEMETRIA_PROBE3(chunk_seal, id, chunk.size(), queue_.size());
+    stats_.chunksSealed.fetch_add(1, std::memory_order_relaxed);
+    stats_.heldFrames.fetch_add((long long)chunk.size(), std::memory_order_relaxed);
+    // Simple backpressure: if the queue is too large, take out the oldest chunk.
+    if (queue_.size() >= maxQueuedChunks_) {
+        stats_.chunksEvicted.fetch_add(1, std::memory_order_relaxed);
+        TELEMETRIA_PROBE3(chunk_evict, queue_.front().id, queue_.front().frames.size(), spoolEnabled_ ? 1 : 0);
+        if (spoolEnabled_) {
+            // With the spool available the chunk is not lost, the worker writes it to disk before anything else.
+            // spill_ is bounded too, as a last resort if the worker stays blocked for a long time.
+            spill_.push_back(std::move(queue_.front().frames));
+            spillIds_.push_back(queue_.front().id);
+            if (spill_.size() > maxQueuedChunks_ * 4) {
+                stats_.framesDropped.fetch_add(spill_.front().size(), std::memory_order_relaxed);
+                stats_.heldFrames.fetch_sub((long long)spill_.front().size(), std::memory_order_relaxed);
+                spill_.pop_front();
+                spillIds_.pop_front();
+                LOGE("GestorTelemetria: spill queue full, dropping oldest chunk");
+            }
+        } else {
+            stats_.framesDropped.fetch_add(queue_.front().frames.size(), std::memory_order_relaxed);
+            stats_.heldFrames.fetch_sub((long long)queue_.front().frames.size(), std::memory_order_relaxed);
+        }
+        queue_.pop_front();
+    }
+    queue_.push_back(SealedChunk{std::move(chunk), std::chrono::steady_clock::now(), id});
+    stats_.chunksQueued.store(queue_.size() + spill_.size(), std::memory_order_relaxed);
+}
+
 void GestorTelemetria::flushAndUpload() {
     // Move any frames currently in buffer_ into a chunk and enqueue it,
     // even if we did not reach framesPerFile.
@@ -95,14 +217,11 @@ void GestorTelemetria::flushAndUpload() {
         if (buffer_.empty()) return;
         chunk.swap(buffer_);
         framesCount_ = 0;
-        buffer_.reserve(cfg_.framesPerFile);
+        renewBufferLocked();
     }
     // Enqueue the partially-filled chunk as if it were a complete one.
     std::unique_lock<std::mutex> lk(qmtx_);
-    if (queue_.size() >= maxQueuedChunks_) {
-        queue_.pop_front(); // drop oldest chunk if queue is too large (again not happening BUT)
-    }
-    queue_.push_back(std::move(chunk));
+    enqueueChunkLocked(std::move(chunk));
     lk.unlock();
     qcv_.notify_one();
 }
@@ -118,11 +237,26 @@ void GestorTelemetria::shutdown() {
     qcv_.notify_all();
     // Wait for the worker to finish any pending uploads.
     if (worker_.joinable()) worker_.join();
+    // Asynchronous requests still running: give them the same time the blocking call had (Java timeouts).
+    {
+        std::unique_lock<std::mutex> lk(qmtx_);
+        if (!ifcv_.wait_for(lk, kInFlightShutdownWait, [&]{ return inFlight_ == 0; })) {
+            LOGE("GestorTelemetria: %zu upload(s) still running at shutdown", inFlight_);
+        }
+    }
+    // Stop the drainer. Whatever is still in the spool is kept on disk and sent on the next run.
+    {
+        std::lock_guard<std::mutex> lk(qmtx_);
+        stopDrainer_ = true;
+    }
+    dcv_.notify_all();
+    if (drainer_.joinable()) drainer_.join();
+    spool_.close();
 }
 
 // Serialize a sequence of frames into the flat JSON format.
 // The resulting JSON is an array of frame objects, each with head_pose, controllers (left/right) or optional hand joint data.
-static std::string toJsonFlat(const std::vector<VRFrameDataPlain>& frames, const std::string& sessionId, const std::string& deviceInfo, const UploaderConfig& cfgFlags) {
+std::string toJsonFlat(const std::vector<VRFrameDataPlain>& frames, const std::string& sessionId, const std::string& deviceInfo, const UploaderConfig& cfgFlags) {
     std::ostringstream os;
     os << "[";
     for (size_t i = 0; i < frames.size(); ++i) {
@@ -242,41 +376,323 @@ static std::string toJsonFlat(const std::vector<VRFrameDataPlain>& frames, const
     return os.str();
 }
 
-void GestorTelemetria::serializeAndSend(const std::vector<VRFrameDataPlain>& chunk) {
+// Merges two JSON arrays produced by toJsonFlat: "[a,b]" + "[c]" -> "[a,b,c]".
+// PostgREST accepts a single array with all the rows, so several chunks can share one request.
+static void appendJsonArray(std::string& dst, const std::string& src) {
+    if (dst.empty()) {
+        dst = src;
+        return;
+    }
+    if (src.size() <= 2) return; // "[]"
+    dst.pop_back(); // ']'
+    if (dst.size() > 1) dst.push_back(',');
+    dst.append(src, 1, std::string::npos);
+}
+
+void GestorTelemetria::serializeAndSend(const std::vector<std::vector<VRFrameDataPlain>>& chunks, uint64_t firstId,
+                                        bool forceSpool) {
     if (!uploader_) return;
-    // Convert the chunk into JSON according to the configured feature flags
-    const std::string json = toJsonFlat(chunk, sessionId_, deviceInfo_, cfg_);
+    // Convert each chunk into JSON according to the configured feature flags and merge them
+    // into request bodies of at most maxRequestBytes_ (a single chunk is never split).
+    TELEMETRIA_PROBE2(serialize_start, firstId, chunks.size());
+    std::string body;
+    size_t frames = 0, bodyChunks = 0, serializedBytes = 0;
+    uint64_t bodyFirstId = firstId;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        const auto& chunk = chunks[i];
+        const auto ts = std::chrono::steady_clock::now();
+        std::string json;
+        {
+            AllocScope allocTag(kAllocSerialize);
+            TraceSpan span("serialize", firstId + i);
+            PipelineTrace::flowStep(firstId + i);
+            json = toJsonFlat(chunk, sessionId_, deviceInfo_, cfg_);
+        }
+        serializeLatency_.recordSince(ts);
+        stats_.bytesSerialized.fetch_add(json.size(), std::memory_order_relaxed);
+        serializedBytes += json.size();
+        if (!body.empty() && body.size() + json.size() > maxRequestBytes_) {
+            sendBody(std::move(body), bodyChunks, frames, bodyFirstId, forceSpool);
+            body.clear();
+            frames = 0;
+            bodyChunks = 0;
+            bodyFirstId = firstId + i;
+        }
+        appendJsonArray(body, json);
+        frames += chunk.size();
+        ++bodyChunks;
+    }
+    if (!body.empty()) {
+        sendBody(std::move(body), bodyChunks, frames, bodyFirstId, forceSpool);
+    }
+    TELEMETRIA_PROBE3(serialize_end, firstId, chunks.size(), serializedBytes);
+}
+
+void GestorTelemetria::sendBody(std::string json, size_t chunks, size_t frames, uint64_t firstId, bool forceSpool) {
+    // While offline, or if older chunks are still waiting on disk, the new data goes behind them
+    // so the backend receives the frames in order. The drainer will upload it.
+    if (spoolEnabled_ && (forceSpool || offline_ || !spool_.empty())) {
+        TraceSpan span("spool", firstId);
+        for (size_t i = 0; i < chunks; ++i) PipelineTrace::flowEnd(firstId + i);
+        if (spoolChunk(json, chunks, frames)) {
+            LOGI("Spooled %zu frames, spool bytes: %zu", frames, spool_.sizeBytes());
+        } else {
+            LOGE("Spool write FAILED, frames: %zu", frames);
+        }
+        return;
+    }
+
+    // Asynchronous upload: AyudanteHttp returns right away and the result comes back through the
+    // JNI callback, so the worker can keep encoding while up to maxInFlight_ requests are running.
+    if (uploader_->supportsAsync()) {
+        {
+            std::unique_lock<std::mutex> lk(qmtx_);
+            ifcv_.wait(lk, [&]{ return inFlight_ < maxInFlight_; });
+            ++inFlight_;
+            stats_.inFlight.store((long long)inFlight_, std::memory_order_relaxed);
+        }
+        // The callback keeps the body alive, it is needed again if the upload fails and goes to the spool.
+        auto payload = std::make_shared<std::string>(std::move(json));
+        const auto t0 = std::chrono::steady_clock::now();
+        stats_.inFlightBytes.fetch_add((long long)payload->size(), std::memory_order_relaxed);
+        const bool started = uploader_->uploadJsonAsync(*payload, [this, payload, chunks, frames, firstId, t0](const UploadResult& result) {
+            onUploadComplete(*payload, chunks, frames, firstId, result, t0);
+        });
+        if (started) return;
+        // Could not start it: release the slot and fall back to the blocking call below.
+        stats_.inFlightBytes.fetch_sub((long long)payload->size(), std::memory_order_relaxed);
+        releaseInFlight();
+        json = std::move(*payload);
+    }
+
     // Perform the HTTP upload via AndoidUploader.
-    bool ok = uploader_->uploadJson(json);
-    if (ok) {
-        __android_log_print(ANDROID_LOG_INFO, "telemetria",
-                            "Uploaded chunk, frames: %zu", chunk.size());
+    UploadResult result;
+    const auto t0 = std::chrono::steady_clock::now();
+    {
+        TraceSpan span("http", firstId);
+        uploader_->uploadJson(json, &result); // false <=> !result.ok()
+        for (size_t i = 0; i < chunks; ++i) PipelineTrace::flowEnd(firstId + i);
+    }
+    finishUpload(json, chunks, frames, result, t0);
+}
+
+void GestorTelemetria::onUploadComplete(const std::string& json, size_t chunks, size_t frames, uint64_t firstId,
+                                        const UploadResult& result, std::chrono::steady_clock::time_point t0) {
+    AllocScope allocTag(kAllocUpload);
+    if (PipelineTrace::enabled()) {
+        const uint64_t startNs = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t0.time_since_epoch()).count();
+        PipelineTrace::asyncSpan("http", firstId, startNs, PipelineTrace::nowNs());
+    }
+    TraceSpan span("upload_done", firstId);
+    for (size_t i = 0; i < chunks; ++i) PipelineTrace::flowEnd(firstId + i);
+    finishUpload(json, chunks, frames, result, t0);
+    stats_.inFlightBytes.fetch_sub((long long)json.size(), std::memory_order_relaxed);
+    releaseInFlight();
+}
+
+void GestorTelemetria::finishUpload(const std::string& json, size_t chunks, size_t frames, const UploadResult& result,
+                                    std::chrono::steady_clock::time_point t0) {
+    uploadLatency_.recordSince(t0);
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+    if (result.ok()) {
+        LOGI("Uploaded %zu frames (%zu bytes) in %lld ms", frames, json.size(), (long long)ms);
+        stats_.chunksUploaded.fetch_add(chunks, std::memory_order_relaxed);
+        stats_.bytesUploaded.fetch_add(json.size(), std::memory_order_relaxed);
     } else {
-        __android_log_print(ANDROID_LOG_ERROR, "telemetria",
-                            "Upload FAILED, frames: %zu", chunk.size());
+        LOGE("Upload FAILED, frames: %zu, status: %d, after %lld ms", frames, result.httpStatus, (long long)ms);
+        stats_.chunksFailed.fetch_add(chunks, std::memory_order_relaxed);
+        // Keep it on disk; the drainer retries once the network is back (not before Retry-After).
+        if (spoolEnabled_) {
+            retryAfterSec_ = result.retryAfterSec;
+            offline_ = true;
+            spoolChunk(json, chunks, frames);
+        } else {
+            stats_.framesDropped.fetch_add(frames, std::memory_order_relaxed);
+        }
+    }
+}
+
+void GestorTelemetria::releaseInFlight() {
+    {
+        std::lock_guard<std::mutex> lk(qmtx_);
+        if (inFlight_ > 0) --inFlight_;
+        stats_.inFlight.store((long long)inFlight_, std::memory_order_relaxed);
+    }
+    ifcv_.notify_all();
+}
+
+bool GestorTelemetria::spoolChunk(const std::string& json, size_t chunks, size_t frames) {
+    if (!spool_.append(json)) {
+        stats_.framesDropped.fetch_add(frames, std::memory_order_relaxed);
+        return false;
+    }
+    stats_.chunksSpooled.fetch_add(chunks, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lk(qmtx_);
+        drainKick_ = true;
+    }
+    dcv_.notify_one();
+    return true;
+}
+
+void GestorTelemetria::drainerLoop() {
+    PipelineTrace::setThreadName("spool drainer");
+    AllocScope allocTag(kAllocUpload);
+    auto backoff = kDrainMinBackoff;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lk(qmtx_);
+            if (offline_) {
+                // Network is down: wait for the backoff delay before trying again (new chunks do not wake us).
+                // A Retry-After received by the worker also counts.
+                const int retryAfter = retryAfterSec_.exchange(0);
+                if (retryAfter > 0) backoff = std::max(backoff, std::chrono::seconds(retryAfter));
+                dcv_.wait_for(lk, backoff, [&]{ return stopDrainer_; });
+            } else {
+                dcv_.wait(lk, [&]{ return stopDrainer_ || drainKick_; });
+            }
+            if (stopDrainer_) break;
+            drainKick_ = false;
+        }
+        // Upload spooled records oldest first until the spool is empty or an upload fails.
+        std::string record;
+        while (spool_.peek(record)) {
+            UploadResult result;
+            const auto t0 = std::chrono::steady_clock::now();
+            bool ok;
+            {
+                TraceSpan span("http_spooled");
+                ok = uploader_ && uploader_->uploadJson(record, &result);
+            }
+            if (uploader_) uploadLatency_.recordSince(t0);
+            if (!ok) {
+                offline_ = true;
+                backoff = std::min(backoff * 2, kDrainMaxBackoff);
+                // The server asked us to wait (429/503): never retry earlier than that.
+                if (result.retryAfterSec > 0) {
+                    backoff = std::max(backoff, std::chrono::seconds(result.retryAfterSec));
+                }
+                LOGI("drainer: upload failed (status %d), retrying in %lld s",
+                     result.httpStatus, (long long)backoff.count());
+                break;
+            }
+            spool_.pop();
+            stats_.spoolRecordsUploaded.fetch_add(1, std::memory_order_relaxed);
+            stats_.bytesUploaded.fetch_add(record.size(), std::memory_order_relaxed);
+            offline_ = false;
+            backoff = kDrainMinBackoff;
+            LOGI("drainer: uploaded spooled chunk (%zu bytes), spool bytes left: %zu",
+                 record.size(), spool_.sizeBytes());
+
+            std::lock_guard<std::mutex> lk(qmtx_);
+            if (stopDrainer_) return;
+        }
     }
 }
 
 void GestorTelemetria::workerLoop() {
+    PipelineTrace::setThreadName("upload worker");
+    // Request bodies, spool writes and the batch itself; serializing is tagged in serializeAndSend
+    AllocScope allocTag(kAllocUpload);
     for (;;) {
-        std::vector<VRFrameDataPlain> chunk;
+        // Chunks that will be sent together in this iteration, oldest first, and the id of the first one.
+        std::vector<std::vector<VRFrameDataPlain>> batch;
+        uint64_t firstId = 0;
+        bool toSpool = false;
         {
             // Wait until there is work to do or a stop signal.
             std::unique_lock<std::mutex> lk(qmtx_);
-            qcv_.wait(lk, [&]{ return stopWorker_ || !queue_.empty(); });
-            if (stopWorker_ && queue_.empty()) break; // Stop requested and no more chunks to process.
-            chunk = std::move(queue_.front());
-            queue_.pop_front();
+            qcv_.wait(lk, [&]{ return stopWorker_ || !queue_.empty() || !spill_.empty(); });
+            // Stop requested and no more chunks to process.
+            if (stopWorker_ && queue_.empty() && spill_.empty()) break;
+            if (!spill_.empty()) {
+                // Chunks evicted while we were busy are older than anything in queue_, write them first.
+                batch.push_back(std::move(spill_.front()));
+                spill_.pop_front();
+                firstId = spillIds_.front();
+                spillIds_.pop_front();
+                toSpool = true;
+            } else {
+                // Queue backing up: write to disk (fast) instead of waiting for the network.
+                toSpool = spoolEnabled_ && queue_.size() >= maxQueuedChunks_;
+                // Coalescing window: give the producer a moment to seal more chunks so they share one request
+                // (and one radio wake-up). Stop, or a queue about to overflow, ends the wait early.
+                if (!toSpool && coalesceWindow_.count() > 0 && !stopWorker_) {
+                    qcv_.wait_for(lk, coalesceWindow_, [&]{
+                        return stopWorker_ || queue_.size() + 1 >= maxQueuedChunks_;
+                    });
+                }
+                // Take everything that is waiting; serializeAndSend splits it by maxRequestBytes_.
+                if (!queue_.empty()) firstId = queue_.front().id;
+                while (!queue_.empty()) {
+                    batch.push_back(std::move(queue_.front().frames));
+                    queueLatency_.recordSince(queue_.front().sealedAt);
+                    queue_.pop_front();
+                }
+            }
+            stats_.chunksQueued.store(queue_.size() + spill_.size(), std::memory_order_relaxed);
         }
         auto t0 = std::chrono::steady_clock::now();
 
-        // Serialize and upload outside of the queue lock.
-        serializeAndSend(chunk);
+        // Serialize and upload outside of the queue lock. With asynchronous uploads this only
+        // covers serializing and starting the request; the round trip is logged by onUploadComplete.
+        serializeAndSend(batch, firstId, toSpool);
 
+        size_t frames = 0;
+        for (const auto& chunk : batch) frames += chunk.size();
+        stats_.heldFrames.fetch_sub((long long)frames, std::memory_order_relaxed);
+        {
+            // Hand the vectors back to recordFrame
+            std::lock_guard<std::mutex> lock(mtx_);
+            for (auto& chunk : batch) {
+                if (spareChunks_.size() >= kMaxSpareChunks) break;
+                if (chunk.capacity() >= (size_t)std::max(cfg_.framesPerFile, 0)) spareChunks_.push_back(std::move(chunk));
+            }
+        }
         auto t1 = std::chrono::steady_clock::now();
         auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
-        __android_log_print(ANDROID_LOG_INFO, "telemetria",
-                            "worker: subido chunk de %zu frames en %lld ms",
-                            chunk.size(), (long long)ms);
+        LOGD("worker: enviados %zu chunk(s), %zu frames en %lld ms", batch.size(), frames, (long long)ms);
+    }
+}
+
+void GestorTelemetria::resetStats() {
+    for (auto* c : {&stats_.framesRecorded, &stats_.framesDropped, &stats_.chunksSealed, &stats_.chunksUploaded,
+                    &stats_.chunksFailed, &stats_.chunksEvicted, &stats_.chunksSpooled, &stats_.spoolRecordsUploaded,
+                    &stats_.bytesSerialized, &stats_.bytesUploaded, &stats_.chunksQueued}) {
+        c->store(0, std::memory_order_relaxed);
     }
-}
\ No newline at end of file
+    stats_.heldFrames.store(0, std::memory_order_relaxed);
+    stats_.inFlight.store(0, std::memory_order_relaxed);
+    stats_.inFlightBytes.store(0, std::memory_order_relaxed);
+    stats_.bufferFrames.store(0, std::memory_order_relaxed);
+    queueLatency_.reset();
+    serializeLatency_.reset();
+    uploadLatency_.reset();
+}
+
+void GestorTelemetria::getStats(TelemetryStatsPlain& out) const {
+    out.framesRecorded       = stats_.framesRecorded.load(std::memory_order_relaxed);
+    out.framesDropped        = stats_.framesDropped.load(std::memory_order_relaxed);
+    out.chunksSealed         = stats_.chunksSealed.load(std::memory_order_relaxed);
+    out.chunksUploaded       = stats_.chunksUploaded.load(std::memory_order_relaxed);
+    out.chunksFailed         = stats_.chunksFailed.load(std::memory_order_relaxed);
+    out.chunksEvicted        = stats_.chunksEvicted.load(std::memory_order_relaxed);
+    out.chunksSpooled        = stats_.chunksSpooled.load(std::memory_order_relaxed);
+    out.spoolRecordsUploaded = stats_.spoolRecordsUploaded.load(std::memory_order_relaxed);
+    out.bytesSerialized      = stats_.bytesSerialized.load(std::memory_order_relaxed);
+    out.bytesUploaded        = stats_.bytesUploaded.load(std::memory_order_relaxed);
+    out.chunksQueued         = stats_.chunksQueued.load(std::memory_order_relaxed);
+    out.uploadsInFlight      = (unsigned long long)std::max(0LL, stats_.inFlight.load(std::memory_order_relaxed));
+    out.spoolBytes           = spool_.sizeBytes(); // 0 while closed
+    // Front and spare buffers (reserved for a full chunk each) + sealed chunks not serialized yet + bodies of running uploads
+    const long long frames = std::max(0LL, stats_.heldFrames.load(std::memory_order_relaxed)) +
+                             stats_.bufferFrames.load(std::memory_order_relaxed);
+    out.memoryBytes += (unsigned long long)frames * sizeof(VRFrameDataPlain) +
+                       (unsigned long long)std::max(0LL, stats_.inFlightBytes.load(std::memory_order_relaxed));
+}
+
+void GestorTelemetria::getLatency(TelemetryLatencyStatsPlain& out) const {
+    queueLatency_.summarize(out.queueWait);
+    serializeLatency_.summarize(out.serialize);
+    uploadLatency_.summarize(out.upload);
+}
@@ -7,6 +7,12 @@
 #include <deque>
 #include <condition_variable>
 #include <thread>
+#include <atomic>
+#include <chrono>
+#include "UploadSpool.h"
+#include "LatencyHistogram.h"
+#include "AllocStats.h"
+#include "FixedRing.h"
 
 class AndroidUploader;
 
@@ -40,13 +46,25 @@ public:
     // - Flushes remaining frames in the buffer.
     // - Signals the worker thread to stop.
     // - Joins the worker thread to wait for completion.
+    // - Stops the spool drainer; anything not uploaded yet stays on disk for the next run.
     void shutdown();
 
+    // Fills the JSON path fields of out and adds the memory it holds to out.memoryBytes (lock free, any thread).
+    void getStats(TelemetryStatsPlain& out) const;
+    // Fills the queueWait, serialize and upload latencies of out (lock free, any thread).
+    void getLatency(TelemetryLatencyStatsPlain& out) const;
+
 private:
     // Mutex (mutex=mechanism to avoid multiple threads accesing the same resource) protecting the front buffer used by the producer thread(s).
     std::mutex mtx_;
     // Current batch of frames that will form the next JSON chunk.
     std::vector<VRFrameDataPlain> buffer_;
+    // Chunk vectors given back by the worker after serializing, reused as buffer_ so sealing a chunk
+    // does not allocate (guarded by mtx_).
+    std::vector<std::vector<VRFrameDataPlain>> spareChunks_;
+    static constexpr size_t kMaxSpareChunks = 2;
+    // Gives buffer_ room for a full chunk again after it was sealed. Called with mtx_ held.
+    void renewBufferLocked();
     // Copy of the uploader configuration (endpoint, flags, etc.).
     UploaderConfig cfg_;
     // Pointer to the uploader used to send JSON over HTTP.
@@ -57,9 +75,23 @@ private:
     std::string sessionId_;
     std::string deviceInfo_;
 
-    // Serializes a completed chunk to JSON and sends it through the uploader.
+    // Serializes completed chunks to JSON and sends them through the uploader, merging consecutive
+    // chunks into one request body as long as it stays under maxRequestBytes_.
     // This is invoked by the background worker thread.
-    void serializeAndSend(const std::vector<VRFrameDataPlain>& chunk);
+    // - firstId: id of chunks[0], the others follow it (used by the trace).
+    // - forceSpool: write them to the disk spool instead of uploading (queue backed up or chunk was spilled).
+    void serializeAndSend(const std::vector<std::vector<VRFrameDataPlain>>& chunks, uint64_t firstId, bool forceSpool);
+    // Uploads one request body holding chunks chunks / frames frames (or spools it if offline / forceSpool).
+    // Uses the asynchronous uploader when available, waiting only for a free in-flight slot.
+    void sendBody(std::string json, size_t chunks, size_t frames, uint64_t firstId, bool forceSpool);
+    // Completion of an asynchronous upload (runs on the Java HTTP thread): logs, spools on failure, frees the slot.
+    void onUploadComplete(const std::string& json, size_t chunks, size_t frames, uint64_t firstId,
+                          const UploadResult& result, std::chrono::steady_clock::time_point t0);
+    // Result of an upload started at t0, blocking or asynchronous: latency, stats, and on failure the spool
+    // (or the dropped frames) and the offline state for the drainer.
+    void finishUpload(const std::string& json, size_t chunks, size_t frames, const UploadResult& result,
+                      std::chrono::steady_clock::time_point t0);
+    void releaseInFlight();
 
     // --- Asynchronous upload queue and worker thread --
     // Background worker that waits for chunks and uploads them.
@@ -68,14 +100,89 @@ private:
     std::mutex qmtx_;
     // Condition variable used to wake the worker when new chunks arrive.
     std::condition_variable qcv_;
-    // Queue of chunks waiting to be serialized and uploaded.
-    std::deque<std::vector<VRFrameDataPlain>> queue_;
+    // Queue of chunks waiting to be serialized and uploaded, with when each one was sealed and its id.
+    // A fixed ring of maxQueuedChunks_ slots so sealing a chunk never allocates.
+    struct SealedChunk {
+        std::vector<VRFrameDataPlain> frames;
+        std::chrono::steady_clock::time_point sealedAt;
+        uint64_t id = 0;
+    };
+    FixedRing<SealedChunk> queue_;
+    // Id of the last sealed chunk, increasing, so queue_ always holds consecutive ids (guarded by qmtx_).
+    uint64_t chunkSeq_ = 0;
     // Flag used to request the worker thread to stop.
     bool stopWorker_ = false;
     // Simple backpressure: maximum number of chunks kept in the queue.
     // If this limit is reached, the oldest chunk is dropped (it most likely wont get above 2-3 in queue, but in case some bug happens).
     size_t maxQueuedChunks_ = 4;
+    // Request coalescing: how long the worker waits for more chunks before sending, and the
+    // maximum size of a merged request body (coalesceWindowMs / maxRequestKB, set in initialize).
+    std::chrono::milliseconds coalesceWindow_{0};
+    size_t maxRequestBytes_ = 1024 * 1024;
+    // Asynchronous uploads currently running and the limit (guarded by qmtx_, ifcv_ signals a free slot).
+    size_t inFlight_ = 0;
+    size_t maxInFlight_ = 2;
+    std::condition_variable ifcv_;
 
     // Worker loop: takes chunks from the queue, serializes and uploads them.
     void workerLoop();
+
+    // --- Offline spool and drainer thread ---
+    // Disk spool used when the network is down or the queue is over maxQueuedChunks_.
+    UploadSpool spool_;
+    bool spoolEnabled_ = false;
+    // Chunks evicted from queue_ while the worker was busy. The worker writes them to the spool
+    // before anything else so the order of the data is kept (guarded by qmtx_).
+    std::deque<std::vector<VRFrameDataPlain>> spill_;
+    std::deque<uint64_t> spillIds_;
+    // Background thread that uploads the spool in order when the network is back.
+    std::thread drainer_;
+    // Condition variable used to wake the drainer (guarded by qmtx_).
+    std::condition_variable dcv_;
+    bool stopDrainer_ = false;
+    bool drainKick_ = false;
+    // True after an upload failed, until the drainer manages to upload again.
+    std::atomic<bool> offline_{false};
+    // Retry-After (seconds) of the last failed worker upload, consumed by the drainer backoff.
+    std::atomic<int> retryAfterSec_{0};
+
+    // Appends an encoded body (chunks chunks, frames frames) to the spool and wakes the drainer.
+    // Returns false if the spool rejected it (the frames are counted as dropped).
+    bool spoolChunk(const std::string& json, size_t chunks, size_t frames);
+    // Drainer loop: uploads spooled records oldest first, retrying with exponential backoff while offline.
+    void drainerLoop();
+    // Pushes a sealed chunk into queue_ applying the maxQueuedChunks_ limit. Called with qmtx_ held.
+    void enqueueChunkLocked(std::vector<VRFrameDataPlain>&& chunk);
+
+    // --- Statistics for telemetry_get_stats ---
+    // Relaxed atomics updated by the producer, worker, drainer and HTTP threads without taking any lock.
+    struct Stats {
+        std::atomic<unsigned long long> framesRecorded{0};
+        std::atomic<unsigned long long> framesDropped{0};
+        std::atomic<unsigned long long> chunksSealed{0};
+        std::atomic<unsigned long long> chunksUploaded{0};
+        std::atomic<unsigned long long> chunksFailed{0};
+        std::atomic<unsigned long long> chunksEvicted{0};
+        std::atomic<unsigned long long> chunksSpooled{0};
+        std::atomic<unsigned long long> spoolRecordsUploaded{0};
+        std::atomic<unsigned long long> bytesSerialized{0};
+        std::atomic<unsigned long long> bytesUploaded{0};
+        // Gauges
+        std::atomic<unsigned long long> chunksQueued{0};   // queue_ + spill_
+        std::atomic<long long> heldFrames{0};              // frames in queue_, spill_ and the worker batch
+        std::atomic<long long> inFlight{0};                // mirror of inFlight_
+        std::atomic<long long> inFlightBytes{0};           // request bodies kept by asynchronous uploads
+        std::atomic<long long> bufferFrames{0};            // capacity reserved for buffer_ and spareChunks_
+    };
+    Stats stats_;
+    void resetStats();
+    // Stage latencies: time a chunk waits in queue_, toJsonFlat per chunk, HTTP round trip per request.
+    LatencyHistogram queueLatency_;
+    LatencyHistogram serializeLatency_;
+    LatencyHistogram uploadLatency_;
 };
+
+// Serializes frames into the flat JSON array uploaded to the backend, with the optional fields enabled in cfgFlags.
+// Called by the upload worker for each chunk; declared here for telemetria_bench.
+std::string toJsonFlat(const std::vector<VRFrameDataPlain>& frames, const std::string& sessionId,
+                       const std::string& deviceInfo, const UploaderConfig& cfgFlags);
@@ -0,0 +1,323 @@
+#include "JniHttpTransport.h"
+#include "PipelineTrace.h"
+#include <atomic>
+#include <unordered_map>
+
+#include "TelemetriaLog.h"
+
+// Callbacks of asynchronous requests still running, by request id. Java only gets the id, and hands it back
+// in nativeOnRequestComplete. Static because the JNI callback is a plain function without an instance.
+static std::mutex g_pendingMtx;
+static std::unordered_map<jlong, UploadTransport::Callback> g_pending;
+static std::atomic<jlong> g_nextRequestId{1};
+
+// Helper to log full Java exceptions to Logcat. Can be deleted but useful for debugging.
+static void logJavaException(JNIEnv* env, const char* where) {
+    if (!env->ExceptionCheck()) return;
+    jthrowable ex = env->ExceptionOccurred();
+    env->ExceptionClear();
+
+    jclass logCls = env->FindClass("android/util/Log");
+    jmethodID getStack = env->GetStaticMethodID(logCls, "getStackTraceString",
+                                                "(Ljava/lang/Throwable;)Ljava/lang/String;");
+    jstring jstack = (jstring)env->CallStaticObjectMethod(logCls, getStack, ex);
+
+    if (jstack) {
+        const char* cstack = env->GetStringUTFChars(jstack, nullptr);
+        LOGE("Java exception at %s:\n%s", where, cstack);
+        env->ReleaseStringUTFChars(jstack, cstack);
+        env->DeleteLocalRef(jstack);
+    } else {
+        jclass thrCls = env->FindClass("java/lang/Throwable");
+        jmethodID toString = env->GetMethodID(thrCls, "toString", "()Ljava/lang/String;");
+        jstring jmsg = (jstring)env->CallObjectMethod(ex, toString);
+        const char* cmsg = jmsg ? env->GetStringUTFChars(jmsg, nullptr) : "unknown";
+        LOGE("Java exception at %s: %s", where, cmsg);
+        if (jmsg) { env->ReleaseStringUTFChars(jmsg, cmsg); env->DeleteLocalRef(jmsg); }
+    }
+}
+
+// Gets a JNIEnv for the current thread, attaching it to the JVM if needed, and detaches on scope exit
+// only if it was attached here (threads created by Java or the engine stay attached).
+namespace {
+    struct ScopedJniEnv {
+        JavaVM* vm = nullptr;
+        JNIEnv* env = nullptr;
+        bool needDetach = false;
+
+        explicit ScopedJniEnv(JavaVM* v) : vm(v) {
+            if (!vm) return;
+            if (vm->GetEnv((void**)&env, JNI_VERSION_1_6) != JNI_OK || !env) {
+                env = nullptr;
+                if (vm->AttachCurrentThread(&env, nullptr) != JNI_OK || !env) {
+                    LOGE("AttachCurrentThread failed");
+                    env = nullptr;
+                    return;
+                }
+                needDetach = true;
+            }
+        }
+        ~ScopedJniEnv() {
+            if (needDetach) vm->DetachCurrentThread();
+        }
+    };
+}
+
+// Java -> native: static native void nativeOnRequestComplete(long requestId, int status, int retryAfterSec,
+//                                                            long bytesSent, long bytesReceived)
+// Called by AyudanteHttp on its executor thread when an asynchronous request ends.
+static void JNICALL nativeOnRequestComplete(JNIEnv*, jclass, jlong requestId, jint status, jint retryAfterSec,
+                                            jlong bytesSent, jlong bytesReceived) {
+    UploadTransport::Callback done;
+    {
+        std::lock_guard<std::mutex> lk(g_pendingMtx);
+        auto it = g_pending.find(requestId);
+        if (it == g_pending.end()) return; // cancelled by shutdown
+        done = std::move(it->second);
+        g_pending.erase(it);
+    }
+    UploadResult result;
+    result.httpStatus = (int)status;
+    result.retryAfterSec = (int)retryAfterSec;
+    result.bytesSent = (long long)bytesSent;
+    result.bytesReceived = (long long)bytesReceived;
+    if (done) done(result);
+}
+
+// Creates the java.util.HashMap with the headers (local ref, caller deletes it).
+static jobject newHeaderMap(JNIEnv* env, const HttpHeaders& headers) {
+    jclass mapCls = env->FindClass("java/util/HashMap");
+    jmethodID mapCtor = env->GetMethodID(mapCls, "<init>", "()V");
+    jobject jMap = env->NewObject(mapCls, mapCtor);
+    //obtain method and for each header creates java string and adds it to the map
+    jmethodID mapPut = env->GetMethodID(mapCls, "put",
+                                        "(Ljava/lang/Object;Ljava/lang/Object;)Ljava/lang/Object;");
+    for (const auto& kv : headers) {
+        jstring k = env->NewStringUTF(kv.first.c_str());
+        jstring v = env->NewStringUTF(kv.second.c_str());
+        env->CallObjectMethod(jMap, mapPut, k, v);
+        env->DeleteLocalRef(k);
+        env->DeleteLocalRef(v);
+    }
+    env->DeleteLocalRef(mapCls);
+    return jMap;
+}
+
+// copies the string to a java array (nullptr for an empty body)
+static jbyteArray newBodyArray(JNIEnv* env, const std::string& body) {
+    if (body.empty()) return nullptr;
+    jbyteArray jBody = env->NewByteArray((jsize)body.size());
+    env->SetByteArrayRegion(jBody, 0, (jsize)body.size(), reinterpret_cast<const jbyte*>(body.data()));
+    return jBody;
+}
+
+JniHttpTransport::JniHttpTransport(JavaVM* vm, jobject activityGlobalRef)
+        : vm_(vm), activity_(activityGlobalRef) {}
+
+// Checks that we have both a VM and an Activity and loads the Java helper once.
+bool JniHttpTransport::initialize(const UploaderConfig& cfg) {
+    url_ = cfg.endpointUrl;
+    debug_ = cfg.debugHttp;
+    if (!vm_ || !activity_) {
+        LOGE("JniHttpTransport initialize without VM or Activity");
+        return false;
+    }
+    // Not fatal: requests try to load it again later.
+    ScopedJniEnv jni(vm_);
+    if (!jni.env || !loadHelperClass(jni.env)) {
+        LOGE("JniHttpTransport: AyudanteHttp could not be loaded yet");
+    }
+    return true;
+}
+
+// Pending asynchronous callbacks are dropped (late completions are ignored) and the class ref is released.
+void JniHttpTransport::shutdown() {
+    {
+        std::lock_guard<std::mutex> lk(g_pendingMtx);
+        if (!g_pending.empty()) {
+            LOGI("JniHttpTransport: ignoring %zu request(s) still in flight", g_pending.size());
+        }
+        g_pending.clear();
+    }
+    std::lock_guard<std::mutex> lock(clsMtx_);
+    if (helperCls_) {
+        ScopedJniEnv jni(vm_);
+        if (jni.env) jni.env->DeleteGlobalRef(helperCls_);
+        helperCls_ = nullptr;
+        makeReqResult_ = nullptr;
+        makeReqAsync_ = nullptr;
+    }
+}
+
+bool JniHttpTransport::loadHelperClass(JNIEnv* env) {
+    std::lock_guard<std::mutex> lock(clsMtx_);
+    if (helperCls_) return true;
+
+    //try to get the class from the activity
+    jclass activityCls = env->GetObjectClass(activity_);
+    if (!activityCls) {
+        LOGE("activity class not found");
+        return false;
+    }
+
+    // loading the class
+    jmethodID getClassLoader = env->GetMethodID(activityCls, "getClassLoader", "()Ljava/lang/ClassLoader;");
+    jobject loaderObj = env->CallObjectMethod(activity_, getClassLoader);
+    jclass loaderCls = env->GetObjectClass(loaderObj);
+    jmethodID loadClass = env->GetMethodID(loaderCls, "loadClass", "(Ljava/lang/String;)Ljava/lang/Class;");
+    // create java string with the class name and delete the local ref, exit if class not found
+    jstring jName = env->NewStringUTF("io.github.migueldulu.telemetria.AyudanteHttp");
+    jclass localCls = (jclass)env->CallObjectMethod(loaderObj, loadClass, jName);
+    logJavaException(env, "JniHttpTransport.loadHelperClass");
+    env->DeleteLocalRef(jName);
+    env->DeleteLocalRef(loaderCls);
+    env->DeleteLocalRef(loaderObj);
+    env->DeleteLocalRef(activityCls);
+    if (!localCls) {
+        LOGE("AyudanteHttp class not found");
+        return false;
+    }
+
+    // Signature: public static long[] makeRequestResult(String method, String url, byte[] body, Map<String,String> headers, boolean debug)
+    // ([B = array de bytes, [J = array de longs: status, retryAfter, bytesSent, bytesReceived)
+    jmethodID makeReqResult = env->GetStaticMethodID(localCls, "makeRequestResult",
+                                                     "(Ljava/lang/String;Ljava/lang/String;[BLjava/util/Map;Z)[J");
+    if (!makeReqResult) {
+        logJavaException(env, "JniHttpTransport.loadHelperClass");
+        env->DeleteLocalRef(localCls);
+        LOGE("makeRequestResult method not found");
+        return false;
+    }
+
+    // Signature: public static boolean makeRequestAsync(long requestId, String method, String url, byte[] body, Map<String,String> headers, boolean debug)
+    // Optional: without it (or if natives cannot be registered) uploads stay blocking.
+    jmethodID makeReqAsync = env->GetStaticMethodID(localCls, "makeRequestAsync",
+                                                    "(JLjava/lang/String;Ljava/lang/String;[BLjava/util/Map;Z)Z");
+    if (makeReqAsync) {
+        static const JNINativeMethod kNatives[] = {
+                {"nativeOnRequestComplete", "(JIIJJ)V", reinterpret_cast<void*>(nativeOnRequestComplete)},
+        };
+        if (env->RegisterNatives(localCls, kNatives, 1) != JNI_OK) {
+            logJavaException(env, "JniHttpTransport.RegisterNatives");
+            LOGE("RegisterNatives failed, using blocking uploads");
+            makeReqAsync = nullptr;
+        }
+    } else {
+        env->ExceptionClear(); // NoSuchMethodError
+        LOGI("AyudanteHttp.makeRequestAsync not available, using blocking uploads");
+    }
+
+    helperCls_ = (jclass)env->NewGlobalRef(localCls);
+    env->DeleteLocalRef(localCls);
+    makeReqResult_ = makeReqResult;
+    makeReqAsync_ = makeReqAsync;
+    return true;
+}
+
+bool JniHttpTransport::supportsAsync() const {
+    std::lock_guard<std::mutex> lock(clsMtx_);
+    return makeReqAsync_ != nullptr;
+}
+
+// Core JNI bridge that calls the Java static method:
+//   long[] AyudanteHttp.makeRequestResult(String method, String url, byte[] body, Map<String,String> headers, boolean debug)
+// This function attaches the thread to the JVM if necessary and detaches it if it was attached here.
+// Only the 4 result numbers are copied back, the response body never reaches native code.
+bool JniHttpTransport::post(const std::string& body, const HttpHeaders& headers, UploadResult& result) {
+    if (!vm_ || !activity_) return false;
+
+    // Get JNIEnv for the current thread; if not attached, it is attached until the end of this function.
+    ScopedJniEnv jni(vm_);
+    JNIEnv* env = jni.env;
+    if (!env) return false;
+
+    if (!loadHelperClass(env)) return false;
+    jclass helperCls;
+    jmethodID makeReqResult;
+    {
+        std::lock_guard<std::mutex> lock(clsMtx_);
+        helperCls = helperCls_;
+        makeReqResult = makeReqResult_;
+    }
+
+    // Body copy, call and cleanup; the request itself runs inside it (blocking call)
+    TraceSpan span("jni_post");
+    jstring jMethod = env->NewStringUTF("POST");
+    jstring jUrl = env->NewStringUTF(url_.c_str());
+    jbyteArray jBody = newBodyArray(env, body);
+    jobject jMap = newHeaderMap(env, headers);
+
+    jlongArray jRes = (jlongArray)env->CallStaticObjectMethod(helperCls, makeReqResult, jMethod, jUrl, jBody, jMap,
+                                                              (jboolean)(debug_ ? JNI_TRUE : JNI_FALSE));
+    logJavaException(env, "JniHttpTransport.post");
+
+    //clean any local ref created
+    if (jBody) env->DeleteLocalRef(jBody);
+    env->DeleteLocalRef(jMethod);
+    env->DeleteLocalRef(jUrl);
+    env->DeleteLocalRef(jMap);
+
+    if (!jRes) {
+        LOGE("HTTP call returned null");
+        return false;
+    }
+    // [status, retryAfterSec, bytesSent, bytesReceived] (see AyudanteHttp.RESULT_*)
+    jlong values[4] = {-1, 0, 0, 0};
+    if (env->GetArrayLength(jRes) >= 4) {
+        env->GetLongArrayRegion(jRes, 0, 4, values);
+    }
+    env->DeleteLocalRef(jRes);
+    result.httpStatus = (int)values[0];
+    result.retryAfterSec = (int)values[1];
+    result.bytesSent = (long long)values[2];
+    result.bytesReceived = (long long)values[3];
+    return result.httpStatus >= 0;
+}
+
+// Same request as post, but AyudanteHttp returns immediately and reports back through nativeOnRequestComplete.
+bool JniHttpTransport::postAsync(const std::string& body, const HttpHeaders& headers, Callback done) {
+    jclass cls;
+    jmethodID makeReqAsync;
+    {
+        std::lock_guard<std::mutex> lock(clsMtx_);
+        cls = helperCls_;
+        makeReqAsync = makeReqAsync_;
+    }
+    if (!cls || !makeReqAsync || !vm_) return false;
+
+    ScopedJniEnv jni(vm_);
+    JNIEnv* env = jni.env;
+    if (!env) return false;
+
+    // Register the callback before starting: the request may finish before CallStaticBooleanMethod returns.
+    const jlong requestId = g_nextRequestId.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lk(g_pendingMtx);
+        g_pending.emplace(requestId, std::move(done));
+    }
+
+    // Body copy and hand-off to the executor
+    TraceSpan span("jni_post_async");
+    jstring jMethod = env->NewStringUTF("POST");
+    jstring jUrl = env->NewStringUTF(url_.c_str());
+    jbyteArray jBody = newBodyArray(env, body);
+    jobject jMap = newHeaderMap(env, headers);
+
+    jboolean started = env->CallStaticBooleanMethod(cls, makeReqAsync, requestId, jMethod, jUrl, jBody, jMap,
+                                                    (jboolean)(debug_ ? JNI_TRUE : JNI_FALSE));
+    logJavaException(env, "JniHttpTransport.postAsync");
+
+    if (jBody) env->DeleteLocalRef(jBody);
+    env->DeleteLocalRef(jMethod);
+    env->DeleteLocalRef(jUrl);
+    env->DeleteLocalRef(jMap);
+
+    if (!started) {
+        // Not started (executor rejected it or exception): the callback will never run, take it back.
+        std::lock_guard<std::mutex> lk(g_pendingMtx);
+        g_pending.erase(requestId);
+        LOGE("makeRequestAsync did not start request %lld", (long long)requestId);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <jni.h>
+#include <mutex>
+#include "UploadTransport.h"
+
+// Transport that calls the Java helper AyudanteHttp (makeRequestResult / makeRequestAsync) via JNI.
+// It does NOT perform HTTP by itself; HttpURLConnection on the Java side handles TLS and the
+// certificates required by backends like Supabase. Android only.
+class JniHttpTransport : public UploadTransport {
+public:
+    // vm/activity: Java VM and global Activity reference (not owned), used to obtain a JNIEnv* and
+    // the Activity class loader that can see the AyudanteHttp class of the AAR.
+    JniHttpTransport(JavaVM* vm, jobject activityGlobalRef);
+    ~JniHttpTransport() override = default;
+
+    // Loads AyudanteHttp once and registers the native completion callback used by postAsync.
+    // Not fatal if the class cannot be loaded yet: requests try again later.
+    bool initialize(const UploaderConfig& cfg) override;
+
+    // Drops the callbacks of requests still running (their results are ignored) and releases the cached class.
+    void shutdown() override;
+
+    bool post(const std::string& body, const HttpHeaders& headers, UploadResult& result) override;
+
+    // AyudanteHttp performs the request on its own executor and reports the result through
+    // nativeOnRequestComplete, which runs `done` on that Java thread.
+    bool postAsync(const std::string& body, const HttpHeaders& headers, Callback done) override;
+
+    // True if the loaded AyudanteHttp has the asynchronous entry point and its callback could be registered.
+    bool supportsAsync() const override;
+
+private:
+    // Cached Java VM pointer, used to attach/detach threads and obtain JNIEnv*.
+    JavaVM* vm_ = nullptr;
+    jobject activity_ = nullptr; // global ref, not owned
+
+    std::string url_;
+    bool debug_ = false;
+
+    // AyudanteHttp class (global ref) and its static methods, loaded once.
+    mutable std::mutex clsMtx_;
+    jclass helperCls_ = nullptr;
+    jmethodID makeReqResult_ = nullptr;
+    jmethodID makeReqAsync_ = nullptr;
+
+    // Loads AyudanteHttp through the Activity class loader (FindClass would use the system loader
+    // on native threads and not see the AAR classes), caches the method ids and registers natives.
+    bool loadHelperClass(JNIEnv* env);
+};
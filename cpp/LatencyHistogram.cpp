@@ -0,0 +1,48 @@
+#include "LatencyHistogram.h"
+
+void LatencyHistogram::reset() {
+    for (auto& c : counts_) c.store(0, std::memory_order_relaxed);
+    count_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::bucketHigh(size_t b) {
+    if (b < kLinear) return b;
+    const size_t e = (b - kLinear) / kSubCount + kSubBits + 1;
+    const uint64_t sub = (b - kLinear) % kSubCount;
+    const uint64_t width = (uint64_t)1 << (e - kSubBits);
+    return (kSubCount + sub) * width + width - 1;
+}
+
+void LatencyHistogram::summarize(TelemetryLatencyPlain& out) const {
+    uint64_t counts[kBuckets];
+    uint64_t total = 0;
+    for (size_t b = 0; b < kBuckets; ++b) {
+        counts[b] = counts_[b].load(std::memory_order_relaxed);
+        total += counts[b];
+    }
+    const uint64_t maxNs = max_.load(std::memory_order_relaxed);
+    out = TelemetryLatencyPlain();
+    out.count = total;
+    out.maxUs = maxNs / 1000.0;
+    if (total == 0) return;
+
+    // Nearest rank: the p-th percentile is the ceil(p * count)-th smallest value
+    const double fractions[3] = {0.50, 0.90, 0.99};
+    double* results[3] = {&out.p50Us, &out.p90Us, &out.p99Us};
+    uint64_t ranks[3];
+    for (int i = 0; i < 3; ++i) {
+        const double r = fractions[i] * (double)total;
+        ranks[i] = std::max<uint64_t>(1, (uint64_t)r + ((double)(uint64_t)r < r ? 1 : 0));
+    }
+    int next = 0;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < kBuckets && next < 3; ++b) {
+        seen += counts[b];
+        while (next < 3 && seen >= ranks[next]) {
+            const uint64_t high = bucketHigh(b);
+            *results[next] = (high < maxNs ? high : maxNs) / 1000.0;
+            ++next;
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "TiposTelemetria.h"
+
+// Fixed-memory latency histogram with log-spaced buckets (HDR style): every power of two is split in 16
+// linear sub-buckets, so a value is kept with at most 1/16 (6.25%) relative error from 1 ns up to ~36
+// minutes, in 608 counters (~5 KB). record() is a few relaxed atomic operations and never takes a lock or
+// allocates, so it can run on the engine thread; percentiles are computed by the reader.
+class LatencyHistogram {
+public:
+    LatencyHistogram() { reset(); }
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void record(uint64_t ns) {
+        counts_[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        uint64_t prev = max_.load(std::memory_order_relaxed);
+        while (ns > prev && !max_.compare_exchange_weak(prev, ns, std::memory_order_relaxed)) {
+        }
+    }
+
+    void recordSince(std::chrono::steady_clock::time_point t0) {
+        const auto d = std::chrono::steady_clock::now() - t0;
+        record((uint64_t)std::max<long long>(0, std::chrono::duration_cast<std::chrono::nanoseconds>(d).count()));
+    }
+
+    // Not atomic as a whole: values recorded meanwhile may or may not be cleared.
+    void reset();
+
+    // Count, p50/p90/p99 (upper bound of the bucket, capped at the max) and max, in microseconds.
+    // Concurrent record() calls can make the result slightly inconsistent, never invalid.
+    void summarize(TelemetryLatencyPlain& out) const;
+
+private:
+    static constexpr int kSubBits = 4;
+    static constexpr uint64_t kSubCount = 1u << kSubBits;
+    static constexpr int kMaxExponent = 40; // 2^41 ns ~ 36 min, anything above goes to the last bucket
+    static constexpr size_t kLinear = 2 * kSubCount; // values below 32 ns have their own bucket
+    static constexpr size_t kBuckets = kLinear + (kMaxExponent - kSubBits) * kSubCount;
+
+    std::atomic<uint64_t> counts_[kBuckets];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> max_;
+
+    static size_t bucketOf(uint64_t ns) {
+        if (ns < kLinear) return (size_t)ns;
+        int e = 63 - __builtin_clzll(ns); // >= kSubBits + 1
+        if (e > kMaxExponent) return kBuckets - 1;
+        const uint64_t sub = (ns >> (e - kSubBits)) - kSubCount;
+        return kLinear + (size_t)(e - kSubBits - 1) * kSubCount + (size_t)sub;
+    }
+    // Largest value that falls in bucket b.
+    static uint64_t bucketHigh(size_t b);
+};
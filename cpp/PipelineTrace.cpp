@@ -0,0 +1,207 @@
+#include "PipelineTrace.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <vector>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+
+#include "TelemetriaLog.h"
+
+std::atomic<bool> PipelineTrace::enabled_{false};
+
+namespace {
+    // Event phases, expanded to Chrome phases by the dump
+    enum : char { kComplete = 'X', kAsync = 'A', kFlowStart = 's', kFlowStep = 't', kFlowEnd = 'f' };
+
+    // One event. The fields are atomics because dump() may read a slot while its thread reuses it
+    // (those reads are detected and dropped); relaxed accesses are plain loads and stores.
+    struct Slot {
+        std::atomic<const char*> name{nullptr};
+        std::atomic<uint64_t> ts{0};
+        std::atomic<uint64_t> dur{0};
+        std::atomic<uint64_t> id{0};
+        std::atomic<char> phase{0};
+    };
+
+    // Ring of one thread. Only that thread writes; head counts every event written so far.
+    struct ThreadBuffer {
+        int tid = 0;
+        char pthreadName[16] = {0};
+        std::atomic<const char*> name{nullptr};
+        std::atomic<uint64_t> head{0};
+        Slot slots[PipelineTrace::kEventsPerThread];
+    };
+
+    struct Event {
+        const char* name;
+        uint64_t ts, dur, id;
+        char phase;
+    };
+
+    std::mutex g_registryMtx;
+    ThreadBuffer* g_buffers[PipelineTrace::kMaxThreads];
+    size_t g_bufferCount = 0; // guarded by g_registryMtx
+
+    thread_local ThreadBuffer* t_buffer = nullptr;
+    thread_local bool t_untraced = false; // registry was full
+    thread_local const char* t_name = nullptr;
+
+    ThreadBuffer* threadBuffer() {
+        if (t_buffer || t_untraced) return t_buffer;
+        std::lock_guard<std::mutex> lock(g_registryMtx);
+        if (g_bufferCount >= PipelineTrace::kMaxThreads) {
+            t_untraced = true;
+            return nullptr;
+        }
+        // Never freed: the dump may still need the events of a thread that is gone
+        ThreadBuffer* b = new ThreadBuffer();
+        b->tid = (int)::syscall(SYS_gettid);
+        ::prctl(PR_GET_NAME, b->pthreadName); // pthread_getname_np needs API 26
+        b->name.store(t_name ? t_name : b->pthreadName, std::memory_order_relaxed);
+        g_buffers[g_bufferCount++] = b;
+        t_buffer = b;
+        return b;
+    }
+
+    void push(char phase, const char* name, uint64_t ts, uint64_t dur, uint64_t id) {
+        ThreadBuffer* b = threadBuffer();
+        if (!b) return;
+        const uint64_t h = b->head.load(std::memory_order_relaxed);
+        Slot& s = b->slots[h & (PipelineTrace::kEventsPerThread - 1)];
+        s.name.store(name, std::memory_order_relaxed);
+        s.ts.store(ts, std::memory_order_relaxed);
+        s.dur.store(dur, std::memory_order_relaxed);
+        s.id.store(id, std::memory_order_relaxed);
+        s.phase.store(phase, std::memory_order_relaxed);
+        b->head.store(h + 1, std::memory_order_release);
+    }
+
+    // Copies the events of b that were not overwritten while copying.
+    void snapshot(ThreadBuffer* b, std::vector<Event>& out) {
+        constexpr uint64_t cap = PipelineTrace::kEventsPerThread;
+        const uint64_t end = b->head.load(std::memory_order_acquire);
+        const uint64_t begin = end > cap ? end - cap : 0;
+        const size_t first = out.size();
+        for (uint64_t i = begin; i < end; ++i) {
+            const Slot& s = b->slots[i & (cap - 1)];
+            out.push_back(Event{s.name.load(std::memory_order_relaxed), s.ts.load(std::memory_order_relaxed),
+                                s.dur.load(std::memory_order_relaxed), s.id.load(std::memory_order_relaxed),
+                                s.phase.load(std::memory_order_relaxed)});
+        }
+        // Events written meanwhile reused the oldest slots
+        const uint64_t endAfter = b->head.load(std::memory_order_acquire);
+        const uint64_t valid = endAfter > cap ? endAfter - cap : 0;
+        if (valid > begin) {
+            const size_t torn = (size_t)std::min<uint64_t>(valid - begin, end - begin);
+            out.erase(out.begin() + (long)first, out.begin() + (long)(first + torn));
+        }
+    }
+}
+
+void PipelineTrace::setEnabled(bool on) {
+    enabled_.store(on, std::memory_order_relaxed);
+    LOGI("PipelineTrace: tracing %s", on ? "enabled" : "disabled");
+}
+
+uint64_t PipelineTrace::nowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void PipelineTrace::setThreadName(const char* name) {
+    t_name = name;
+    if (t_buffer) t_buffer->name.store(name, std::memory_order_relaxed);
+}
+
+void PipelineTrace::complete(const char* name, uint64_t startNs, uint64_t endNs, uint64_t id) {
+    if (!enabled()) return;
+    push(kComplete, name, startNs, endNs > startNs ? endNs - startNs : 0, id);
+}
+
+void PipelineTrace::asyncSpan(const char* name, uint64_t id, uint64_t startNs, uint64_t endNs) {
+    if (!enabled()) return;
+    push(kAsync, name, startNs, endNs > startNs ? endNs - startNs : 0, id);
+}
+
+void PipelineTrace::flowStart(uint64_t id) {
+    if (!enabled()) return;
+    push(kFlowStart, "chunk", nowNs(), 0, id);
+}
+
+void PipelineTrace::flowStep(uint64_t id) {
+    if (!enabled()) return;
+    push(kFlowStep, "chunk", nowNs(), 0, id);
+}
+
+void PipelineTrace::flowEnd(uint64_t id) {
+    if (!enabled()) return;
+    push(kFlowEnd, "chunk", nowNs(), 0, id);
+}
+
+bool PipelineTrace::dumpChromeJson(const std::string& path) {
+    std::vector<ThreadBuffer*> buffers;
+    {
+        std::lock_guard<std::mutex> lock(g_registryMtx);
+        buffers.assign(g_buffers, g_buffers + g_bufferCount);
+    }
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) {
+        LOGE("PipelineTrace: cannot create '%s': %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    const int pid = (int)getpid();
+    size_t written = 0;
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(f, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%d,\"tid\":0,\"args\":{\"name\":\"telemetria\"}}", pid);
+    std::vector<Event> events;
+    for (ThreadBuffer* b : buffers) {
+        const char* name = b->name.load(std::memory_order_relaxed);
+        fprintf(f, ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                pid, b->tid, name && name[0] ? name : "thread");
+        events.clear();
+        snapshot(b, events);
+        for (const Event& e : events) {
+            if (!e.name) continue;
+            const double ts = e.ts / 1000.0; // Chrome timestamps are microseconds
+            switch (e.phase) {
+                case kComplete:
+                    fprintf(f, ",\n{\"ph\":\"X\",\"cat\":\"telemetria\",\"name\":\"%s\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+                            e.name, pid, b->tid, ts, e.dur / 1000.0);
+                    if (e.id) fprintf(f, ",\"args\":{\"id\":%llu}", (unsigned long long)e.id);
+                    fprintf(f, "}");
+                    break;
+                case kAsync:
+                    fprintf(f, ",\n{\"ph\":\"b\",\"cat\":\"%s\",\"name\":\"%s\",\"id\":%llu,\"pid\":%d,\"tid\":%d,\"ts\":%.3f}",
+                            e.name, e.name, (unsigned long long)e.id, pid, b->tid, ts);
+                    fprintf(f, ",\n{\"ph\":\"e\",\"cat\":\"%s\",\"name\":\"%s\",\"id\":%llu,\"pid\":%d,\"tid\":%d,\"ts\":%.3f}",
+                            e.name, e.name, (unsigned long long)e.id, pid, b->tid, (e.ts + e.dur) / 1000.0);
+                    break;
+                case kFlowStart:
+                case kFlowStep:
+                case kFlowEnd:
+                    // Flow events attach to the span of the same thread that encloses them ("bp":"e")
+                    fprintf(f, ",\n{\"ph\":\"%c\",\"cat\":\"chunk\",\"name\":\"%s\",\"id\":%llu,\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"bp\":\"e\"}",
+                            e.phase, e.name, (unsigned long long)e.id, pid, b->tid, ts);
+                    break;
+                default:
+                    continue;
+            }
+            ++written;
+        }
+    }
+    fprintf(f, "\n]}\n");
+    const bool ok = fflush(f) == 0 && !ferror(f);
+    fclose(f);
+    if (ok) {
+        LOGI("PipelineTrace: %zu events of %zu threads written to '%s'", written, buffers.size(), path.c_str());
+    } else {
+        LOGE("PipelineTrace: write to '%s' failed", path.c_str());
+    }
+    return ok;
+}
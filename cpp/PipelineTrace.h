@@ -0,0 +1,61 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <cstdint>
+
+// Optional span tracing of the pipeline (record, seal, serialize, JNI call, HTTP, C3D write), dumped as
+// Chrome trace JSON that opens in ui.perfetto.dev or chrome://tracing. Chunk ids are emitted as flow
+// events, so a chunk can be followed from the frame that sealed it to the request that uploaded it.
+//
+// Off by default ("trace" in initialConfig.json or telemetry_trace_enable). While off every call is a
+// relaxed load and a branch. While on, each thread writes into its own fixed ring of events (allocated on
+// its first event, the newest kEventsPerThread are kept) with no locks; dump() can run at any time.
+//
+// Names must be string literals (only the pointer is stored).
+class PipelineTrace {
+public:
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+    static void setEnabled(bool on);
+
+    // CLOCK_MONOTONIC in nanoseconds (same clock as std::chrono::steady_clock).
+    static uint64_t nowNs();
+
+    // Name of the calling thread in the trace (default: its pthread name).
+    static void setThreadName(const char* name);
+
+    // Span of the calling thread. id > 0 is shown as an argument.
+    static void complete(const char* name, uint64_t startNs, uint64_t endNs, uint64_t id = 0);
+    // Span that starts and ends on different threads (HTTP round trip), shown on its own track.
+    static void asyncSpan(const char* name, uint64_t id, uint64_t startNs, uint64_t endNs);
+    // Flow arrows between spans: start inside the first span, step/end inside the next ones (same id).
+    static void flowStart(uint64_t id);
+    static void flowStep(uint64_t id);
+    static void flowEnd(uint64_t id);
+
+    // Writes every buffered event to path as Chrome trace JSON. Returns false on I/O error.
+    static bool dumpChromeJson(const std::string& path);
+
+    static constexpr size_t kEventsPerThread = 8192;
+    static constexpr size_t kMaxThreads = 64; // threads beyond this are not traced
+
+private:
+    static std::atomic<bool> enabled_;
+};
+
+// Records a span of the enclosing scope when tracing is enabled.
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name, uint64_t id = 0)
+        : name_(name), id_(id), startNs_(PipelineTrace::enabled() ? PipelineTrace::nowNs() : 0) {}
+    ~TraceSpan() {
+        if (startNs_ != 0) PipelineTrace::complete(name_, startNs_, PipelineTrace::nowNs(), id_);
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* name_;
+    uint64_t id_;
+    uint64_t startNs_;
+};
@@ -0,0 +1,219 @@
+#include "SoakCollector.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+
+namespace {
+
+// Rows of a toJsonFlat array: every frame object starts with its session id.
+unsigned long long countFrames(const std::string& body) {
+    static const char kRow[] = "{\"session_id\"";
+    unsigned long long n = 0;
+    for (size_t pos = body.find(kRow); pos != std::string::npos; pos = body.find(kRow, pos + sizeof(kRow) - 1)) ++n;
+    return n;
+}
+
+bool sendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        const ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += (size_t)n;
+    }
+    return true;
+}
+
+// Content-Length of a request head, -1 if missing.
+long long contentLength(const std::string& head) {
+    size_t lineStart = head.find("\r\n");
+    while (lineStart != std::string::npos && lineStart + 2 < head.size()) {
+        const size_t begin = lineStart + 2;
+        const size_t end = head.find("\r\n", begin);
+        const std::string line = head.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+        if (strncasecmp(line.c_str(), "Content-Length:", 15) == 0) return std::atoll(line.c_str() + 15);
+        lineStart = end;
+    }
+    return -1;
+}
+
+} // namespace
+
+SoakCollector::~SoakCollector() {
+    stop();
+}
+
+bool SoakCollector::start(const Faults& faults, uint64_t seed) {
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        faults_ = faults;
+        rng_.seed(seed);
+    }
+    listenFd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd_ < 0) {
+        std::fprintf(stderr, "SoakCollector: socket failed: %s\n", strerror(errno));
+        return false;
+    }
+    const int one = 1;
+    ::setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t len = sizeof(addr);
+    if (::bind(listenFd_, (sockaddr*)&addr, sizeof(addr)) != 0 || ::listen(listenFd_, 16) != 0 ||
+        ::getsockname(listenFd_, (sockaddr*)&addr, &len) != 0) {
+        std::fprintf(stderr, "SoakCollector: cannot listen on 127.0.0.1: %s\n", strerror(errno));
+        ::close(listenFd_);
+        listenFd_ = -1;
+        return false;
+    }
+    port_ = ntohs(addr.sin_port);
+    startTime_ = std::chrono::steady_clock::now();
+    stop_ = false;
+    acceptThread_ = std::thread(&SoakCollector::acceptLoop, this);
+    return true;
+}
+
+void SoakCollector::stop() {
+    if (listenFd_ < 0) return;
+    stop_ = true;
+    if (acceptThread_.joinable()) acceptThread_.join();
+    ::close(listenFd_);
+    listenFd_ = -1;
+    // Wake the connection threads blocked in recv, then wait for them to close their sockets
+    std::unique_lock<std::mutex> lk(mtx_);
+    for (int fd : connFds_) ::shutdown(fd, SHUT_RDWR);
+    connCv_.wait(lk, [&] { return connFds_.empty(); });
+}
+
+void SoakCollector::setFaults(const Faults& faults) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    faults_ = faults;
+}
+
+SoakCollector::Counters SoakCollector::counters() const {
+    Counters c;
+    c.requests = requests_.load(std::memory_order_relaxed);
+    c.accepted = accepted_.load(std::memory_order_relaxed);
+    c.errors = errors_.load(std::memory_order_relaxed);
+    c.stalls = stalls_.load(std::memory_order_relaxed);
+    c.dropped = dropped_.load(std::memory_order_relaxed);
+    c.frames = frames_.load(std::memory_order_relaxed);
+    c.bytes = bytes_.load(std::memory_order_relaxed);
+    return c;
+}
+
+void SoakCollector::acceptLoop() {
+    while (!stop_) {
+        pollfd p = {listenFd_, POLLIN, 0};
+        if (::poll(&p, 1, 200) <= 0) continue;
+        const int fd = ::accept4(listenFd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) continue;
+        std::lock_guard<std::mutex> lk(mtx_);
+        connFds_.push_back(fd);
+        std::thread(&SoakCollector::connectionLoop, this, fd).detach();
+    }
+}
+
+SoakCollector::Action SoakCollector::nextAction(int& delayMs) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    const Faults& f = faults_;
+    if (f.outageEverySec > 0 && f.outageForSec > 0) {
+        const long long sec =
+                std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - startTime_).count();
+        // The first outage starts after one full period
+        if (sec >= f.outageEverySec && sec % f.outageEverySec < f.outageForSec) return Action::Drop;
+    }
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    delayMs = f.latencyMs;
+    if (f.jitterMs > 0) delayMs += std::uniform_int_distribution<int>(-f.jitterMs, f.jitterMs)(rng_);
+    delayMs = std::max(delayMs, 0);
+    if (f.errorRate > 0.0 && unit(rng_) < f.errorRate) return Action::Error;
+    if (f.stallRate > 0.0 && unit(rng_) < f.stallRate) {
+        delayMs += f.stallMs;
+        return Action::Stall;
+    }
+    return Action::Answer;
+}
+
+void SoakCollector::sleepMs(int ms) const {
+    const auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+    while (!stop_ && std::chrono::steady_clock::now() < until) {
+        std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+                until - std::chrono::steady_clock::now(), std::chrono::milliseconds(50)));
+    }
+}
+
+void SoakCollector::connectionLoop(int fd) {
+    std::string rx;
+    std::vector<char> buf(64 * 1024);
+    auto receive = [&]() {
+        const ssize_t n = ::recv(fd, buf.data(), buf.size(), 0);
+        if (n > 0) rx.append(buf.data(), (size_t)n);
+        return n > 0;
+    };
+    while (!stop_) {
+        size_t headEnd;
+        while ((headEnd = rx.find("\r\n\r\n")) == std::string::npos) {
+            if (!receive()) goto done;
+        }
+        {
+            const long long length = contentLength(rx.substr(0, headEnd + 2));
+            if (length < 0) break; // chunked or no body: not something SocketHttpTransport sends
+            const size_t total = headEnd + 4 + (size_t)length;
+            while (rx.size() < total) {
+                if (!receive()) goto done;
+            }
+            const std::string body = rx.substr(headEnd + 4, (size_t)length);
+            rx.erase(0, total);
+            requests_.fetch_add(1, std::memory_order_relaxed);
+
+            int delayMs = 0;
+            const Action action = nextAction(delayMs);
+            if (action == Action::Drop) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                break;
+            }
+            if (action == Action::Stall) stalls_.fetch_add(1, std::memory_order_relaxed);
+            sleepMs(delayMs);
+            if (stop_) break;
+
+            if (action == Action::Error) {
+                int retryAfter;
+                {
+                    std::lock_guard<std::mutex> lk(mtx_);
+                    retryAfter = faults_.retryAfterSec;
+                }
+                const std::string answer = "HTTP/1.1 503 Service Unavailable\r\nRetry-After: " +
+                                           std::to_string(retryAfter) + "\r\nContent-Length: 0\r\n\r\n";
+                errors_.fetch_add(1, std::memory_order_relaxed);
+                if (!sendAll(fd, answer)) break;
+                continue;
+            }
+            if (!sendAll(fd, "HTTP/1.1 201 Created\r\nContent-Length: 0\r\n\r\n")) {
+                // The client gave up (timeout): it will send the data again, do not count it
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                break;
+            }
+            accepted_.fetch_add(1, std::memory_order_relaxed);
+            frames_.fetch_add(countFrames(body), std::memory_order_relaxed);
+            bytes_.fetch_add(body.size(), std::memory_order_relaxed);
+        }
+    }
+done:
+    std::lock_guard<std::mutex> lk(mtx_);
+    ::close(fd);
+    connFds_.erase(std::find(connFds_.begin(), connFds_.end(), fd));
+    connCv_.notify_all();
+}
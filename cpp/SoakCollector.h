@@ -0,0 +1,89 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Local stand-in for the upload backend, used by telemetria_soak and RecordFrameAllocTest. A minimal HTTP/1.1
+// keep-alive server on 127.0.0.1 (ephemeral port) that takes the POSTs of SocketHttpTransport and answers 201,
+// with injected faults:
+//   - latency: every answer is delayed latencyMs +- jitterMs
+//   - errors:  a fraction of the requests gets 503 with Retry-After
+//   - stalls:  a fraction of the requests is held stallMs before the answer (over 30 s the client times out)
+//   - outages: every outageEverySec seconds, for outageForSec seconds, requests are read and the connection is
+//              closed without an answer (a collector or network that went away)
+// It counts the frames it accepted (rows of the JSON array) so the harness can check nothing was lost.
+class SoakCollector {
+public:
+    struct Faults {
+        int latencyMs = 0;
+        int jitterMs = 0;
+        double errorRate = 0.0;  // 0..1
+        int retryAfterSec = 1;
+        double stallRate = 0.0;  // 0..1
+        int stallMs = 0;
+        int outageEverySec = 0;  // 0 = no outages
+        int outageForSec = 0;
+    };
+
+    // Counters since start(). Frames and bytes only count requests that were answered with 201.
+    struct Counters {
+        unsigned long long requests;
+        unsigned long long accepted;
+        unsigned long long errors;   // 503 answers
+        unsigned long long stalls;
+        unsigned long long dropped;  // closed without an answer (outage) or answer not delivered
+        unsigned long long frames;
+        unsigned long long bytes;
+    };
+
+    SoakCollector() = default;
+    ~SoakCollector();
+
+    // Listens on 127.0.0.1 and starts the accept thread. Returns false if the socket cannot be set up.
+    bool start(const Faults& faults, uint64_t seed);
+    // Closes every connection and joins the threads.
+    void stop();
+
+    // Changes the faults for the following requests (the outage schedule keeps its start time).
+    void setFaults(const Faults& faults);
+
+    int port() const { return port_; }
+    Counters counters() const;
+
+private:
+    int listenFd_ = -1;
+    int port_ = 0;
+    std::atomic<bool> stop_{false};
+    std::thread acceptThread_;
+    std::chrono::steady_clock::time_point startTime_;
+
+    // Faults, the random generator and the open connections, guarded by mtx_. Connection threads are detached,
+    // stop() waits on connCv_ until the last one is gone.
+    mutable std::mutex mtx_;
+    Faults faults_;
+    std::mt19937_64 rng_;
+    std::vector<int> connFds_;
+    std::condition_variable connCv_;
+
+    std::atomic<unsigned long long> requests_{0};
+    std::atomic<unsigned long long> accepted_{0};
+    std::atomic<unsigned long long> errors_{0};
+    std::atomic<unsigned long long> stalls_{0};
+    std::atomic<unsigned long long> dropped_{0};
+    std::atomic<unsigned long long> frames_{0};
+    std::atomic<unsigned long long> bytes_{0};
+
+    void acceptLoop();
+    void connectionLoop(int fd);
+    // What to do with the next request, drawn from the faults.
+    enum class Action { Answer, Error, Stall, Drop };
+    Action nextAction(int& delayMs);
+    // Sleeps ms milliseconds unless stop() is called meanwhile.
+    void sleepMs(int ms) const;
+};
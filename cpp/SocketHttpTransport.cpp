@@ -0,0 +1,430 @@
+#include "SocketHttpTransport.h"
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <strings.h>
+
+#include "TelemetriaLog.h"
+
+// Same limits as AyudanteHttp (HttpURLConnection connect / read timeouts).
+static constexpr int kConnectTimeoutMs = 15000;
+static constexpr int kIoTimeoutSec = 30;
+// Guard against a broken server sending endless headers.
+static constexpr size_t kMaxHeaderBytes = 64 * 1024;
+static constexpr size_t kRecvChunk = 16 * 1024;
+
+static void trim(std::string& s) {
+    size_t b = 0, e = s.size();
+    while (b < e && (s[b] == ' ' || s[b] == '\t')) ++b;
+    while (e > b && (s[e - 1] == ' ' || s[e - 1] == '\t' || s[e - 1] == '\r')) --e;
+    s = s.substr(b, e - b);
+}
+
+SocketHttpTransport::~SocketHttpTransport() {
+    shutdown();
+}
+
+bool SocketHttpTransport::parseHttpUrl(const std::string& url, std::string& host, std::string& port,
+                                       std::string& path) {
+    static const char kScheme[] = "http://";
+    if (url.compare(0, sizeof(kScheme) - 1, kScheme) != 0) return false;
+    const size_t start = sizeof(kScheme) - 1;
+    size_t slash = url.find('/', start);
+    std::string authority = url.substr(start, slash == std::string::npos ? std::string::npos : slash - start);
+    path = slash == std::string::npos ? "/" : url.substr(slash);
+    port = "80";
+    if (!authority.empty() && authority[0] == '[') {
+        // IPv6 literal: [::1]:8080
+        size_t close = authority.find(']');
+        if (close == std::string::npos) return false;
+        host = authority.substr(1, close - 1);
+        if (close + 1 < authority.size() && authority[close + 1] == ':') port = authority.substr(close + 2);
+    } else {
+        size_t colon = authority.rfind(':');
+        host = authority.substr(0, colon);
+        if (colon != std::string::npos) port = authority.substr(colon + 1);
+    }
+    return !host.empty() && !port.empty();
+}
+
+bool SocketHttpTransport::initialize(const UploaderConfig& cfg) {
+    shutdown();
+    debug_ = cfg.debugHttp;
+    unixPath_ = cfg.unixSocketPath;
+
+    std::string host, port, path;
+    if (parseHttpUrl(cfg.endpointUrl, host, port, path)) {
+        host_ = host;
+        port_ = port;
+        path_ = path;
+        hostHeader_ = host.find(':') != std::string::npos ? "[" + host + "]" : host; // IPv6 back in brackets
+        if (port != "80") hostHeader_ += ":" + port;
+    } else if (!unixPath_.empty() && !cfg.endpointUrl.empty() && cfg.endpointUrl[0] == '/') {
+        // unix socket with just a path as endpoint
+        host_.clear();
+        path_ = cfg.endpointUrl;
+        hostHeader_ = "localhost";
+    } else if (!unixPath_.empty() && cfg.endpointUrl.empty()) {
+        host_.clear();
+        path_ = "/";
+        hostHeader_ = "localhost";
+    } else {
+        LOGE("SocketHttpTransport: unsupported endpoint '%s' (only http:// or a unix socket)",
+             cfg.endpointUrl.c_str());
+        return false;
+    }
+    if (!unixPath_.empty() && unixPath_.size() >= sizeof(sockaddr_un::sun_path)) {
+        LOGE("SocketHttpTransport: unix socket path too long");
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(qMtx_);
+        stop_ = false;
+    }
+    worker_ = std::thread(&SocketHttpTransport::workerLoop, this);
+    LOGI("SocketHttpTransport ready: %s%s path=%s", unixPath_.empty() ? "tcp " : "unix ",
+         unixPath_.empty() ? (host_ + ":" + port_).c_str() : unixPath_.c_str(), path_.c_str());
+    return true;
+}
+
+void SocketHttpTransport::shutdown() {
+    {
+        std::lock_guard<std::mutex> lk(qMtx_);
+        stop_ = true;
+        if (!jobs_.empty()) {
+            LOGI("SocketHttpTransport: dropping %zu queued request(s)", jobs_.size());
+        }
+        jobs_.clear();
+    }
+    qcv_.notify_all();
+    if (worker_.joinable()) worker_.join();
+    std::lock_guard<std::mutex> lk(connMtx_);
+    closeLocked();
+}
+
+bool SocketHttpTransport::post(const std::string& body, const HttpHeaders& headers, UploadResult& result) {
+    std::lock_guard<std::mutex> lk(connMtx_);
+    return postLocked(body, headers, result);
+}
+
+bool SocketHttpTransport::postAsync(const std::string& body, const HttpHeaders& headers, Callback done) {
+    {
+        std::lock_guard<std::mutex> lk(qMtx_);
+        if (stop_ || !worker_.joinable()) return false;
+        jobs_.push_back(Job{body, headers, std::move(done)});
+    }
+    qcv_.notify_one();
+    return true;
+}
+
+void SocketHttpTransport::workerLoop() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lk(qMtx_);
+            qcv_.wait(lk, [&]{ return stop_ || !jobs_.empty(); });
+            if (stop_) return;
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+        UploadResult result;
+        {
+            std::lock_guard<std::mutex> lk(connMtx_);
+            postLocked(job.body, job.headers, result);
+        }
+        if (job.done) job.done(result);
+    }
+}
+
+bool SocketHttpTransport::postLocked(const std::string& body, const HttpHeaders& headers, UploadResult& result) {
+    // Request head; the body is sent as a second iovec so it is never copied.
+    std::string head;
+    head.reserve(256);
+    head += "POST ";
+    head += path_;
+    head += " HTTP/1.1\r\nHost: ";
+    head += hostHeader_;
+    head += "\r\n";
+    for (const auto& kv : headers) {
+        head += kv.first;
+        head += ": ";
+        head += kv.second;
+        head += "\r\n";
+    }
+    head += "Content-Length: ";
+    head += std::to_string(body.size());
+    head += "\r\nConnection: keep-alive\r\n\r\n";
+
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        const bool reused = fd_ >= 0 && requestsOnConn_ > 0;
+        result = UploadResult();
+        bool sentNothingBack = false;
+        if (exchangeLocked(head, body, result, sentNothingBack)) return true;
+        closeLocked();
+        // Only an idle keep-alive connection closed by the server is worth a second try.
+        if (!reused || !sentNothingBack) break;
+        if (debug_) LOGI("SocketHttpTransport: keep-alive connection was closed, reconnecting");
+    }
+    return false;
+}
+
+bool SocketHttpTransport::exchangeLocked(const std::string& head, const std::string& body, UploadResult& result,
+                                         bool& sentNothingBack) {
+    sentNothingBack = true;
+    if (fd_ >= 0) {
+        // Server may have closed the idle connection (or sent garbage): check before writing on it.
+        pollfd p{fd_, POLLIN, 0};
+        if (::poll(&p, 1, 0) > 0) closeLocked();
+    }
+    if (fd_ < 0 && !connectLocked()) {
+        sentNothingBack = false; // fresh connection failed, retrying will not help
+        return false;
+    }
+    if (!sendAll(head, body)) return false;
+    result.bytesSent = (long long)body.size();
+
+    // Status line, skipping interim 1xx responses (100 Continue...).
+    std::string line;
+    int status = -1;
+    bool keepAlive = true;
+    long long contentLength = -1;
+    bool chunked = false;
+    for (;;) {
+        if (!readLine(line)) return false;
+        sentNothingBack = false;
+        int major = 0, minor = 0;
+        if (std::sscanf(line.c_str(), "HTTP/%d.%d %d", &major, &minor, &status) != 3) {
+            LOGE("SocketHttpTransport: bad status line");
+            return false;
+        }
+        keepAlive = (major > 1 || (major == 1 && minor >= 1));
+        contentLength = -1;
+        chunked = false;
+        result.retryAfterSec = 0;
+        size_t headerBytes = 0;
+        for (;;) {
+            if (!readLine(line)) return false;
+            if (line.empty()) break;
+            headerBytes += line.size();
+            if (headerBytes > kMaxHeaderBytes) {
+                LOGE("SocketHttpTransport: response headers too large");
+                return false;
+            }
+            size_t colon = line.find(':');
+            if (colon == std::string::npos) continue;
+            std::string name = line.substr(0, colon);
+            std::string value = line.substr(colon + 1);
+            trim(value);
+            if (strcasecmp(name.c_str(), "Content-Length") == 0) {
+                contentLength = std::strtoll(value.c_str(), nullptr, 10);
+            } else if (strcasecmp(name.c_str(), "Transfer-Encoding") == 0) {
+                chunked = strcasestr(value.c_str(), "chunked") != nullptr;
+            } else if (strcasecmp(name.c_str(), "Connection") == 0) {
+                if (strcasestr(value.c_str(), "close")) keepAlive = false;
+                else if (strcasestr(value.c_str(), "keep-alive")) keepAlive = true;
+            } else if (strcasecmp(name.c_str(), "Retry-After") == 0) {
+                // HTTP-date form is treated as missing, same as AyudanteHttp
+                long v = std::strtol(value.c_str(), nullptr, 10);
+                result.retryAfterSec = v > 0 ? (int)v : 0;
+            }
+        }
+        if (status >= 100 && status < 200) continue;
+        break;
+    }
+
+    // Body: counted and discarded (only previewed with debugHttp). 204/304 never have one.
+    long long received = 0;
+    if (status != 204 && status != 304) {
+        if (chunked) {
+            if (!readBody(-1, true, received)) return false;
+        } else if (contentLength >= 0) {
+            if (!readBody(contentLength, false, received)) return false;
+        } else {
+            // No length: body ends when the server closes the connection.
+            keepAlive = false;
+            if (!readBody(-1, false, received)) return false;
+        }
+    }
+    result.httpStatus = status;
+    result.bytesReceived = received;
+    ++requestsOnConn_;
+    if (!keepAlive) closeLocked();
+    return true;
+}
+
+bool SocketHttpTransport::connectLocked() {
+    closeLocked();
+    int fd = -1;
+    if (!unixPath_.empty()) {
+        fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return false;
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, unixPath_.c_str(), sizeof(addr.sun_path) - 1);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            LOGE("SocketHttpTransport: connect(%s) failed: %s", unixPath_.c_str(), strerror(errno));
+            ::close(fd);
+            return false;
+        }
+    } else {
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* res = nullptr;
+        int rc = ::getaddrinfo(host_.c_str(), port_.c_str(), &hints, &res);
+        if (rc != 0) {
+            LOGE("SocketHttpTransport: getaddrinfo(%s) failed: %s", host_.c_str(), gai_strerror(rc));
+            return false;
+        }
+        for (addrinfo* ai = res; ai; ai = ai->ai_next) {
+            fd = ::socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC | SOCK_NONBLOCK, ai->ai_protocol);
+            if (fd < 0) continue;
+            // Non-blocking connect so the 15 s limit also applies to unreachable hosts.
+            bool ok = ::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0;
+            if (!ok && errno == EINPROGRESS) {
+                pollfd p{fd, POLLOUT, 0};
+                int err = 0;
+                socklen_t len = sizeof(err);
+                ok = ::poll(&p, 1, kConnectTimeoutMs) == 1 &&
+                     ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0;
+                if (!ok && err) errno = err;
+            }
+            if (ok) {
+                ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+                int one = 1;
+                ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                break;
+            }
+            ::close(fd);
+            fd = -1;
+        }
+        ::freeaddrinfo(res);
+        if (fd < 0) {
+            LOGE("SocketHttpTransport: connect(%s:%s) failed: %s", host_.c_str(), port_.c_str(), strerror(errno));
+            return false;
+        }
+    }
+    timeval tv{};
+    tv.tv_sec = kIoTimeoutSec;
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    fd_ = fd;
+    rx_.clear();
+    requestsOnConn_ = 0;
+    return true;
+}
+
+void SocketHttpTransport::closeLocked() {
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+    rx_.clear();
+    requestsOnConn_ = 0;
+}
+
+bool SocketHttpTransport::sendAll(const std::string& head, const std::string& body) {
+    iovec iov[2];
+    iov[0].iov_base = const_cast<char*>(head.data());
+    iov[0].iov_len = head.size();
+    iov[1].iov_base = const_cast<char*>(body.data());
+    iov[1].iov_len = body.size();
+    iovec* cur = iov;
+    int count = body.empty() ? 1 : 2;
+    while (count > 0) {
+        msghdr msg{};
+        msg.msg_iov = cur;
+        msg.msg_iovlen = count;
+        // MSG_NOSIGNAL: a closed peer must not kill the app with SIGPIPE
+        ssize_t n = ::sendmsg(fd_, &msg, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (debug_) LOGE("SocketHttpTransport: send failed: %s", strerror(errno));
+            return false;
+        }
+        size_t left = (size_t)n;
+        while (count > 0 && left >= cur->iov_len) {
+            left -= cur->iov_len;
+            ++cur;
+            --count;
+        }
+        if (count > 0) {
+            cur->iov_base = static_cast<char*>(cur->iov_base) + left;
+            cur->iov_len -= left;
+        }
+    }
+    return true;
+}
+
+long SocketHttpTransport::recvMore() {
+    char buf[kRecvChunk];
+    for (;;) {
+        ssize_t n = ::recv(fd_, buf, sizeof(buf), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n > 0) rx_.append(buf, (size_t)n);
+        else if (n < 0 && debug_) LOGE("SocketHttpTransport: recv failed: %s", strerror(errno));
+        return (long)n;
+    }
+}
+
+bool SocketHttpTransport::readLine(std::string& line) {
+    size_t pos;
+    while ((pos = rx_.find("\r\n")) == std::string::npos) {
+        if (rx_.size() > kMaxHeaderBytes) return false;
+        if (recvMore() <= 0) return false;
+    }
+    line.assign(rx_, 0, pos);
+    rx_.erase(0, pos + 2);
+    return true;
+}
+
+bool SocketHttpTransport::readBody(long long contentLength, bool chunked, long long& received) {
+    std::string preview;
+    // Discards n bytes from the stream (-1 = until the server closes it).
+    auto skip = [&](long long n) -> bool {
+        while (n != 0) {
+            if (rx_.empty()) {
+                long r = recvMore();
+                if (r == 0 && n < 0) return true; // close-delimited body ended
+                if (r <= 0) return false;
+            }
+            size_t take = (n < 0 || (unsigned long long)n > rx_.size()) ? rx_.size() : (size_t)n;
+            if (debug_ && preview.size() < 200) preview.append(rx_, 0, std::min(take, 200 - preview.size()));
+            rx_.erase(0, take);
+            received += (long long)take;
+            if (n > 0) n -= (long long)take;
+        }
+        return true;
+    };
+
+    bool ok = true;
+    if (!chunked) {
+        ok = skip(contentLength);
+    } else {
+        std::string line;
+        for (;;) {
+            if (!readLine(line)) { ok = false; break; }
+            long long size = std::strtoll(line.c_str(), nullptr, 16); // "1a;ext=..." -> 0x1a
+            if (size <= 0) {
+                // Trailers until the empty line.
+                while ((ok = readLine(line)) && !line.empty()) {}
+                break;
+            }
+            if (!skip(size) || !readLine(line)) { ok = false; break; }
+        }
+    }
+    if (ok && debug_) {
+        LOGI("SocketHttpTransport response preview: %s", preview.c_str());
+    }
+    return ok;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <string>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include "UploadTransport.h"
+
+// Native HTTP/1.1 client for plain-HTTP collectors (local server reached through `adb reverse`, LAN, or a
+// unix socket). No TLS and no JVM: the request is written straight to a socket that is kept alive between
+// uploads, so it also works on a Linux host against a local stand-in server.
+// Endpoints: "http://host[:port]/path" over TCP, or cfg.unixSocketPath (the URL then only gives path and Host).
+class SocketHttpTransport : public UploadTransport {
+public:
+    SocketHttpTransport() = default;
+    ~SocketHttpTransport() override;
+
+    // Parses the endpoint and starts the thread used by postAsync. The connection is opened on the first request.
+    bool initialize(const UploaderConfig& cfg) override;
+
+    // Stops the async thread (queued requests are dropped without callback) and closes the connection.
+    void shutdown() override;
+
+    bool post(const std::string& body, const HttpHeaders& headers, UploadResult& result) override;
+
+    // Queues the request for the transport thread, which runs `done` when it ends. Requests are sent in order.
+    bool postAsync(const std::string& body, const HttpHeaders& headers, Callback done) override;
+
+    bool supportsAsync() const override { return true; }
+
+    // Splits "http://host[:port]/path". Returns false for other schemes (https is handled by JniHttpTransport).
+    static bool parseHttpUrl(const std::string& url, std::string& host, std::string& port, std::string& path);
+
+private:
+    // Request queued by postAsync.
+    struct Job {
+        std::string body;
+        HttpHeaders headers;
+        Callback done;
+    };
+
+    // Endpoint
+    std::string host_;       // TCP host, or empty with unixPath_
+    std::string port_ = "80";
+    std::string path_ = "/";
+    std::string hostHeader_; // value of the Host header
+    std::string unixPath_;
+    bool debug_ = false;
+
+    // Connection, only used with connMtx_ held (post and the async thread share it).
+    std::mutex connMtx_;
+    int fd_ = -1;
+    std::string rx_;          // bytes received but not parsed yet
+    int requestsOnConn_ = 0;  // requests answered on the current connection
+
+    // Async thread
+    std::mutex qMtx_;
+    std::condition_variable qcv_;
+    std::deque<Job> jobs_;
+    std::thread worker_;
+    bool stop_ = false;
+
+    void workerLoop();
+
+    // Request on the current connection (opened if needed). Retries once on a fresh connection if a
+    // reused keep-alive connection was closed by the server before answering.
+    bool postLocked(const std::string& body, const HttpHeaders& headers, UploadResult& result);
+
+    // A single attempt. sentNothingBack is true when the connection failed before any response byte arrived.
+    bool exchangeLocked(const std::string& head, const std::string& body, UploadResult& result,
+                        bool& sentNothingBack);
+
+    bool connectLocked();
+    void closeLocked();
+
+    // Socket helpers (SO_SNDTIMEO / SO_RCVTIMEO bound each call).
+    bool sendAll(const std::string& head, const std::string& body);
+    long recvMore(); // bytes read, 0 on orderly close, -1 on error/timeout
+    bool readLine(std::string& line);
+    bool readBody(long long contentLength, bool chunked, long long& received);
+};
@@ -0,0 +1,312 @@
+#include "SyntheticMotion.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+constexpr float kPi = 3.14159265358979f;
+constexpr float kStepHz = 1.8f;      // steps per second at walking speed
+constexpr float kWalkSpeed = 1.2f;   // m/s where the step bob and arm swing are full
+// Tracking flags of a valid joint (XrSpaceLocationFlags: orientation/position valid and tracked)
+constexpr int kJointTracked = 0xF;
+
+struct Quat {
+    float x, y, z, w;
+};
+
+Quat mul(const Quat& a, const Quat& b) {
+    return {a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+            a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+            a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+            a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z};
+}
+
+Quat aroundX(float angle) { return {std::sin(angle * 0.5f), 0.0f, 0.0f, std::cos(angle * 0.5f)}; }
+Quat aroundY(float angle) { return {0.0f, std::sin(angle * 0.5f), 0.0f, std::cos(angle * 0.5f)}; }
+Quat aroundZ(float angle) { return {0.0f, 0.0f, std::sin(angle * 0.5f), std::cos(angle * 0.5f)}; }
+
+// Yaw about +Y, then pitch about +X, then roll about -Z (the forward axis)
+Quat fromYawPitchRoll(float yaw, float pitch, float roll) {
+    return mul(mul(aroundY(yaw), aroundX(pitch)), aroundZ(roll));
+}
+
+// v rotated by q
+void rotate(const Quat& q, const float v[3], float out[3]) {
+    // t = 2 * cross(q.xyz, v); out = v + w * t + cross(q.xyz, t)
+    const float tx = 2.0f * (q.y * v[2] - q.z * v[1]);
+    const float ty = 2.0f * (q.z * v[0] - q.x * v[2]);
+    const float tz = 2.0f * (q.x * v[1] - q.y * v[0]);
+    out[0] = v[0] + q.w * tx + (q.y * tz - q.z * ty);
+    out[1] = v[1] + q.w * ty + (q.z * tx - q.x * tz);
+    out[2] = v[2] + q.w * tz + (q.x * ty - q.y * tx);
+}
+
+void setPose(VRPosePlain& p, const float pos[3], const Quat& q) {
+    p.position[0] = pos[0];
+    p.position[1] = pos[1];
+    p.position[2] = pos[2];
+    p.rotation[0] = q.x;
+    p.rotation[1] = q.y;
+    p.rotation[2] = q.z;
+    p.rotation[3] = q.w;
+}
+
+float clampf(float v, float lo, float hi) { return std::min(std::max(v, lo), hi); }
+
+// Finger geometry of a hand with its palm facing -Y and the fingers along -Z, in meters.
+// Index, middle, ring, little: first joint (XrHandJointEXT), knuckle x offset (times the thumb side), spread
+// about Y, segment lengths (metacarpal, proximal, intermediate, distal) and bend of each joint when closed.
+struct Finger {
+    int firstJoint;
+    float x;
+    float spread;
+    float length[4];
+};
+constexpr Finger kFingers[4] = {
+        {6, 0.022f, 0.10f, {0.068f, 0.040f, 0.024f, 0.021f}},
+        {11, 0.004f, 0.0f, {0.066f, 0.045f, 0.028f, 0.023f}},
+        {16, -0.013f, -0.08f, {0.062f, 0.042f, 0.026f, 0.022f}},
+        {21, -0.028f, -0.18f, {0.057f, 0.033f, 0.018f, 0.020f}},
+};
+constexpr float kFingerBend[4] = {0.15f, 1.4f, 1.6f, 1.0f};
+constexpr float kThumbLength[3] = {0.035f, 0.032f, 0.028f};
+constexpr float kThumbBend[3] = {0.3f, 0.6f, 0.7f};
+
+} // namespace
+
+uint64_t SyntheticMotion::Rng::next() {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+double SyntheticMotion::Rng::uniform() {
+    return (double)(next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+double SyntheticMotion::Rng::uniform(double lo, double hi) {
+    return lo + (hi - lo) * uniform();
+}
+
+double SyntheticMotion::Rng::gaussian() {
+    // Box-Muller, one value per call
+    const double u1 = 1.0 - uniform();
+    const double u2 = uniform();
+    return std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * 3.14159265358979323846 * u2);
+}
+
+float SyntheticMotion::Channel::eval(double t) const {
+    float v = 0.0f;
+    for (const Wave& wave : w) v += wave.amp * (float)std::sin(wave.omega * t + wave.phase);
+    return v;
+}
+
+float SyntheticMotion::Channel::derivative(double t) const {
+    float v = 0.0f;
+    for (const Wave& wave : w) v += wave.amp * wave.omega * (float)std::cos(wave.omega * t + wave.phase);
+    return v;
+}
+
+// amp is the largest value the channel can reach, the periods of its waves are picked in [minPeriod, maxPeriod].
+void SyntheticMotion::makeChannel(Channel& c, float amp, float minPeriod, float maxPeriod) {
+    float weights[kWaves];
+    float sum = 0.0f;
+    for (float& w : weights) {
+        w = (float)rng_.uniform(0.3, 1.0);
+        sum += w;
+    }
+    for (int i = 0; i < kWaves; ++i) {
+        c.w[i].amp = amp * weights[i] / sum;
+        c.w[i].omega = 2.0f * kPi / (float)rng_.uniform(minPeriod, maxPeriod);
+        c.w[i].phase = (float)rng_.uniform(0.0, 2.0 * kPi);
+    }
+}
+
+SyntheticMotion::SyntheticMotion(const Options& options)
+    : options_(options),
+      rateHz_(std::min(std::max(options.rateHz, 1.0), 1000.0)),
+      rng_{options.seed} {
+    // The person: height, where they walk and how they look around
+    height_ = (float)rng_.uniform(1.55, 1.80);
+    makeChannel(walkX_, 1.6f, 20.0f, 90.0f);
+    makeChannel(walkZ_, 1.6f, 20.0f, 90.0f);
+    makeChannel(lookYaw_, 0.9f, 3.0f, 12.0f);
+    makeChannel(lookPitch_, 0.35f, 4.0f, 15.0f);
+    makeChannel(lookRoll_, 0.08f, 5.0f, 20.0f);
+    makeChannel(crouch_, 1.0f, 30.0f, 120.0f);
+    for (int s = 0; s < 2; ++s) {
+        for (Channel& c : reach_[s]) makeChannel(c, 0.12f, 2.0f, 8.0f);
+        makeChannel(ctrlTwist_[s], 0.6f, 2.0f, 9.0f);
+        makeChannel(trigger_[s], 1.0f, 1.5f, 6.0f);
+        makeChannel(grip_[s], 1.0f, 2.0f, 8.0f);
+        makeChannel(stickX_[s], 1.0f, 1.0f, 5.0f);
+        makeChannel(stickY_[s], 1.0f, 1.0f, 5.0f);
+        makeChannel(curl_[s], 1.0f, 1.5f, 6.0f);
+    }
+    std::memset(lastCtrlPose_, 0, sizeof(lastCtrlPose_));
+    std::memset(lastJoints_, 0, sizeof(lastJoints_));
+}
+
+void SyntheticMotion::updateDropout(Dropout& d, double t, double dt) {
+    if (d.lost(t) || options_.dropoutsPerMinute <= 0.0) return;
+    if (rng_.uniform() < options_.dropoutsPerMinute / 60.0 * dt) {
+        d.lostUntil = t + rng_.uniform(0.2, 2.0);
+    }
+}
+
+unsigned SyntheticMotion::updateButtons(int side, double t, double dt) {
+    // Presses per second of primary, secondary and stick click
+    static constexpr double kPressRate[3] = {0.3, 0.1, 0.05};
+    unsigned buttons = 0;
+    for (int b = 0; b < 3; ++b) {
+        Press& p = press_[side][b];
+        if (t >= p.releaseAt && rng_.uniform() < kPressRate[b] * dt) {
+            p.releaseAt = t + rng_.uniform(0.08, 0.5);
+        }
+        if (t < p.releaseAt) buttons |= 1u << b;
+    }
+    return buttons;
+}
+
+// 26 joints in XrHandJointEXT order around the wrist pose, fingers bent by curl (0 open, 1 fist).
+void SyntheticMotion::fillHand(int side, const VRPosePlain& wrist, float curl, JointSamplePlain* joints) const {
+    const Quat q = {wrist.rotation[0], wrist.rotation[1], wrist.rotation[2], wrist.rotation[3]};
+    // The thumb is at -X on the right hand (palm down), at +X on the left one
+    const float thumbSide = side == 1 ? -1.0f : 1.0f;
+    auto put = [&](int j, const float local[3], const Quat& localRot) {
+        JointSamplePlain& s = joints[j];
+        std::memset(&s, 0, sizeof(s));
+        float world[3];
+        rotate(q, local, world);
+        const Quat r = mul(q, localRot);
+        s.idIndex = j;
+        s.state = kJointTracked;
+        s.px = wrist.position[0] + world[0];
+        s.py = wrist.position[1] + world[1];
+        s.pz = wrist.position[2] + world[2];
+        s.qx = r.x;
+        s.qy = r.y;
+        s.qz = r.z;
+        s.qw = r.w;
+        s.hasPose = 1;
+    };
+    // Walks a finger from its base: each segment goes along -Z of the base rotation bent about X by the
+    // joints before it (toward the palm).
+    auto chain = [&](int firstJoint, int segments, const float base[3], const Quat& baseRot, const float* length,
+                     const float* bend) {
+        float pos[3] = {base[0], base[1], base[2]};
+        float angle = 0.0f;
+        for (int k = 0; k <= segments; ++k) {
+            const Quat rot = mul(baseRot, aroundX(-angle));
+            put(firstJoint + k, pos, rot);
+            if (k == segments) break;
+            angle += curl * bend[k];
+            const Quat dirRot = mul(baseRot, aroundX(-angle));
+            const float forward[3] = {0.0f, 0.0f, -length[k]};
+            float step[3];
+            rotate(dirRot, forward, step);
+            pos[0] += step[0];
+            pos[1] += step[1];
+            pos[2] += step[2];
+        }
+    };
+
+    const Quat identity = {0.0f, 0.0f, 0.0f, 1.0f};
+    const float palm[3] = {thumbSide * 0.005f, 0.0f, -0.045f};
+    const float origin[3] = {0.0f, 0.0f, 0.0f};
+    put(0, palm, identity);   // XR_HAND_JOINT_PALM_EXT
+    put(1, origin, identity); // XR_HAND_JOINT_WRIST_EXT
+
+    const float thumbBase[3] = {thumbSide * 0.02f, -0.01f, -0.015f};
+    chain(2, 3, thumbBase, aroundY(thumbSide * 0.7f), kThumbLength, kThumbBend);
+    for (const Finger& f : kFingers) {
+        const float base[3] = {thumbSide * f.x, 0.0f, -0.01f};
+        chain(f.firstJoint, 4, base, aroundY(thumbSide * f.spread), f.length, kFingerBend);
+    }
+}
+
+void SyntheticMotion::next(VRFrameDataPlain& frame) {
+    std::memset(&frame, 0, sizeof(frame));
+    const double dt = 1.0 / rateHz_;
+    // Frame time: nominal period with jitter, never more than half a period off so timestamps keep their order
+    double jitter = rng_.gaussian() * options_.jitterMs * 0.001;
+    jitter = std::min(std::max(jitter, -0.45 * dt), 0.45 * dt);
+    const double t = (double)frameIndex_ * dt + jitter;
+    ++frameIndex_;
+    frame.timestampSec = options_.startTimeSec + t;
+
+    // Head: walking around the room, the body facing where it goes, the head looking around
+    const float vx = walkX_.derivative(t);
+    const float vz = walkZ_.derivative(t);
+    const float speed = std::sqrt(vx * vx + vz * vz);
+    const float walking = std::min(speed / kWalkSpeed, 1.0f);
+    const float heading = std::atan2(-vx, -vz);
+    const float bob = 0.025f * walking * (float)std::sin(2.0 * kPi * kStepHz * t);
+    const float crouch = 0.4f * std::min(0.0f, crouch_.eval(t) + 0.5f);
+    const float head[3] = {walkX_.eval(t), height_ + bob + crouch, walkZ_.eval(t)};
+    setPose(frame.hmdPose, head,
+            fromYawPitchRoll(heading + lookYaw_.eval(t), lookPitch_.eval(t) - 0.1f, lookRoll_.eval(t)));
+
+    const Quat body = aroundY(heading);
+    for (int s = 0; s < 2; ++s) {
+        ControllerStatePlain& ctrl = s == 0 ? frame.leftCtrl : frame.rightCtrl;
+        const float side = s == 0 ? -1.0f : 1.0f;
+        // Arm swing at half the step rate, the two arms in opposite phase
+        const float swing = 0.18f * walking * (float)std::sin(kPi * kStepHz * t + s * kPi);
+        const float local[3] = {side * 0.22f + reach_[s][0].eval(t), -0.5f + reach_[s][1].eval(t),
+                                -0.2f - swing + reach_[s][2].eval(t)};
+        float offset[3];
+        rotate(body, local, offset);
+        const float pos[3] = {head[0] + offset[0], head[1] + offset[1], head[2] + offset[2]};
+        const float twist = ctrlTwist_[s].eval(t);
+        VRPosePlain pose;
+        setPose(pose, pos, fromYawPitchRoll(heading + 0.3f * twist, -0.4f + 1.5f * swing, side * 0.2f + twist));
+
+        updateDropout(ctrlDropout_[s], t, dt);
+        const unsigned buttons = updateButtons(s, t, dt);
+        const float grip = clampf(1.5f * grip_[s].eval(t), 0.0f, 1.0f);
+        if (options_.controllers) {
+            if (!ctrlDropout_[s].lost(t)) {
+                lastCtrlPose_[s] = pose;
+                ctrl.isActive = 1;
+                ctrl.buttons = buttons;
+                ctrl.trigger = clampf(1.5f * trigger_[s].eval(t), 0.0f, 1.0f);
+                ctrl.grip = grip;
+                // Stick with a dead zone
+                const float sx = clampf(1.5f * stickX_[s].eval(t), -1.0f, 1.0f);
+                const float sy = clampf(1.5f * stickY_[s].eval(t), -1.0f, 1.0f);
+                ctrl.stickX = std::fabs(sx) < 0.15f ? 0.0f : sx;
+                ctrl.stickY = std::fabs(sy) < 0.15f ? 0.0f : sy;
+            }
+            // Lost: the runtime keeps reporting the last pose with isActive = 0
+            ctrl.pose = lastCtrlPose_[s];
+        }
+
+        if (options_.hands) {
+            JointSamplePlain* joints = s == 0 ? frame.leftHandJoints : frame.rightHandJoints;
+            (s == 0 ? frame.leftHandJointCount : frame.rightHandJointCount) = 26;
+            updateDropout(handDropout_[s], t, dt);
+            if (handDropout_[s].lost(t)) {
+                std::memcpy(joints, lastJoints_[s], sizeof(lastJoints_[s]));
+                for (int j = 0; j < 26; ++j) {
+                    joints[j].hasPose = 0;
+                    joints[j].state = 0;
+                }
+            } else {
+                // The hand closes around the controller with the grip
+                const float curl = std::max(clampf(0.5f + 0.5f * curl_[s].eval(t), 0.0f, 1.0f), grip);
+                fillHand(s, pose, curl, joints);
+                std::memcpy(lastJoints_[s], joints, sizeof(lastJoints_[s]));
+            }
+        }
+    }
+}
+
+void SyntheticMotion::generate(std::vector<VRFrameDataPlain>& frames, size_t n) {
+    const size_t first = frames.size();
+    frames.resize(first + n);
+    for (size_t i = 0; i < n; ++i) next(frames[first + i]);
+}
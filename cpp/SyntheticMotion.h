@@ -0,0 +1,100 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "TiposVR.h"
+
+// Deterministic synthetic VR input for benchmarks and soak tests (not part of libtelemetria).
+// A person walking around a room and looking around, with both controllers swinging with the steps and reaching
+// now and then, triggers / grips / sticks / buttons in use, and 26-joint OpenXR hands (on the controller grip pose)
+// opening and closing. Frame times jitter around the nominal period and each device loses tracking now and then:
+// a controller reports isActive = 0 and keeps its last pose, a hand keeps its last joints with hasPose = 0.
+//
+// The motion itself is a function of time built from the seed (sums of slow sinusoids), so streams at different
+// rates sample the same movement; jitter, button presses and dropouts come from a seeded generator per frame.
+// Same seed and options give the same frames (up to the last bit of the libm on the platform).
+//
+// Coordinates follow OpenXR (meters, +Y up, -Z forward), as the engines send them.
+class SyntheticMotion {
+public:
+    struct Options {
+        uint64_t seed = 1;
+        double rateHz = 90.0;          // 1 to 1000
+        double startTimeSec = 0.0;     // timestampSec of the first frame
+        double jitterMs = 0.5;         // standard deviation of the frame time jitter (kept under half a period)
+        double dropoutsPerMinute = 1.0; // tracking losses per minute, per controller and per hand
+        bool controllers = true;       // isActive = 0 on both sides when false
+        bool hands = true;             // hand joint count 0 when false
+    };
+
+    SyntheticMotion() : SyntheticMotion(Options()) {}
+    explicit SyntheticMotion(const Options& options);
+
+    // Fills frame with the next sample of the stream.
+    void next(VRFrameDataPlain& frame);
+    // Appends the next n samples to frames.
+    void generate(std::vector<VRFrameDataPlain>& frames, size_t n);
+
+    // Frames generated so far.
+    uint64_t frameIndex() const { return frameIndex_; }
+    double rateHz() const { return rateHz_; }
+
+private:
+    // splitmix64: small, fast and the same on every platform (std:: distributions are not)
+    struct Rng {
+        uint64_t state;
+        uint64_t next();
+        double uniform();                  // [0, 1)
+        double uniform(double lo, double hi);
+        double gaussian();                 // mean 0, standard deviation 1
+    };
+
+    // a * sin(omega * t + phase)
+    struct Wave {
+        float amp;
+        float omega;
+        float phase;
+    };
+    static constexpr int kWaves = 3;
+    struct Channel {
+        Wave w[kWaves];
+        float eval(double t) const;
+        float derivative(double t) const;
+    };
+
+    // Tracking loss of one device: lost until lostUntil, the pose is frozen meanwhile.
+    struct Dropout {
+        double lostUntil = -1.0;
+        bool lost(double t) const { return t < lostUntil; }
+    };
+
+    // Button held until releaseAt.
+    struct Press {
+        double releaseAt = -1.0;
+    };
+
+    Options options_;
+    double rateHz_;
+    Rng rng_;
+    uint64_t frameIndex_ = 0;
+
+    float height_;
+    Channel walkX_, walkZ_, lookYaw_, lookPitch_, lookRoll_, crouch_;
+    Channel reach_[2][3];
+    Channel ctrlTwist_[2];
+    Channel trigger_[2], grip_[2], stickX_[2], stickY_[2];
+    Channel curl_[2];
+    Dropout ctrlDropout_[2];
+    Dropout handDropout_[2];
+    Press press_[2][3]; // primary, secondary, stick click
+
+    // Last tracked state, kept while a device is lost
+    VRPosePlain lastCtrlPose_[2];
+    JointSamplePlain lastJoints_[2][26];
+
+    void makeChannel(Channel& c, float amp, float minPeriod, float maxPeriod);
+    void updateDropout(Dropout& d, double t, double dt);
+    unsigned updateButtons(int side, double t, double dt);
+    void fillHand(int side, const VRPosePlain& wrist, float curl, JointSamplePlain* joints) const;
+};
@@ -1,18 +1,24 @@
 #include "TelemetriaAPI.h"
 #include "GestorTelemetria.h"
 #include "AndroidUploader.h"
-#include <android/log.h>
 #include <mutex>
 #include "configReader.h"
 #include "C3DRecorder.h"
+#include "LatencyHistogram.h"
+#include "PipelineTrace.h"
+#include "TelemetriaProbes.h"
+#include "AllocStats.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 
-#define LOG_TAG "telemetria"
-#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
-#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#include "TelemetriaLog.h"
 
 // Minimal global state to keep eveerything as simple as posssible and smooth performance on the app it will be used
+#ifdef __ANDROID__
 static JavaVM* g_vm = nullptr;
 static jobject g_activity = nullptr;
+#endif
 static std::mutex g_mutex;
 
 // singletons for the internal components managed through the api
@@ -21,7 +27,17 @@ static AndroidUploader g_uploader;
 static C3DRecorder     g_c3d;
 //Cached feautres flags to be exposed
 static unsigned g_featureFlags = 0;
+// Cost of telemetry_record_frame on the caller thread
+static LatencyHistogram g_recordFrameLatency;
+// Session of the last initialize, names the default trace file
+static std::string g_sessionId;
+// telemetry_record_frame calls since initialize (sequence number of the record_frame probes) and the warm-up of
+// the allocation check (TELEMETRIA_ALLOC_STATS builds), long enough for the JSON chunks and C3D blocks to be
+// recycled at least twice.
+static std::atomic<unsigned long long> g_recordFrameSeq{0};
+static unsigned long long g_allocWarmupFrames = 0;
 
+#ifdef __ANDROID__
 // Capture JavaVM when the library is loaded (this allow threads to attach later and obtain JNIEnv)
 jint JNI_OnLoad(JavaVM* vm, void*) {
     // Captura JavaVM en carga de la libreria
@@ -29,9 +45,11 @@ jint JNI_OnLoad(JavaVM* vm, void*) {
     g_vm = vm;
     return JNI_VERSION_1_6;
 }
+#endif
 
 extern "C" {
 
+#ifdef __ANDROID__
 void telemetry_set_java_context(JavaVM* vm, jobject activity) {
     std::lock_guard<std::mutex> lock(g_mutex);
     // if VM provided, override the global one
@@ -59,19 +77,12 @@ void telemetry_set_java_context(JavaVM* vm, jobject activity) {
     }
     LOGI("Java context set");
 }
+#endif
 
 int telemetry_initialize(const TelemetryConfigPlain* cfg) {
     std::lock_guard<std::mutex> lock(g_mutex);
     // if no config provided, fail
     if (!cfg) return -1;
-    // java context must have been set
-    if (!g_vm || !g_activity) {
-        LOGE("Java context not set");
-        return -2;
-    }
-    // Contexto Java para el uploader
-    g_uploader.setJavaContext(g_vm, g_activity);
-
     // Configure uploader with session and device info from the engine
     UploaderConfig ucfg;
     ucfg.sessionId   = cfg->sessionId ? cfg->sessionId : "";
@@ -83,6 +94,10 @@ int telemetry_initialize(const TelemetryConfigPlain* cfg) {
     if (!cfgOk) {
         LOGI("Config file not found or unreadable; using defaults.");
     }
+    int logLevel = kLogInfo;
+    TelemetriaLog::parseLevel(ucfg.logLevel.c_str(), logLevel);
+    TelemetriaLog::setLevel(logLevel);
+    TelemetriaLog::setRateLimit((unsigned)ucfg.logRateLimit);
 
     LOGI("config flags: hand=%d primary=%d secondary=%d grip=%d trigger=%d joystick=%d",
          (int)ucfg.handTracking, (int)ucfg.primaryButton, (int)ucfg.secondaryButton,
@@ -91,11 +106,28 @@ int telemetry_initialize(const TelemetryConfigPlain* cfg) {
     LOGI("config final: endpointUrl='%s', apiKey.len=%d, framesPerFile=%d, sessionId='%s', deviceInfo.len=%d",
          ucfg.endpointUrl.c_str(), (int)ucfg.apiKey.size(), ucfg.framesPerFile, ucfg.sessionId.c_str(), (int)ucfg.deviceInfo.size());
 
-    //Initialize the HTTP uploader (JNI bridge to Java helper)
+#ifdef __ANDROID__
+    // java context must have been set, unless the native socket transport is used
+    if (AndroidUploader::usesJniTransport(ucfg) && (!g_vm || !g_activity)) {
+        LOGE("Java context not set");
+        return -2;
+    }
+    // Contexto Java para el uploader
+    g_uploader.setJavaContext(g_vm, g_activity);
+#endif
+
+    //Initialize the HTTP uploader (JNI bridge to Java helper or native socket, see UploaderConfig::transport)
     if (!g_uploader.initialize(ucfg)) {
         LOGE("Uploader initialize failed");
         return -3;
     }
+    g_recordFrameLatency.reset();
+    AllocStats::reset();
+    g_recordFrameSeq.store(0, std::memory_order_relaxed);
+    g_allocWarmupFrames = 3ull * ((unsigned long long)std::max(ucfg.framesPerFile, 0) + C3DRecorder::kBlockFrames);
+    g_sessionId = ucfg.sessionId;
+    // Only turns it on: telemetry_trace_enable before initialize is not undone by a config without the key
+    if (ucfg.trace) PipelineTrace::setEnabled(true);
     // Initialize the telemetry manager (buffering + background uploads).
     if (!g_gestor.initialize(ucfg, &g_uploader)) {
         LOGE("Gestor initialize failed");
@@ -125,10 +157,21 @@ unsigned telemetry_get_feature_flags() {
 
 void telemetry_record_frame(const VRFrameDataPlain* frame) {
     if (!frame) return;
-    // Append the frame to the C3D buffer.
-    g_c3d.C3DrecordFrame(*frame);
-    // Append the frame to the JSON buffer.
-    g_gestor.recordFrame(*frame);
+    const unsigned long long seq = g_recordFrameSeq.fetch_add(1, std::memory_order_relaxed);
+    const long long tsUs = (long long)(frame->timestampSec * 1e6);
+    TELEMETRIA_PROBE4(record_frame_entry, seq, tsUs, frame->leftHandJointCount, frame->rightHandJointCount);
+    {
+        AllocScope allocTag(kAllocRecordFrame);
+        NoAllocCheck noAlloc("telemetry_record_frame", AllocStats::kEnabled && seq >= g_allocWarmupFrames);
+        TraceSpan span("record_frame");
+        const auto t0 = std::chrono::steady_clock::now();
+        // Append the frame to the C3D buffer.
+        g_c3d.C3DrecordFrame(*frame);
+        // Append the frame to the JSON buffer.
+        g_gestor.recordFrame(*frame);
+        g_recordFrameLatency.recordSince(t0);
+    }
+    TELEMETRIA_PROBE4(record_frame_exit, seq, tsUs, frame->leftHandJointCount, frame->rightHandJointCount);
 }
 
 void telemetry_force_upload() {
@@ -138,12 +181,14 @@ void telemetry_force_upload() {
 
 void telemetry_shutdown() {
     std::lock_guard<std::mutex> lock(g_mutex);
-    // Finalize C3D file
-    g_c3d.C3Dfinalize();
+    // Hand the last C3D frames to the background writer; files are closed after we return
+    // (telemetry_c3d_status / telemetry_c3d_wait to follow it).
+    g_c3d.C3DfinalizeAsync();
     // Flush JSON chunks and stop worker thread.
     g_gestor.shutdown();
     // Placeholder for any future uploader teardown.
     g_uploader.shutdown();
+#ifdef __ANDROID__
     // Release the global Activity reference (if any).
     if (g_activity) {
         JNIEnv* env = nullptr;
@@ -152,7 +197,60 @@ void telemetry_shutdown() {
         }
         g_activity = nullptr;
     }
+#endif
     LOGI("telemetry shutdown complete");
+    TelemetriaLog::flush();
+}
+
+int telemetry_c3d_status() {
+    return g_c3d.C3Dstatus();
+}
+
+int telemetry_c3d_wait(int timeoutMs) {
+    return g_c3d.C3DwaitFinalized(timeoutMs);
+}
+
+void telemetry_set_c3d_callback(TelemetryC3DCallback cb, void* userData) {
+    g_c3d.C3DsetCompletionCallback(cb, userData);
+}
+
+void telemetry_get_stats(TelemetryStatsPlain* out) {
+    if (!out) return;
+    // No g_mutex: the counters are atomics, polling must not wait for initialize/shutdown.
+    *out = TelemetryStatsPlain();
+    g_gestor.getStats(*out);
+    g_c3d.C3DgetStats(*out);
+}
+
+void telemetry_get_latency(TelemetryLatencyStatsPlain* out) {
+    if (!out) return;
+    *out = TelemetryLatencyStatsPlain();
+    g_recordFrameLatency.summarize(out->recordFrame);
+    g_gestor.getLatency(*out);
+    g_c3d.C3DgetLatency(*out);
+}
+
+void telemetry_get_alloc_stats(TelemetryAllocStatsPlain* out) {
+    if (!out) return;
+    *out = TelemetryAllocStatsPlain();
+    AllocStats::snapshot(*out);
+}
+
+void telemetry_trace_enable(int on) {
+    PipelineTrace::setEnabled(on != 0);
+}
+
+int telemetry_trace_dump(const char* path) {
+    std::string file;
+    if (path && path[0]) {
+        file = path;
+    } else {
+        std::string dir;
+        if (!configReader::getFilesDir(dir)) return -1;
+        std::lock_guard<std::mutex> lock(g_mutex);
+        file = dir + "/trace_" + (g_sessionId.empty() ? std::string("nosession") : g_sessionId) + ".json";
+    }
+    return PipelineTrace::dumpChromeJson(file) ? 0 : -2;
 }
 
 } // extern "C"
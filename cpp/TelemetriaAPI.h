@@ -1,5 +1,7 @@
 #pragma once
+#ifdef __ANDROID__
 #include <jni.h>
+#endif
 #include "TiposVR.h"
 #include "TiposTelemetria.h"
 
@@ -12,15 +14,19 @@
 extern "C" {
 #endif
 
+#ifdef __ANDROID__
 // This must be called before telemetry_initialize so that the uploader
-// can dynamically load the classes from the AAR.
+// can dynamically load the classes from the AAR. Not needed when the native socket transport is
+// selected in initialConfig.json ("transport", see configReader.h).
+// Android only: Linux builds always use the native socket transport.
 TELEMETRIA_API void telemetry_set_java_context(JavaVM* vm, jobject activity);
+#endif
 
 // Initializes the telemetry manager and HTTP uploader.
 // - cfg: basic configuration coming from Unity/Unreal (sessionId, deviceInfo).
 // Return:
 //   > 0 : frame rate that the caller should use for sampling (1 to 240).
-//   < 0 : negative error code.
+//   < 0 : negative error code (-2: Java context not set and the JNI transport is selected).
 TELEMETRIA_API int  telemetry_initialize(const TelemetryConfigPlain* cfg);
 
 // Records one frame of VR telemetry data.
@@ -35,7 +41,8 @@ TELEMETRIA_API void telemetry_force_upload();
 
 // Shuts down all telemetry components and releases resources.
 // This will:
-//   - finalize the C3D recorder and write the .c3d file if needed;
+//   - hand the last frames to the C3D writer thread, which closes the .c3d files in the background
+//     (it does not wait for it, see telemetry_c3d_status / telemetry_c3d_wait);
 //   - flush and stop the JSON uploader worker;
 //   - release the global Java Activity reference.
 TELEMETRIA_API void telemetry_shutdown();
@@ -51,6 +58,40 @@ TELEMETRIA_API void telemetry_shutdown();
 // The engine can use this to know which fields are actually configured.
 TELEMETRIA_API unsigned telemetry_get_feature_flags();
 
+// C3D output state (TelemetryC3DStatus): after telemetry_shutdown it stays TELEMETRY_C3D_FINALIZING
+// until every part is closed, then TELEMETRY_C3D_DONE (or TELEMETRY_C3D_FAILED on write errors).
+TELEMETRIA_API int telemetry_c3d_status();
+
+// Waits for the C3D finalization started by telemetry_shutdown, at most timeoutMs milliseconds
+// (negative = no limit). Meant for the real process exit. Returns the status at that point.
+TELEMETRIA_API int telemetry_c3d_wait(int timeoutMs);
+
+// Registers a function called once (from the C3D writer thread) when finalization ends. nullptr removes it.
+TELEMETRIA_API void telemetry_set_c3d_callback(TelemetryC3DCallback cb, void* userData);
+
+// Fills *out with the pipeline counters and gauges (see TelemetryStatsPlain). Lock free and cheap: meant to be
+// polled (e.g. once per second) from any thread, also before telemetry_initialize or after shutdown.
+TELEMETRIA_API void telemetry_get_stats(TelemetryStatsPlain* out);
+
+// Fills *out with p50/p90/p99/max per pipeline stage (see TelemetryLatencyStatsPlain), accumulated since
+// telemetry_initialize. Lock free, any thread. recordFrame is the time telemetry_record_frame takes from the
+// caller, the number to budget against the engine frame time.
+TELEMETRIA_API void telemetry_get_latency(TelemetryLatencyStatsPlain* out);
+
+// Fills *out with the heap allocations per pipeline stage and the result of the zero-allocation check of
+// telemetry_record_frame (see AllocStats.h). Only builds with TELEMETRIA_ALLOC_STATS count them; the others
+// return enabled = 0. Lock free, any thread.
+TELEMETRIA_API void telemetry_get_alloc_stats(TelemetryAllocStatsPlain* out);
+
+// Turns pipeline span tracing on (on != 0) or off at runtime; "trace" in initialConfig.json sets it at
+// telemetry_initialize. Events already recorded are kept. Cheap enough to leave on for a short session.
+TELEMETRIA_API void telemetry_trace_enable(int on);
+
+// Writes the recorded spans (the newest ones of each thread) as Chrome trace JSON, to open in
+// ui.perfetto.dev or chrome://tracing. path nullptr = <files dir>/trace_<sessionId>.json.
+// Returns 0 on success, -1 if no path could be built, -2 on write error.
+TELEMETRIA_API int telemetry_trace_dump(const char* path);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,429 @@
+// Component micro-benchmarks of the pipeline, run on the Linux host (or the headset over adb):
+//   record_frame/threads:N     GestorTelemetria::recordFrame from N threads at once (no uploader, no spool)
+//   to_json/<flags>/frames:N   toJsonFlat of one chunk for each feature flag mix and chunk size
+//   c3d_convert/...            C3DConverter::convertBlock of one C3DRecorder block (the SIMD kernels)
+//   c3d_convert_reference/...  c3dConvertFrameReference, the scalar axis swap / quaternion helpers per frame
+//   c3d_write/<format>         conversion plus C3DWriter::appendFrames of one block, as the C3D writer thread does
+// Built with -DTELEMETRIA_BUILD_BENCH=ON:
+//   cmake -S cpp -B build-bench -DTELEMETRIA_BUILD_BENCH=ON && cmake --build build-bench --target telemetria_bench
+// Arguments (all optional): --filter=<substring> --min-time=<seconds> --out=<file.json> --dir=<scratch directory>
+//
+// Results are written as JSON in the Google Benchmark layout (context + benchmarks[], real_time / cpu_time in ns
+// per iteration) so its compare.py works on two runs. Every entry also has ns_per_frame and bytes_per_frame:
+// bytes copied into the chunk buffer, JSON bytes, C3D record bytes or bytes written to the file.
+// cpu_time is process CPU time, it includes the background threads (upload worker, file writes).
+// With TELEMETRIA_ALLOC_STATS the entries measured on the calling thread also get allocs_per_iter.
+
+#include "GestorTelemetria.h"
+#include "C3DConvert.h"
+#include "C3DRecorder.h"
+#include "C3DWriter.h"
+#include "AllocStats.h"
+#include "TelemetriaLog.h"
+#include "SyntheticMotion.h"
+
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr int kFrameRate = 90;
+// Record of C3DRecorder: 59 points and 213 analog channels
+constexpr size_t kPoints = 59;
+constexpr size_t kAnalogs = 213;
+constexpr size_t kStride = kPoints * 4 + kAnalogs;
+constexpr size_t kBlockFrames = C3DRecorder::kBlockFrames;
+// Input: a minute of motion, enough for the largest chunk and to keep the C3D blocks changing
+constexpr int kInputSeconds = 60;
+// Parts are rotated before the 16-bit frame count of the C3D header overflows, like C3DRecorder does
+constexpr uint32_t kMaxPartFrames = 65535;
+
+// Keeps the compiler from dropping work whose result is not used.
+volatile size_t g_sink;
+
+// A person walking around with controllers and tracked hands (seeded, so every run encodes the same data).
+std::vector<VRFrameDataPlain> makeFrames(size_t n) {
+    SyntheticMotion::Options options;
+    options.rateHz = kFrameRate;
+    SyntheticMotion motion(options);
+    std::vector<VRFrameDataPlain> frames;
+    motion.generate(frames, n);
+    return frames;
+}
+
+C3DWriter::Layout makeLayout(bool int16) {
+    C3DWriter::Layout layout;
+    char name[16];
+    for (size_t i = 0; i < kPoints; ++i) {
+        std::snprintf(name, sizeof(name), "P%02zu", i);
+        layout.pointNames.emplace_back(name);
+    }
+    for (size_t i = 0; i < kAnalogs; ++i) {
+        std::snprintf(name, sizeof(name), "A%03zu", i);
+        layout.analogNames.emplace_back(name);
+    }
+    layout.frameRate = (float)kFrameRate;
+    layout.integer.enabled = int16;
+    // Fixed 0.1 mm step (+-3.2 m): the scale picked from the first frames of a part would be too tight for the
+    // rest of the walk around the room. Analogs as C3DRecorder stores them: quaternions at 1/32000 and
+    // RealTime over the span of the input frames.
+    layout.integer.pointScale = 0.1f;
+    layout.integer.analogScales.assign(kAnalogs, 1.0f / 32000.0f);
+    layout.integer.analogOffsets.assign(kAnalogs, 0);
+    layout.integer.analogScales.back() = (float)kInputSeconds / 65534.0f;
+    layout.integer.analogOffsets.back() = -32767;
+    return layout;
+}
+
+double nowSec(clockid_t clock) {
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void appendEscaped(std::string& out, const char* s) {
+    for (; *s; ++s) {
+        const unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+            out.push_back((char)c);
+        } else if (c < 0x20) {
+            char esc[8];
+            std::snprintf(esc, sizeof(esc), "\\u%04x", c);
+            out += esc;
+        } else {
+            out.push_back((char)c);
+        }
+    }
+}
+
+// One finished benchmark: times are per iteration, counters are written next to them.
+struct Result {
+    std::string name;
+    uint64_t iterations = 0;
+    double realNs = 0.0;
+    double cpuNs = 0.0;
+    std::vector<std::pair<std::string, double>> counters;
+};
+
+class Runner {
+public:
+    std::string filter;
+    double minTime = 0.5;
+
+    bool selected(const std::string& name) const {
+        return filter.empty() || name.find(filter) != std::string::npos;
+    }
+
+    // Calls body(iterations) with a growing count until one call lasts minTime, and keeps that call.
+    // body does all the iterations itself so per-call setup (threads, buffers) stays out of the loop.
+    template <typename Body>
+    Result& run(const std::string& name, Body&& body) {
+        Result r;
+        r.name = name;
+        uint64_t iterations = 1;
+        for (;;) {
+            const uint64_t allocs0 = AllocStats::threadAllocations();
+            const double cpu0 = nowSec(CLOCK_PROCESS_CPUTIME_ID);
+            const double real0 = nowSec(CLOCK_MONOTONIC);
+            body(iterations);
+            const double real = nowSec(CLOCK_MONOTONIC) - real0;
+            const double cpu = nowSec(CLOCK_PROCESS_CPUTIME_ID) - cpu0;
+            const uint64_t allocs = AllocStats::threadAllocations() - allocs0;
+            if (real >= minTime || iterations >= 1000000000ull) {
+                r.iterations = iterations;
+                r.realNs = real * 1e9 / (double)iterations;
+                r.cpuNs = cpu * 1e9 / (double)iterations;
+                if (AllocStats::kEnabled) lastAllocs_ = (double)allocs / (double)iterations;
+                break;
+            }
+            // Same growth rule as Google Benchmark: aim 40% past minTime, at most 10x per step
+            double factor = real > 0.0 ? minTime * 1.4 / real : 10.0;
+            factor = std::min(std::max(factor, 1.0), 10.0);
+            iterations = std::max(iterations + 1, (uint64_t)((double)iterations * factor));
+        }
+        results_.push_back(std::move(r));
+        std::fprintf(stderr, "%-40s %12llu  %12.1f ns\n", name.c_str(), (unsigned long long)results_.back().iterations,
+                     results_.back().realNs);
+        return results_.back();
+    }
+
+    // Adds allocs_per_iter to r when allocations are counted (only meaningful if body ran on this thread).
+    void addAllocCounter(Result& r) const {
+        if (AllocStats::kEnabled) r.counters.emplace_back("allocs_per_iter", lastAllocs_);
+    }
+
+    std::string toJson() const {
+        std::string out = "{\n  \"context\": {\n";
+        char buf[512];
+        const time_t now = time(nullptr);
+        tm local;
+        localtime_r(&now, &local);
+        strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S%z", &local);
+        out += "    \"date\": \"" + std::string(buf) + "\",\n";
+        char host[256] = {};
+        gethostname(host, sizeof(host) - 1);
+        out += "    \"host_name\": \"";
+        appendEscaped(out, host);
+        out += "\",\n";
+        utsname uts;
+        if (uname(&uts) == 0) {
+            out += "    \"system\": \"";
+            appendEscaped(out, (std::string(uts.sysname) + " " + uts.release + " " + uts.machine).c_str());
+            out += "\",\n";
+        }
+        std::snprintf(buf, sizeof(buf), "    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+        out += buf;
+#ifdef NDEBUG
+        out += "    \"library_build_type\": \"release\",\n";
+#else
+        out += "    \"library_build_type\": \"debug\",\n";
+#endif
+        out += "    \"c3d_kernels\": \"" + std::string(C3DConverter::kernelName()) + "\",\n";
+        out += std::string("    \"alloc_stats\": ") + (AllocStats::kEnabled ? "true" : "false") + "\n";
+        out += "  },\n  \"benchmarks\": [";
+        for (size_t i = 0; i < results_.size(); ++i) {
+            const Result& r = results_[i];
+            out += i ? ",\n    {\n" : "\n    {\n";
+            out += "      \"name\": \"" + r.name + "\",\n";
+            out += "      \"run_name\": \"" + r.name + "\",\n";
+            out += "      \"run_type\": \"iteration\",\n";
+            std::snprintf(buf, sizeof(buf),
+                          "      \"iterations\": %llu,\n      \"real_time\": %.6g,\n      \"cpu_time\": %.6g,\n"
+                          "      \"time_unit\": \"ns\"",
+                          (unsigned long long)r.iterations, r.realNs, r.cpuNs);
+            out += buf;
+            for (const auto& c : r.counters) {
+                std::snprintf(buf, sizeof(buf), ",\n      \"%s\": %.6g", c.first.c_str(), c.second);
+                out += buf;
+            }
+            out += "\n    }";
+        }
+        out += "\n  ]\n}\n";
+        return out;
+    }
+
+private:
+    std::vector<Result> results_;
+    double lastAllocs_ = 0.0;
+};
+
+// --- Cases ---
+
+void benchRecordFrame(Runner& runner, const std::vector<VRFrameDataPlain>& frames) {
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned threads : {1u, 2u, 4u, 8u}) {
+        if (threads > 1 && threads > cores * 2) break;
+        const std::string name = "record_frame/threads:" + std::to_string(threads);
+        if (!runner.selected(name)) continue;
+
+        // No uploader: the worker takes each sealed chunk and hands its vector back, so what is measured
+        // is the producer side (front buffer lock, chunk sealing, queue lock) with the default chunk size.
+        UploaderConfig cfg;
+        cfg.sessionId = "bench";
+        cfg.deviceInfo = "bench";
+        cfg.spoolEnabled = false;
+        GestorTelemetria gestor;
+        gestor.initialize(cfg, nullptr);
+
+        // One iteration is one frame recorded, split among the threads, all released at once.
+        Result& r = runner.run(name, [&](uint64_t iterations) {
+            std::atomic<bool> go{false};
+            std::vector<std::thread> pool;
+            for (unsigned t = 0; t < threads; ++t) {
+                const uint64_t count = iterations / threads + (t < iterations % threads ? 1 : 0);
+                pool.emplace_back([&, t, count] {
+                    while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+                    size_t k = t * 97;
+                    for (uint64_t i = 0; i < count; ++i) {
+                        gestor.recordFrame(frames[k]);
+                        if (++k == frames.size()) k = 0;
+                    }
+                });
+            }
+            go.store(true, std::memory_order_release);
+            for (auto& th : pool) th.join();
+        });
+        gestor.shutdown();
+        r.counters.emplace_back("ns_per_frame", r.realNs);
+        // Time a single call takes on each producer thread
+        r.counters.emplace_back("ns_per_call", r.realNs * threads);
+        r.counters.emplace_back("bytes_per_frame", (double)sizeof(VRFrameDataPlain));
+    }
+}
+
+void benchToJson(Runner& runner, const std::vector<VRFrameDataPlain>& frames) {
+    struct Mix {
+        const char* name;
+        bool buttons;
+        bool hands;
+    };
+    const Mix mixes[] = {
+            {"pose", false, false},
+            {"buttons", true, false},
+            {"hands", false, true},
+            {"all", true, true},
+    };
+    for (const Mix& mix : mixes) {
+        UploaderConfig cfg;
+        cfg.primaryButton = cfg.secondaryButton = cfg.grip = cfg.trigger = cfg.joystick = mix.buttons;
+        cfg.handTracking = mix.hands;
+        // 1 frame (per-frame overhead), the default framesPerFile and a large chunk
+        for (size_t n : {(size_t)1, (size_t)150, (size_t)1000}) {
+            const std::string name = std::string("to_json/") + mix.name + "/frames:" + std::to_string(n);
+            if (!runner.selected(name)) continue;
+            const std::vector<VRFrameDataPlain> chunk(frames.begin(), frames.begin() + (ptrdiff_t)n);
+            size_t bytes = 0;
+            Result& r = runner.run(name, [&](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; ++i) {
+                    const std::string json = toJsonFlat(chunk, "bench-session-0001", "Quest 3", cfg);
+                    bytes = json.size();
+                    g_sink = bytes;
+                }
+            });
+            r.counters.emplace_back("ns_per_frame", r.realNs / (double)n);
+            r.counters.emplace_back("bytes_per_frame", (double)bytes / (double)n);
+            r.counters.emplace_back("bytes_per_second", (double)bytes * 1e9 / r.realNs);
+            runner.addAllocCounter(r);
+        }
+    }
+}
+
+void benchConvert(Runner& runner, const std::vector<VRFrameDataPlain>& frames) {
+    std::vector<float> records(kBlockFrames * kStride);
+    const std::string blockName = "/frames:" + std::to_string(kBlockFrames);
+
+    const std::string kernelName = "c3d_convert" + blockName;
+    if (runner.selected(kernelName)) {
+        C3DConverter converter;
+        Result& r = runner.run(kernelName, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                converter.convertBlock(frames.data(), kBlockFrames, records.data(), kPoints, kAnalogs);
+                g_sink = (size_t)records[i % records.size()];
+            }
+        });
+        r.counters.emplace_back("ns_per_frame", r.realNs / (double)kBlockFrames);
+        r.counters.emplace_back("bytes_per_frame", (double)(kStride * sizeof(float)));
+        runner.addAllocCounter(r);
+    }
+
+    const std::string referenceName = "c3d_convert_reference" + blockName;
+    if (runner.selected(referenceName)) {
+        Result& r = runner.run(referenceName, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                for (size_t f = 0; f < kBlockFrames; ++f) {
+                    c3dConvertFrameReference(frames[f], records.data() + f * kStride, kPoints, kAnalogs);
+                }
+                g_sink = (size_t)records[i % records.size()];
+            }
+        });
+        r.counters.emplace_back("ns_per_frame", r.realNs / (double)kBlockFrames);
+        r.counters.emplace_back("bytes_per_frame", (double)(kStride * sizeof(float)));
+        runner.addAllocCounter(r);
+    }
+}
+
+void benchWrite(Runner& runner, const std::vector<VRFrameDataPlain>& frames, const std::string& dir) {
+    for (bool int16 : {false, true}) {
+        const std::string name = std::string("c3d_write/") + (int16 ? "int16" : "float");
+        if (!runner.selected(name)) continue;
+        const C3DWriter::Layout layout = makeLayout(int16);
+        const std::string path = dir + "/telemetria_bench.c3d";
+        std::vector<float> records(kBlockFrames * kStride);
+        C3DConverter converter;
+        bool ok = true;
+        double bytesPerFrame = 0.0;
+        // One iteration is one block converted and appended; a new part is started when the current one is full,
+        // and the part is finalized at the end, so closing files is part of the cost as on the headset.
+        Result& r = runner.run(name, [&](uint64_t iterations) {
+            C3DWriter writer;
+            double bytes = 0.0;
+            auto closePart = [&] {
+                ok = writer.finalize() && ok;
+                struct stat st;
+                if (::stat(path.c_str(), &st) == 0) bytes += (double)st.st_size;
+            };
+            for (uint64_t i = 0; i < iterations && ok; ++i) {
+                if (writer.isOpen() && writer.framesWritten() + kBlockFrames > kMaxPartFrames) closePart();
+                if (!writer.isOpen() && !writer.open(path, layout)) {
+                    ok = false;
+                    break;
+                }
+                const size_t first = (size_t)(i * kBlockFrames) % (frames.size() - kBlockFrames);
+                converter.convertBlock(frames.data() + first, kBlockFrames, records.data(), kPoints, kAnalogs);
+                ok = writer.appendFrames(records.data(), kBlockFrames);
+            }
+            if (writer.isOpen()) closePart();
+            bytesPerFrame = bytes / (double)(iterations * kBlockFrames);
+        });
+        unlink(path.c_str());
+        if (!ok) {
+            std::fprintf(stderr, "%s: cannot write %s\n", name.c_str(), path.c_str());
+            continue;
+        }
+        r.counters.emplace_back("ns_per_frame", r.realNs / (double)kBlockFrames);
+        r.counters.emplace_back("bytes_per_frame", bytesPerFrame);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Runner runner;
+    std::string out;
+#ifdef __ANDROID__
+    std::string dir = "/data/local/tmp";
+#else
+    std::string dir = "/tmp";
+#endif
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (std::strncmp(arg, "--filter=", 9) == 0) {
+            runner.filter = arg + 9;
+        } else if (std::strncmp(arg, "--min-time=", 11) == 0) {
+            runner.minTime = std::max(0.001, std::atof(arg + 11));
+        } else if (std::strncmp(arg, "--out=", 6) == 0) {
+            out = arg + 6;
+        } else if (std::strncmp(arg, "--dir=", 6) == 0) {
+            dir = arg + 6;
+        } else {
+            std::fprintf(stderr, "usage: %s [--filter=text] [--min-time=seconds] [--out=file.json] [--dir=path]\n",
+                         argv[0]);
+            return 2;
+        }
+    }
+    // Warnings only: the pipeline logs every chunk at debug and info level
+    TelemetriaLog::setLevel(kLogWarn);
+
+    const std::vector<VRFrameDataPlain> frames = makeFrames((size_t)kFrameRate * kInputSeconds);
+    std::fprintf(stderr, "%-40s %12s  %15s\n", "benchmark", "iterations", "time/iter");
+    benchRecordFrame(runner, frames);
+    benchToJson(runner, frames);
+    benchConvert(runner, frames);
+    benchWrite(runner, frames, dir);
+    TelemetriaLog::flush();
+
+    const std::string json = runner.toJson();
+    if (out.empty()) {
+        std::fputs(json.c_str(), stdout);
+        return 0;
+    }
+    FILE* f = std::fopen(out.c_str(), "w");
+    if (!f || std::fputs(json.c_str(), f) < 0 || std::fclose(f) != 0) {
+        std::fprintf(stderr, "cannot write %s\n", out.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,220 @@
+#include "TelemetriaLog.h"
+#ifdef __ANDROID__
+#include <android/log.h>
+#endif
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <ctime>
+#include <pthread.h>
+
+std::atomic<int> TelemetriaLog::minLevel_{kLogInfo};
+
+namespace {
+    constexpr const char* kTag = "telemetria";
+    constexpr size_t kMask = TelemetriaLog::kRingSlots - 1;
+    static_assert((TelemetriaLog::kRingSlots & kMask) == 0, "kRingSlots must be a power of two");
+
+    // Bounded MPMC ring (sequence number per slot): producers are every logging thread, consumers are the
+    // log thread and flush(). seq == pos: free for the producer of pos; seq == pos + 1: holds message pos.
+    struct Slot {
+        std::atomic<size_t> seq{0};
+        int level = 0;
+        char text[TelemetriaLog::kMaxMessage];
+    };
+    Slot g_ring[TelemetriaLog::kRingSlots];
+    std::atomic<size_t> g_enqueuePos{0};
+    std::atomic<size_t> g_dequeuePos{0};
+    std::atomic<uint32_t> g_dropped{0};
+
+    std::atomic<unsigned> g_rateLimit{20};
+#ifdef __ANDROID__
+    std::atomic<int> g_backend{(int)TelemetriaLog::Backend::Logcat};
+#else
+    std::atomic<int> g_backend{(int)TelemetriaLog::Backend::Stderr};
+#endif
+
+    // The log thread is detached and outlives static destruction, so its wait primitives are never freed.
+    std::once_flag g_startOnce;
+    std::mutex* g_wakeMtx = nullptr;
+    std::condition_variable* g_wakeCv = nullptr;
+    constexpr auto kDrainInterval = std::chrono::milliseconds(50);
+
+    uint64_t coarseMs() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+        return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+    }
+
+    void emit(int level, const char* text) {
+#ifdef __ANDROID__
+        if (g_backend.load(std::memory_order_relaxed) == (int)TelemetriaLog::Backend::Logcat) {
+            __android_log_write(level, kTag, text);
+            return;
+        }
+#endif
+        static const char kLetters[] = "??VDIWEF";
+        const char letter = level >= 0 && level < (int)sizeof(kLetters) - 1 ? kLetters[level] : '?';
+        fprintf(stderr, "%c %s: %s\n", letter, kTag, text);
+    }
+
+    bool enqueue(int level, const char* text, size_t len) {
+        size_t pos = g_enqueuePos.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot = &g_ring[pos & kMask];
+            const size_t seq = slot->seq.load(std::memory_order_acquire);
+            const intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+            if (dif == 0) {
+                if (g_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (dif < 0) {
+                return false; // full
+            } else {
+                pos = g_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        slot->level = level;
+        memcpy(slot->text, text, len + 1);
+        slot->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool dequeue(int& level, char* text) {
+        size_t pos = g_dequeuePos.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot = &g_ring[pos & kMask];
+            const size_t seq = slot->seq.load(std::memory_order_acquire);
+            const intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (dif == 0) {
+                if (g_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (dif < 0) {
+                return false; // empty (or the producer of pos is still copying)
+            } else {
+                pos = g_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+        level = slot->level;
+        memcpy(text, slot->text, TelemetriaLog::kMaxMessage);
+        slot->seq.store(pos + TelemetriaLog::kRingSlots, std::memory_order_release);
+        return true;
+    }
+
+    void drain() {
+        char text[TelemetriaLog::kMaxMessage];
+        int level;
+        while (dequeue(level, text)) emit(level, text);
+        const uint32_t dropped = g_dropped.exchange(0, std::memory_order_relaxed);
+        if (dropped > 0) {
+            char msg[96];
+            snprintf(msg, sizeof(msg), "TelemetriaLog: %u message(s) dropped, log ring full", dropped);
+            emit(kLogWarn, msg);
+        }
+    }
+
+    void logLoop() {
+        pthread_setname_np(pthread_self(), "telemetria log");
+        for (;;) {
+            drain();
+            // Errors wake the thread right away; everything else waits for the next round
+            std::unique_lock<std::mutex> lock(*g_wakeMtx);
+            g_wakeCv->wait_for(lock, kDrainInterval);
+        }
+    }
+
+    void start() {
+        for (size_t i = 0; i < TelemetriaLog::kRingSlots; ++i) g_ring[i].seq.store(i, std::memory_order_relaxed);
+        g_wakeMtx = new std::mutex();
+        g_wakeCv = new std::condition_variable();
+        std::thread(logLoop).detach();
+    }
+
+    // Applies the rate limit of site. Returns false if the message must be skipped; suppressed gets the
+    // number of messages skipped since the last one that went through.
+    bool admit(TelemetriaLog::Site& site, uint32_t& suppressed) {
+        suppressed = 0;
+        const unsigned limit = g_rateLimit.load(std::memory_order_relaxed);
+        if (limit == 0) return true;
+        const uint64_t now = coarseMs();
+        uint64_t windowStart = site.windowStartMs.load(std::memory_order_relaxed);
+        if (now - windowStart >= 1000 &&
+            site.windowStartMs.compare_exchange_strong(windowStart, now, std::memory_order_relaxed)) {
+            site.count.store(0, std::memory_order_relaxed);
+        }
+        if (site.count.fetch_add(1, std::memory_order_relaxed) >= limit) {
+            site.suppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        suppressed = site.suppressed.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+}
+
+void TelemetriaLog::setLevel(int level) {
+    minLevel_.store(level, std::memory_order_relaxed);
+}
+
+void TelemetriaLog::setRateLimit(unsigned perSecond) {
+    g_rateLimit.store(perSecond, std::memory_order_relaxed);
+}
+
+void TelemetriaLog::setBackend(Backend backend) {
+    g_backend.store((int)backend, std::memory_order_relaxed);
+}
+
+bool TelemetriaLog::parseLevel(const char* name, int& level) {
+    if (!name) return false;
+    if (strcmp(name, "debug") == 0) level = kLogDebug;
+    else if (strcmp(name, "info") == 0) level = kLogInfo;
+    else if (strcmp(name, "warn") == 0) level = kLogWarn;
+    else if (strcmp(name, "error") == 0) level = kLogError;
+    else if (strcmp(name, "off") == 0) level = kLogOff;
+    else return false;
+    return true;
+}
+
+void TelemetriaLog::flush() {
+    std::call_once(g_startOnce, start);
+    drain();
+}
+
+void TelemetriaLog::write(int level, Site& site, const char* fmt, ...) {
+    uint32_t suppressed;
+    if (!admit(site, suppressed)) return;
+    std::call_once(g_startOnce, start);
+
+    char text[kMaxMessage];
+    va_list args, again;
+    va_start(args, fmt);
+    va_copy(again, args);
+    const int len = vsnprintf(text, sizeof(text), fmt, args);
+    va_end(args);
+    if (len >= 0 && (size_t)len >= sizeof(text)) {
+        // Too long for a slot: written here, after what is already queued
+        std::string big((size_t)len + 1, '\0');
+        vsnprintf(&big[0], big.size(), fmt, again);
+        big.resize((size_t)len);
+        if (suppressed > 0) big += " (+" + std::to_string(suppressed) + " suppressed)";
+        drain();
+        emit(level, big.c_str());
+    }
+    va_end(again);
+    if (len < 0 || (size_t)len >= sizeof(text)) return;
+
+    size_t size = (size_t)len;
+    if (suppressed > 0) {
+        const int n = snprintf(text + size, sizeof(text) - size, " (+%u suppressed)", suppressed);
+        if (n > 0) size = std::min(size + (size_t)n, sizeof(text) - 1);
+    }
+    if (!enqueue(level, text, size)) {
+        g_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (level >= kLogError) g_wakeCv->notify_one();
+}
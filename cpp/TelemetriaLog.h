@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Logging of the library: LOGD / LOGI / LOGW / LOGE with printf formats, tag "telemetria".
+// The message is formatted on the calling thread into a fixed lock-free ring and a background thread
+// hands it to the backend (logcat, or stderr on host builds), so a slow logd never blocks the engine,
+// upload or C3D threads.
+// - Minimum level set at runtime ("logLevel"); a disabled level costs a relaxed load and a branch.
+// - Every call site logs at most logRateLimit messages per second; the rest are counted and the next
+//   message of that site says how many were suppressed.
+// - When the ring is full the message is dropped and counted, the caller never waits.
+// - Messages longer than kMaxMessage (config dump, Java stack traces) are written synchronously, after
+//   flushing the ring so the order is kept.
+
+// Same values as the android_LogPriority levels.
+enum TelemetriaLogLevel {
+    kLogDebug = 3,
+    kLogInfo  = 4,
+    kLogWarn  = 5,
+    kLogError = 6,
+    kLogOff   = 8,
+};
+
+class TelemetriaLog {
+public:
+    enum class Backend { Logcat, Stderr };
+
+    static bool enabled(int level) { return level >= minLevel_.load(std::memory_order_relaxed); }
+    static void setLevel(int level);
+    // Messages per second and call site, 0 = no limit.
+    static void setRateLimit(unsigned perSecond);
+    // Default: Logcat on Android, Stderr elsewhere.
+    static void setBackend(Backend backend);
+    // "debug", "info", "warn", "error" or "off". Returns false (level untouched) for anything else.
+    static bool parseLevel(const char* name, int& level);
+
+    // Writes everything queued so far from the calling thread (shutdown).
+    static void flush();
+
+    // Rate limit state of one call site (a static inside the LOG macros).
+    struct Site {
+        std::atomic<uint64_t> windowStartMs{0};
+        std::atomic<uint32_t> count{0};
+        std::atomic<uint32_t> suppressed{0};
+    };
+    static void write(int level, Site& site, const char* fmt, ...) __attribute__((format(printf, 3, 4)));
+
+    static constexpr size_t kRingSlots = 256;
+    static constexpr size_t kMaxMessage = 512;
+
+private:
+    static std::atomic<int> minLevel_;
+};
+
+#define TELEMETRIA_LOG(level, ...)                               \
+    do {                                                         \
+        if (TelemetriaLog::enabled(level)) {                     \
+            static TelemetriaLog::Site telemetriaLogSite_;       \
+            TelemetriaLog::write(level, telemetriaLogSite_, __VA_ARGS__); \
+        }                                                        \
+    } while (0)
+
+#define LOGD(...) TELEMETRIA_LOG(kLogDebug, __VA_ARGS__)
+#define LOGI(...) TELEMETRIA_LOG(kLogInfo,  __VA_ARGS__)
+#define LOGW(...) TELEMETRIA_LOG(kLogWarn,  __VA_ARGS__)
+#define LOGE(...) TELEMETRIA_LOG(kLogError, __VA_ARGS__)
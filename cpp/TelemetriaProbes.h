@@ -0,0 +1,43 @@
+#pragma once
+
+// Static USDT probes (provider "telemetria") for diagnosing a running process with bpftrace / perf, e.g.
+//   bpftrace -e 'usdt:./libtelemetria.so:telemetria:record_frame_entry { @s[arg0] = nsecs; }
+//                usdt:./libtelemetria.so:telemetria:record_frame_exit /@s[arg0]/ {
+//                    @ns[arg2 + arg3] = hist(nsecs - @s[arg0]); delete(@s[arg0]); }'
+// (latency of each call, by the number of hand joints in the frame)
+// A probe is a single nop plus a note in the ELF file, its arguments are only read while a tracer is attached.
+// Built in when <sys/sdt.h> (systemtap-sdt) is on the include path and TELEMETRIA_NO_PROBES is not defined
+// (CMake option TELEMETRIA_USDT); otherwise the macros expand to nothing.
+//
+// Probes and arguments:
+//   record_frame_entry(seq, tsUs, leftJoints, rightJoints)
+//                                               telemetry_record_frame: call number since initialize, engine
+//                                               timestamp of the frame in us and its hand joint counts
+//   record_frame_exit(seq, tsUs, leftJoints, rightJoints)
+//   chunk_seal(chunkId, frames, queuedChunks)   chunk handed to the upload queue (queuedChunks before it)
+//   chunk_evict(chunkId, frames, spilled)       oldest queued chunk pushed out (spilled = 1: kept for the spool)
+//   serialize_start(firstChunkId, chunks)       serializeAndSend of one worker batch
+//   serialize_end(firstChunkId, chunks, bytes)  bytes = JSON produced
+//   c3d_block_start(partIndex, frames)          one block appended to the open C3D part(s)
+//   c3d_block_end(partIndex, frames, partFrames)
+
+#if !defined(TELEMETRIA_NO_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define TELEMETRIA_HAS_PROBES 1
+#endif
+#endif
+
+#ifdef TELEMETRIA_HAS_PROBES
+#define TELEMETRIA_PROBE1(name, a)          DTRACE_PROBE1(telemetria, name, a)
+#define TELEMETRIA_PROBE2(name, a, b)       DTRACE_PROBE2(telemetria, name, a, b)
+#define TELEMETRIA_PROBE3(name, a, b, c)    DTRACE_PROBE3(telemetria, name, a, b, c)
+#define TELEMETRIA_PROBE4(name, a, b, c, d) DTRACE_PROBE4(telemetria, name, a, b, c, d)
+#else
+// sizeof keeps the arguments "used" without evaluating them
+#define TELEMETRIA_PROBE1(name, a)          do { (void)sizeof(a); } while (0)
+#define TELEMETRIA_PROBE2(name, a, b)       do { (void)sizeof(a); (void)sizeof(b); } while (0)
+#define TELEMETRIA_PROBE3(name, a, b, c)    do { (void)sizeof(a); (void)sizeof(b); (void)sizeof(c); } while (0)
+#define TELEMETRIA_PROBE4(name, a, b, c, d) \
+    do { (void)sizeof(a); (void)sizeof(b); (void)sizeof(c); (void)sizeof(d); } while (0)
+#endif
@@ -0,0 +1,496 @@
+// End-to-end soak test of libtelemetria on the Linux host (or the headset over adb): the whole public path,
+// telemetry_initialize -> telemetry_record_frame at the engine rate -> telemetry_shutdown, for minutes or hours,
+// uploading to SoakCollector, a local stand-in of the backend that injects latency, 503 errors, stalls and outages.
+// Built with -DTELEMETRIA_BUILD_BENCH=ON:
+//   cmake -S cpp -B build-bench -DTELEMETRIA_BUILD_BENCH=ON && cmake --build build-bench --target telemetria_soak
+//   build-bench/telemetria_soak --duration=2h --rate=240 --error-rate=0.05 --stall-rate=0.01 --stall-ms=35000 --outage-every=600 --outage-for=60 --out=soak.json --csv=soak.csv
+// Arguments (all optional):
+//   --duration=<N>[s|m|h]   recording time (default 60s)
+//   --rate=<Hz>             frameRate written to initialConfig.json, 1 to 240 (default 90)
+//   --seed=<N>              seed of the synthetic motion and of the faults (default 1)
+//   --latency-ms=<N> --jitter-ms=<N>      delay of every answer
+//   --error-rate=<0..1> --retry-after=<s> fraction of requests answered 503
+//   --stall-rate=<0..1> --stall-ms=<N>    fraction of requests held before the answer (> 30000 times out)
+//   --outage-every=<s> --outage-for=<s>   connections closed without an answer during the outage windows
+//   --report-every=<s>      period of the progress lines and CSV rows (default 10)
+//   --drain-timeout=<s>     time allowed to deliver everything after the recording (default 300)
+//   --dir=<path>            TELEMETRIA_FILES_DIR of the run: initialConfig.json, C3D parts, spool
+//   --config=<json members> extra initialConfig.json keys, e.g. --config='"spoolMaxMB":64,"c3dFormat":"int16"'
+//   --out=<file.json>       final report (default stdout)  --csv=<file.csv>  time series
+//
+// Reported: frame loss (frames recorded but neither delivered to the collector nor counted as dropped by the
+// library), engine ticks that were late, high-water marks of the queue / in-flight / spool / memory gauges
+// (sampled every 50 ms, short peaks can be missed), RSS over time, upload throughput and the C3D finalize time.
+// After the recording the faults are cleared and the harness waits until the collector has every frame (spool
+// included, the drainer may back off up to a minute).
+// Ctrl-C ends the recording early (the drain and the report still run). Exit status 1 when frames were lost,
+// the drain timed out, the C3D output failed or (TELEMETRIA_ALLOC_STATS builds) telemetry_record_frame allocated
+// after the warm-up.
+
+#include "TelemetriaAPI.h"
+#include "SoakCollector.h"
+#include "SyntheticMotion.h"
+
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+volatile std::sig_atomic_t g_interrupted = 0;
+
+void onSignal(int) { g_interrupted = 1; }
+
+double secondsSince(Clock::time_point t0) {
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+// Resident set size in kB (current, from /proc/self/statm).
+unsigned long long rssKb() {
+    unsigned long long pages = 0, resident = 0;
+    FILE* f = std::fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    if (std::fscanf(f, "%llu %llu", &pages, &resident) != 2) resident = 0;
+    std::fclose(f);
+    return resident * (unsigned long long)sysconf(_SC_PAGESIZE) / 1024;
+}
+
+// Peak resident set size in kB (VmHWM in /proc/self/status).
+unsigned long long peakRssKb() {
+    FILE* f = std::fopen("/proc/self/status", "r");
+    if (!f) return 0;
+    char line[256];
+    unsigned long long kb = 0;
+    while (std::fgets(line, sizeof(line), f)) {
+        if (std::strncmp(line, "VmHWM:", 6) == 0) {
+            kb = std::strtoull(line + 6, nullptr, 10);
+            break;
+        }
+    }
+    std::fclose(f);
+    return kb;
+}
+
+// "90", "90s", "15m", "2h" -> seconds
+bool parseDuration(const char* text, double& outSec) {
+    char* end = nullptr;
+    const double v = std::strtod(text, &end);
+    if (end == text || v <= 0.0) return false;
+    double unit = 1.0;
+    if (*end == 'm') unit = 60.0;
+    else if (*end == 'h') unit = 3600.0;
+    else if (*end != 's' && *end != '\0') return false;
+    outSec = v * unit;
+    return true;
+}
+
+bool writeFile(const std::string& path, const std::string& text) {
+    FILE* f = std::fopen(path.c_str(), "w");
+    if (!f) return false;
+    const bool ok = std::fputs(text.c_str(), f) >= 0;
+    return std::fclose(f) == 0 && ok;
+}
+
+struct Options {
+    double durationSec = 60.0;
+    int rate = 90;
+    unsigned long long seed = 1;
+    SoakCollector::Faults faults;
+    double reportEverySec = 10.0;
+    double drainTimeoutSec = 300.0;
+    std::string dir = "/tmp/telemetria_soak";
+    std::string config;
+    std::string out;
+    std::string csv;
+};
+
+// Maximum of every gauge seen by the monitor.
+struct HighWater {
+    unsigned long long chunksQueued = 0;
+    unsigned long long uploadsInFlight = 0;
+    unsigned long long spoolBytes = 0;
+    unsigned long long c3dFramesBuffered = 0;
+    unsigned long long memoryBytes = 0;
+
+    void update(const TelemetryStatsPlain& s) {
+        chunksQueued = std::max(chunksQueued, s.chunksQueued);
+        uploadsInFlight = std::max(uploadsInFlight, s.uploadsInFlight);
+        spoolBytes = std::max(spoolBytes, s.spoolBytes);
+        c3dFramesBuffered = std::max(c3dFramesBuffered, s.c3dFramesBuffered);
+        memoryBytes = std::max(memoryBytes, s.memoryBytes);
+    }
+};
+
+// Samples the stats every 50 ms for the high-water marks, prints a progress line and writes a CSV row every
+// reportEverySec. Runs from telemetry_initialize until stop is set (after the drain, before telemetry_shutdown).
+class Monitor {
+public:
+    Monitor(const Options& options, const SoakCollector& collector, FILE* csv)
+        : options_(options), collector_(collector), csv_(csv) {}
+
+    void start() {
+        t0_ = Clock::now();
+        if (csv_) {
+            std::fputs("t_sec,frames_recorded,frames_dropped,frames_delivered,chunks_queued,uploads_in_flight,"
+                       "spool_bytes,memory_bytes,c3d_frames_buffered,rss_kb,requests,errors,upload_bytes_per_sec\n",
+                       csv_);
+        }
+        thread_ = std::thread(&Monitor::run, this);
+    }
+
+    void stop() {
+        stop_ = true;
+        if (thread_.joinable()) thread_.join();
+        report(); // last row
+    }
+
+    HighWater highWater() const { return highWater_; }
+    // RSS at the first report, after the buffers and the first parts are allocated: the baseline for growth.
+    unsigned long long rssWarmKb() const { return rssWarmKb_; }
+
+private:
+    const Options& options_;
+    const SoakCollector& collector_;
+    FILE* csv_;
+    std::thread thread_;
+    std::atomic<bool> stop_{false};
+    Clock::time_point t0_;
+    HighWater highWater_;
+    unsigned long long rssWarmKb_ = 0;
+    double lastReportSec_ = 0.0;
+    unsigned long long lastBytes_ = 0;
+
+    void run() {
+        double nextReport = options_.reportEverySec;
+        while (!stop_) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            TelemetryStatsPlain s;
+            telemetry_get_stats(&s);
+            highWater_.update(s);
+            if (secondsSince(t0_) >= nextReport) {
+                report();
+                nextReport += options_.reportEverySec;
+            }
+        }
+    }
+
+    void report() {
+        TelemetryStatsPlain s;
+        telemetry_get_stats(&s);
+        highWater_.update(s);
+        const SoakCollector::Counters c = collector_.counters();
+        const double t = secondsSince(t0_);
+        const unsigned long long rss = rssKb();
+        if (rssWarmKb_ == 0) rssWarmKb_ = rss;
+        const double interval = t - lastReportSec_;
+        const double throughput = interval > 0.0 ? (double)(c.bytes - lastBytes_) / interval : 0.0;
+        lastReportSec_ = t;
+        lastBytes_ = c.bytes;
+
+        std::fprintf(stderr,
+                     "[%7.0fs] frames %llu (dropped %llu, delivered %llu)  queue %llu  in flight %llu  "
+                     "spool %.1f MB  mem %.1f MB  rss %.1f MB  requests %llu (503 %llu, closed %llu)  %.1f kB/s\n",
+                     t, s.framesRecorded, s.framesDropped, c.frames, s.chunksQueued, s.uploadsInFlight,
+                     s.spoolBytes / 1048576.0, s.memoryBytes / 1048576.0, rss / 1024.0, c.requests, c.errors,
+                     c.dropped, throughput / 1024.0);
+        if (csv_) {
+            std::fprintf(csv_, "%.1f,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%.0f\n", t,
+                         s.framesRecorded, s.framesDropped, c.frames, s.chunksQueued, s.uploadsInFlight, s.spoolBytes,
+                         s.memoryBytes, s.c3dFramesBuffered, rss, c.requests, c.errors, throughput);
+            std::fflush(csv_);
+        }
+    }
+};
+
+void appendLatency(std::string& json, const char* name, const TelemetryLatencyPlain& l, bool last = false) {
+    char buf[256];
+    std::snprintf(buf, sizeof(buf), "    \"%s\": {\"count\": %llu, \"p50_us\": %.1f, \"p99_us\": %.1f, \"max_us\": %.1f}%s\n",
+                  name, l.count, l.p50Us, l.p99Us, l.maxUs, last ? "" : ",");
+    json += buf;
+}
+
+void appendAlloc(std::string& json, const char* name, const TelemetryAllocPlain& a) {
+    char buf[160];
+    std::snprintf(buf, sizeof(buf), "    \"%s\": {\"count\": %llu, \"bytes\": %llu},\n", name, a.count, a.bytes);
+    json += buf;
+}
+
+const char* usage() {
+    return "usage: telemetria_soak [--duration=N[s|m|h]] [--rate=Hz] [--seed=N] [--latency-ms=N] [--jitter-ms=N]\n"
+           "       [--error-rate=0..1] [--retry-after=s] [--stall-rate=0..1] [--stall-ms=N] [--outage-every=s]\n"
+           "       [--outage-for=s] [--report-every=s] [--drain-timeout=s] [--dir=path] [--config=json members]\n"
+           "       [--out=file.json] [--csv=file.csv]\n";
+}
+
+bool parseArgs(int argc, char** argv, Options& o) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* eq = std::strchr(arg, '=');
+        if (!eq) return false;
+        const std::string key(arg, eq - arg);
+        const char* v = eq + 1;
+        if (key == "--duration") {
+            if (!parseDuration(v, o.durationSec)) return false;
+        } else if (key == "--rate") {
+            o.rate = std::atoi(v);
+            if (o.rate < 1 || o.rate > 240) return false;
+        } else if (key == "--seed") {
+            o.seed = std::strtoull(v, nullptr, 10);
+        } else if (key == "--latency-ms") {
+            o.faults.latencyMs = std::max(0, std::atoi(v));
+        } else if (key == "--jitter-ms") {
+            o.faults.jitterMs = std::max(0, std::atoi(v));
+        } else if (key == "--error-rate") {
+            o.faults.errorRate = std::min(1.0, std::max(0.0, std::atof(v)));
+        } else if (key == "--retry-after") {
+            o.faults.retryAfterSec = std::max(0, std::atoi(v));
+        } else if (key == "--stall-rate") {
+            o.faults.stallRate = std::min(1.0, std::max(0.0, std::atof(v)));
+        } else if (key == "--stall-ms") {
+            o.faults.stallMs = std::max(0, std::atoi(v));
+        } else if (key == "--outage-every") {
+            o.faults.outageEverySec = std::max(0, std::atoi(v));
+        } else if (key == "--outage-for") {
+            o.faults.outageForSec = std::max(0, std::atoi(v));
+        } else if (key == "--report-every") {
+            if (!parseDuration(v, o.reportEverySec)) return false;
+        } else if (key == "--drain-timeout") {
+            if (!parseDuration(v, o.drainTimeoutSec)) return false;
+        } else if (key == "--dir") {
+            o.dir = v;
+        } else if (key == "--config") {
+            o.config = v;
+        } else if (key == "--out") {
+            o.out = v;
+        } else if (key == "--csv") {
+            o.csv = v;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseArgs(argc, argv, options)) {
+        std::fputs(usage(), stderr);
+        return 2;
+    }
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    SoakCollector collector;
+    if (!collector.start(options.faults, options.seed)) return 1;
+
+    // The library reads initialConfig.json from TELEMETRIA_FILES_DIR and writes the C3D parts and the spool there
+    mkdir(options.dir.c_str(), 0755);
+    setenv("TELEMETRIA_FILES_DIR", options.dir.c_str(), 1);
+    std::string config = "{\"endpoint\":\"http://127.0.0.1:" + std::to_string(collector.port()) +
+                         "\",\"apiKey\":\"soak\",\"transport\":\"socket\",\"frameRate\":" +
+                         std::to_string(options.rate) + ",\"logLevel\":\"warn\"";
+    if (!options.config.empty()) config += "," + options.config;
+    config += "}\n";
+    if (!writeFile(options.dir + "/initialConfig.json", config)) {
+        std::fprintf(stderr, "cannot write %s/initialConfig.json\n", options.dir.c_str());
+        return 1;
+    }
+
+    FILE* csv = nullptr;
+    if (!options.csv.empty() && !(csv = std::fopen(options.csv.c_str(), "w"))) {
+        std::fprintf(stderr, "cannot write %s\n", options.csv.c_str());
+        return 1;
+    }
+
+    const std::string sessionId = "soak-" + std::to_string(options.seed) + "-" + std::to_string((long long)time(nullptr));
+    TelemetryConfigPlain cfg = {sessionId.c_str(), "telemetria_soak"};
+    const int rate = telemetry_initialize(&cfg);
+    if (rate <= 0) {
+        std::fprintf(stderr, "telemetry_initialize failed: %d\n", rate);
+        return 1;
+    }
+    std::fprintf(stderr, "soak: %.0f s at %d Hz, collector on 127.0.0.1:%d, files in %s\n", options.durationSec, rate,
+                 collector.port(), options.dir.c_str());
+    const unsigned long long rssStartKb = rssKb();
+
+    Monitor monitor(options, collector, csv);
+    monitor.start();
+
+    // Engine loop: one frame per tick on absolute deadlines. Ticks missed by more than a period are skipped, as a
+    // game loop would, and counted; the frame times come from the generator either way.
+    SyntheticMotion::Options motionOptions;
+    motionOptions.seed = options.seed;
+    motionOptions.rateHz = rate;
+    SyntheticMotion motion(motionOptions);
+    const long long periodNs = 1000000000LL / rate;
+    const unsigned long long ticks = (unsigned long long)(options.durationSec * rate);
+    unsigned long long late = 0, skipped = 0;
+    timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    const Clock::time_point recordStart = Clock::now();
+    VRFrameDataPlain frame;
+    for (unsigned long long tick = 0; tick < ticks && !g_interrupted; ++tick) {
+        motion.next(frame);
+        telemetry_record_frame(&frame);
+
+        deadline.tv_nsec += periodNs;
+        while (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_nsec -= 1000000000L;
+            ++deadline.tv_sec;
+        }
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        const long long behindNs =
+                (now.tv_sec - deadline.tv_sec) * 1000000000LL + (now.tv_nsec - deadline.tv_nsec);
+        if (behindNs > 0) {
+            ++late;
+            if (behindNs > periodNs) {
+                const long long missed = behindNs / periodNs;
+                skipped += (unsigned long long)missed;
+                tick += (unsigned long long)missed;
+                deadline = now;
+            }
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr);
+    }
+    const double recordSec = secondsSince(recordStart);
+    // Ctrl-C ends the recording early; a second one skips the drain
+    const bool interrupted = g_interrupted != 0;
+    g_interrupted = 0;
+
+    // Drain: seal the last chunk, stop injecting faults and wait until everything is delivered
+    telemetry_force_upload();
+    collector.setFaults(SoakCollector::Faults());
+    const Clock::time_point drainStart = Clock::now();
+    // Drained once the collector has every frame the library did not drop and nothing is queued or in flight.
+    // The spool gauges cannot tell it (spoolBytes keeps the consumed records of the write segment), and frames
+    // that were lost never arrive: then it runs until the drain timeout.
+    bool drained = false;
+    while (!g_interrupted && secondsSince(drainStart) < options.drainTimeoutSec) {
+        TelemetryStatsPlain s;
+        telemetry_get_stats(&s);
+        if (s.chunksQueued == 0 && s.uploadsInFlight == 0 &&
+            collector.counters().frames >= s.framesRecorded - s.framesDropped) {
+            drained = true;
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    const double drainSec = secondsSince(drainStart);
+    monitor.stop();
+    if (csv) std::fclose(csv);
+
+    TelemetryStatsPlain stats;
+    telemetry_get_stats(&stats);
+    // C3D finalize: telemetry_shutdown hands the last frames to the writer thread, which closes the parts
+    const Clock::time_point shutdownStart = Clock::now();
+    telemetry_shutdown();
+    const double shutdownMs = secondsSince(shutdownStart) * 1000.0;
+    const int c3dStatus = telemetry_c3d_wait(120000);
+    const double finalizeMs = secondsSince(shutdownStart) * 1000.0;
+    collector.stop();
+
+    TelemetryStatsPlain after;
+    telemetry_get_stats(&after);
+    TelemetryLatencyStatsPlain latency;
+    telemetry_get_latency(&latency);
+    TelemetryAllocStatsPlain alloc;
+    telemetry_get_alloc_stats(&alloc);
+    const SoakCollector::Counters c = collector.counters();
+    const HighWater hw = monitor.highWater();
+
+    // Frames the library neither delivered nor counted as dropped. More delivered than expected means requests
+    // that were sent again after the client gave up on an answer the collector did send (duplicates, not loss).
+    const unsigned long long expected = stats.framesRecorded - stats.framesDropped;
+    const unsigned long long lost = expected > c.frames ? expected - c.frames : 0;
+    const unsigned long long duplicated = c.frames > expected ? c.frames - expected : 0;
+    const bool c3dOk = c3dStatus == TELEMETRY_C3D_DONE || c3dStatus == TELEMETRY_C3D_IDLE;
+
+    char buf[1024];
+    std::string json = "{\n";
+    std::snprintf(buf, sizeof(buf),
+                  "  \"config\": {\"duration_sec\": %.0f, \"rate_hz\": %d, \"seed\": %llu, \"latency_ms\": %d, "
+                  "\"jitter_ms\": %d, \"error_rate\": %g, \"stall_rate\": %g, \"stall_ms\": %d, "
+                  "\"outage_every_sec\": %d, \"outage_for_sec\": %d},\n",
+                  options.durationSec, rate, options.seed, options.faults.latencyMs, options.faults.jitterMs,
+                  options.faults.errorRate, options.faults.stallRate, options.faults.stallMs,
+                  options.faults.outageEverySec, options.faults.outageForSec);
+    json += buf;
+    std::snprintf(buf, sizeof(buf),
+                  "  \"record_sec\": %.1f,\n  \"interrupted\": %s,\n  \"drained\": %s,\n  \"drain_sec\": %.1f,\n"
+                  "  \"frames\": {\"recorded\": %llu, \"dropped\": %llu, \"delivered\": %llu, \"lost\": %llu, "
+                  "\"duplicated\": %llu, \"late_ticks\": %llu, \"skipped_ticks\": %llu},\n",
+                  recordSec, interrupted ? "true" : "false", drained ? "true" : "false", drainSec,
+                  stats.framesRecorded, stats.framesDropped, c.frames, lost, duplicated, late, skipped);
+    json += buf;
+    std::snprintf(buf, sizeof(buf),
+                  "  \"high_water\": {\"chunks_queued\": %llu, \"uploads_in_flight\": %llu, \"spool_bytes\": %llu, "
+                  "\"c3d_frames_buffered\": %llu, \"memory_bytes\": %llu},\n"
+                  "  \"rss_kb\": {\"start\": %llu, \"warm\": %llu, \"end\": %llu, \"peak\": %llu},\n",
+                  hw.chunksQueued, hw.uploadsInFlight, hw.spoolBytes, hw.c3dFramesBuffered, hw.memoryBytes,
+                  rssStartKb, monitor.rssWarmKb(), rssKb(), peakRssKb());
+    json += buf;
+    const double uploadSec = recordSec + drainSec;
+    std::snprintf(buf, sizeof(buf),
+                  "  \"upload\": {\"requests\": %llu, \"accepted\": %llu, \"errors_503\": %llu, \"stalls\": %llu, "
+                  "\"closed_unanswered\": %llu, \"bytes\": %llu, \"bytes_per_sec\": %.0f, \"chunks_sealed\": %llu, "
+                  "\"chunks_failed\": %llu, \"chunks_spooled\": %llu, \"chunks_evicted\": %llu, "
+                  "\"spool_records_uploaded\": %llu},\n",
+                  c.requests, c.accepted, c.errors, c.stalls, c.dropped, c.bytes,
+                  uploadSec > 0.0 ? c.bytes / uploadSec : 0.0, stats.chunksSealed, stats.chunksFailed,
+                  stats.chunksSpooled, stats.chunksEvicted, stats.spoolRecordsUploaded);
+    json += buf;
+    std::snprintf(buf, sizeof(buf),
+                  "  \"c3d\": {\"status\": %d, \"shutdown_ms\": %.1f, \"finalize_ms\": %.1f, \"frames_recorded\": %llu, "
+                  "\"frames_dropped\": %llu, \"frames_written\": %llu},\n",
+                  c3dStatus, shutdownMs, finalizeMs, after.c3dFramesRecorded, after.c3dFramesDropped,
+                  after.c3dFramesWritten);
+    json += buf;
+    json += "  \"latency\": {\n";
+    appendLatency(json, "record_frame", latency.recordFrame);
+    appendLatency(json, "queue_wait", latency.queueWait);
+    appendLatency(json, "serialize", latency.serialize);
+    appendLatency(json, "upload", latency.upload);
+    appendLatency(json, "c3d_finalize", latency.c3dFinalize, true);
+    json += "  },\n  \"alloc\": {\n";
+    std::snprintf(buf, sizeof(buf), "    \"enabled\": %d,\n", alloc.enabled);
+    json += buf;
+    appendAlloc(json, "record_frame", alloc.recordFrame);
+    appendAlloc(json, "serialize", alloc.serialize);
+    appendAlloc(json, "upload", alloc.upload);
+    appendAlloc(json, "c3d", alloc.c3d);
+    appendAlloc(json, "untagged", alloc.untagged);
+    std::snprintf(buf, sizeof(buf), "    \"record_frame_checked\": %llu,\n    \"record_frame_allocating\": %llu\n  }\n}\n",
+                  alloc.recordFrameChecked, alloc.recordFrameAllocating);
+    json += buf;
+
+    if (options.out.empty()) {
+        std::fputs(json.c_str(), stdout);
+    } else if (!writeFile(options.out, json)) {
+        std::fprintf(stderr, "cannot write %s\n", options.out.c_str());
+        return 1;
+    }
+
+    std::fprintf(stderr, "soak: %llu frames recorded, %llu dropped, %llu lost, drain %s in %.1f s, C3D %s in %.0f ms\n",
+                 stats.framesRecorded, stats.framesDropped, lost, drained ? "done" : "timed out", drainSec,
+                 c3dOk ? "done" : "FAILED", finalizeMs);
+    const bool allocOk = !alloc.enabled || alloc.recordFrameAllocating == 0;
+    if (!allocOk) {
+        std::fprintf(stderr, "soak: %llu of %llu checked telemetry_record_frame calls allocated\n",
+                     alloc.recordFrameAllocating, alloc.recordFrameChecked);
+    }
+    return (lost == 0 && drained && c3dOk && allocOk) ? 0 : 1;
+}
@@ -0,0 +1,68 @@
+#include "ThreadPoolAsyncIo.h"
+#include <cerrno>
+#include <unistd.h>
+
+ThreadPoolAsyncIo::~ThreadPoolAsyncIo() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stop_ = true;
+    }
+    jobCv_.notify_all();
+    for (auto& t : threads_) {
+        if (t.joinable()) t.join();
+    }
+}
+
+void ThreadPoolAsyncIo::start(size_t threads) {
+    threads_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        threads_.emplace_back(&ThreadPoolAsyncIo::loop, this);
+    }
+}
+
+bool ThreadPoolAsyncIo::submit(int fd, const char* data, size_t len, off_t off, uint32_t tag) {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (stop_ || threads_.empty()) return false;
+        jobs_.push_back(Job{fd, data, len, off, tag});
+    }
+    jobCv_.notify_one();
+    return true;
+}
+
+void ThreadPoolAsyncIo::waitOne(uint32_t& tag, ssize_t& result) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    doneCv_.wait(lock, [&]{ return !done_.empty(); });
+    tag = done_.front().tag;
+    result = done_.front().result;
+    done_.pop_front();
+}
+
+void ThreadPoolAsyncIo::loop() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            jobCv_.wait(lock, [&]{ return stop_ || !jobs_.empty(); });
+            if (jobs_.empty()) return; // stop_ and nothing left
+            job = jobs_.front();
+            jobs_.pop_front();
+        }
+        // Whole buffer or an error, like a single io_uring write of a regular file
+        ssize_t written = 0;
+        while ((size_t)written < job.len) {
+            ssize_t n = ::pwrite(job.fd, job.data + written, job.len - written, job.off + written);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                written = n < 0 ? -errno : written;
+                break;
+            }
+            written += n;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            done_.push_back(Done{job.tag, written});
+        }
+        doneCv_.notify_one();
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include "AsyncIo.h"
+
+// AsyncIo fallback: a small pool of threads doing blocking pwrite. Used when io_uring is not available
+// (Quest 2 kernels are 4.19) or not allowed, which is the usual case for Android apps.
+class ThreadPoolAsyncIo : public AsyncIo {
+public:
+    ThreadPoolAsyncIo() = default;
+    ~ThreadPoolAsyncIo() override;
+
+    // Starts the threads.
+    void start(size_t threads);
+
+    const char* name() const override { return "threads"; }
+    bool submit(int fd, const char* data, size_t len, off_t off, uint32_t tag) override;
+    void waitOne(uint32_t& tag, ssize_t& result) override;
+
+private:
+    struct Job {
+        int fd;
+        const char* data;
+        size_t len;
+        off_t off;
+        uint32_t tag;
+    };
+    struct Done {
+        uint32_t tag;
+        ssize_t result;
+    };
+
+    std::mutex mtx_;
+    std::condition_variable jobCv_;
+    std::condition_variable doneCv_;
+    std::deque<Job> jobs_;
+    std::deque<Done> done_;
+    bool stop_ = false;
+    std::vector<std::thread> threads_;
+
+    void loop();
+};
@@ -18,6 +18,49 @@ struct UploaderConfig {
     bool grip = false;
     bool trigger = false;
     bool joystick = false;
+    // Offline spool: chunks that cannot be uploaded are kept on disk and sent later (DEFAULT = enabled).
+    bool spoolEnabled = true;
+    int spoolMaxMB = 256; // disk budget for the spool, oldest data is dropped first
+    // Request coalescing: chunks waiting in the queue are merged into one POST.
+    int coalesceWindowMs = 250; // how long the worker waits for more chunks before sending
+    int maxRequestKB = 1024;    // upper limit of a merged request body
+    // Debug HTTP: ask the backend to echo the inserted rows and log a preview of the response (DEFAULT = false).
+    bool debugHttp = false;
+    // HTTP transport: "jni" (AyudanteHttp, needed for https), "socket" (native HTTP/1.1 for plain-HTTP
+    // collectors) or "auto" (socket for http:// endpoints or when unixSocketPath is set, jni otherwise).
+    std::string transport = "auto";
+    std::string unixSocketPath; // socket transport only: connect to this unix socket instead of TCP
+    // Staging: C3D parts and the upload spool are written to internal storage; finished parts are moved to the
+    // external files dir in the background (DEFAULT = false, everything goes straight to the external dir).
+    bool stageInternal = false;
+    // Write backend of C3D parts and spool segments: "threads" (background pwrite), "uring" (io_uring, falls
+    // back to threads where the kernel or the app sandbox does not allow it) or "sync" (blocking writes).
+    std::string ioBackend = "threads";
+    // C3D parts: a new session_<id>_partNNN.c3d starts when one of the limits is reached.
+    int c3dPartFrames = 65535; // at most 65535 (16-bit last frame in the C3D header)
+    int c3dPartSeconds = 600;  // 0 = no time limit
+    // Crash checkpoints: the open C3D part is synced and its header counts patched every N seconds (0 = off).
+    int c3dCheckpointSeconds = 5;
+    // Threads converting queued C3D blocks (finalize, slow storage). 0 = automatic, 1 = writer thread only.
+    int c3dConvertThreads = 0;
+    // C3D storage: "float" or "int16" (half the size, quantized; see configReader.h).
+    std::string c3dFormat = "float";
+    int c3dPointResolutionUm = 0; // int16 point step, 0 = chosen from the first frames of each part
+    // Span tracing of the pipeline, dumped with telemetry_trace_dump (DEFAULT = false).
+    bool trace = false;
+    // Logging: minimum level ("debug", "info", "warn", "error", "off") and messages per second per call site.
+    std::string logLevel = "info";
+    int logRateLimit = 20; // 0 = no limit
+};
+
+// Result of one HTTP upload. The response body itself is dropped by the transport (unless debugHttp),
+// only these numbers reach the uploader.
+struct UploadResult {
+    int httpStatus = -1;          // HTTP status code, -1 if no response was received (timeout, no network...)
+    int retryAfterSec = 0;        // Retry-After hint from the server in seconds, 0 if missing
+    long long bytesSent = 0;      // request body bytes
+    long long bytesReceived = 0;  // response body bytes
+    bool ok() const { return httpStatus >= 200 && httpStatus < 300; }
 };
 
 // Plain configuration struct sent from Unity/Unreal to the C API.
@@ -26,4 +69,80 @@ struct UploaderConfig {
 struct TelemetryConfigPlain {
     const char* sessionId;     // UTF-8
     const char* deviceInfo;    // UTF-8
-};
\ No newline at end of file
+};
+
+// Pipeline health returned by telemetry_get_stats. Counters start at 0 in telemetry_initialize and only grow,
+// gauges (marked) are the value at the time of the call. Plain 64-bit fields, easy to marshal from C#.
+struct TelemetryStatsPlain {
+    // JSON upload path
+    unsigned long long framesRecorded;       // frames passed to telemetry_record_frame
+    unsigned long long framesDropped;        // frames lost for good (queue overflow without spool, spool write failed)
+    unsigned long long chunksSealed;         // chunks closed (framesPerFile reached or forced)
+    unsigned long long chunksUploaded;       // chunks accepted by the backend on the first try
+    unsigned long long chunksFailed;         // chunks whose upload failed (they go to the spool when it is enabled)
+    unsigned long long chunksEvicted;        // chunks pushed out of the queue by maxQueuedChunks
+    unsigned long long chunksSpooled;        // chunks written to the disk spool
+    unsigned long long spoolRecordsUploaded; // spool records sent by the drainer
+    unsigned long long bytesSerialized;      // JSON bytes produced
+    unsigned long long bytesUploaded;        // request body bytes accepted by the backend (spool included)
+    unsigned long long chunksQueued;         // gauge: chunks waiting for the worker
+    unsigned long long uploadsInFlight;      // gauge: asynchronous requests running
+    unsigned long long spoolBytes;           // gauge: bytes on disk in the spool
+    // C3D recording
+    unsigned long long c3dFramesRecorded;    // frames accepted by the recorder
+    unsigned long long c3dFramesDropped;     // frames dropped because the writer thread was behind
+    unsigned long long c3dFramesWritten;     // frames appended to the part files
+    unsigned long long c3dFramesBuffered;    // gauge: frames recorded but not written yet
+    // gauge: approximate bytes held by frame buffers, queues and request bodies (C3D included)
+    unsigned long long memoryBytes;
+};
+
+// Latency of one pipeline stage since telemetry_initialize (percentiles are accurate to ~6%, see LatencyHistogram.h).
+struct TelemetryLatencyPlain {
+    unsigned long long count; // samples
+    double p50Us;
+    double p90Us;
+    double p99Us;
+    double maxUs;
+};
+
+// Latency of every stage, returned by telemetry_get_latency.
+struct TelemetryLatencyStatsPlain {
+    TelemetryLatencyPlain recordFrame; // telemetry_record_frame on the caller thread
+    TelemetryLatencyPlain queueWait;   // sealed chunk waiting for the upload worker
+    TelemetryLatencyPlain serialize;   // JSON encoding of one chunk
+    TelemetryLatencyPlain upload;      // HTTP round trip of one request (spool drainer included)
+    TelemetryLatencyPlain c3dFinalize; // telemetry_shutdown until the C3D files are closed
+};
+
+// Heap allocations of one pipeline stage (operator new calls and requested bytes).
+struct TelemetryAllocPlain {
+    unsigned long long count;
+    unsigned long long bytes;
+};
+
+// Allocation accounting returned by telemetry_get_alloc_stats. Only counted in builds with the
+// TELEMETRIA_ALLOC_STATS CMake option; otherwise enabled is 0 and everything else stays 0.
+struct TelemetryAllocStatsPlain {
+    int enabled;
+    TelemetryAllocPlain recordFrame;             // telemetry_record_frame (engine thread)
+    TelemetryAllocPlain serialize;               // JSON encoding of chunks
+    TelemetryAllocPlain upload;                  // request bodies, headers, transport and spool writes
+    TelemetryAllocPlain c3d;                     // C3D writer and conversion threads
+    TelemetryAllocPlain untagged;                // everything else in the process
+    unsigned long long recordFrameChecked;       // telemetry_record_frame calls checked (after the warm-up)
+    unsigned long long recordFrameAllocating;    // checked calls that allocated, must stay 0
+};
+
+// State of the C3D output, returned by telemetry_c3d_status / telemetry_c3d_wait
+// and passed to the completion callback.
+enum TelemetryC3DStatus {
+    TELEMETRY_C3D_FAILED     = -1, // finalize finished but some part could not be written
+    TELEMETRY_C3D_IDLE       = 0,  // not recording (not initialized or disabled)
+    TELEMETRY_C3D_RECORDING  = 1,
+    TELEMETRY_C3D_FINALIZING = 2,  // shutdown requested, background writer still closing files
+    TELEMETRY_C3D_DONE       = 3   // all parts closed and manifest complete
+};
+
+// Called once from the C3D writer thread when finalization ends (status DONE or FAILED).
+typedef void (*TelemetryC3DCallback)(int status, void* userData);
@@ -0,0 +1,444 @@
+#include "UploadSpool.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "TelemetriaLog.h"
+
+// Segment header: magic + format version
+static constexpr char     kSegMagic[4]   = {'T', 'S', 'P', 'L'};
+static constexpr uint32_t kSegVersion    = 1;
+static constexpr off_t    kSegHeaderSize = 8;
+// Record header: u32 length + u32 crc32
+static constexpr size_t   kRecHeaderSize = 8;
+// A new segment is started once the current one grows over this size.
+static constexpr off_t    kSegmentBytes  = 4 * 1024 * 1024;
+// Anything bigger than this in a record header means a torn/corrupted write.
+static constexpr uint32_t kMaxRecordSize = 64u * 1024u * 1024u;
+// fdatasync batching: sync after this many bytes or this much time, whatever comes first.
+static constexpr size_t   kSyncBytes     = 1024 * 1024;
+static constexpr auto     kSyncInterval  = std::chrono::seconds(1);
+// Cursor file content: magic + segment id + offset inside that segment
+static constexpr char     kCursorMagic[4] = {'T', 'S', 'P', 'C'};
+
+// Standard CRC-32 (IEEE 802.3), only used to detect torn writes after a crash or a power loss.
+static uint32_t crc32(const char* data, size_t len) {
+    static uint32_t table[256];
+    static bool tableReady = false;
+    if (!tableReady) {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1u) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            table[i] = c;
+        }
+        tableReady = true;
+    }
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < len; ++i) {
+        crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFFu] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// pwrite/pread wrappers that retry on EINTR and short transfers.
+static bool pwriteAll(int fd, const char* data, size_t len, off_t off) {
+    while (len > 0) {
+        ssize_t n = ::pwrite(fd, data, len, off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        len -= (size_t)n;
+        off += n;
+    }
+    return true;
+}
+
+static bool preadAll(int fd, char* data, size_t len, off_t off) {
+    while (len > 0) {
+        ssize_t n = ::pread(fd, data, len, off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (n == 0) return false; // unexpected end of file
+        data += n;
+        len -= (size_t)n;
+        off += n;
+    }
+    return true;
+}
+
+// mkdir -p
+static bool makeDirs(const std::string& dir) {
+    std::string partial;
+    size_t pos = 0;
+    while (pos != std::string::npos) {
+        pos = dir.find('/', pos + 1);
+        partial = dir.substr(0, pos);
+        if (partial.empty()) continue;
+        if (::mkdir(partial.c_str(), 0770) != 0 && errno != EEXIST) {
+            return false;
+        }
+    }
+    return true;
+}
+
+UploadSpool::~UploadSpool() {
+    close();
+}
+
+std::string UploadSpool::segmentPath(uint32_t id) const {
+    char name[32];
+    snprintf(name, sizeof(name), "/seg_%08u.spool", id);
+    return dir_ + name;
+}
+
+void UploadSpool::setIoBackend(const std::string& kind) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    writeIo_.setBackend(kind);
+}
+
+bool UploadSpool::open(const std::string& dir, size_t maxBytes) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (open_) return true;
+    dir_ = dir;
+    maxBytes_ = maxBytes;
+
+    if (!makeDirs(dir_)) {
+        LOGE("UploadSpool: cannot create %s (errno=%d: %s)", dir_.c_str(), errno, strerror(errno));
+        return false;
+    }
+
+    // Collect segments left by previous runs.
+    DIR* d = ::opendir(dir_.c_str());
+    if (!d) {
+        LOGE("UploadSpool: cannot list %s (errno=%d: %s)", dir_.c_str(), errno, strerror(errno));
+        return false;
+    }
+    std::vector<uint32_t> ids;
+    while (dirent* e = ::readdir(d)) {
+        unsigned id = 0;
+        char tail[8] = {0};
+        if (sscanf(e->d_name, "seg_%8u.%7s", &id, tail) == 2 && strcmp(tail, "spool") == 0 && id > 0) {
+            ids.push_back(id);
+        }
+    }
+    ::closedir(d);
+    std::sort(ids.begin(), ids.end());
+
+    segments_.clear();
+    totalBytes_ = 0;
+    for (uint32_t id : ids) {
+        struct stat st;
+        const std::string path = segmentPath(id);
+        if (::stat(path.c_str(), &st) != 0 || st.st_size <= kSegHeaderSize) {
+            ::unlink(path.c_str()); // empty or unreadable leftovers
+            continue;
+        }
+        segments_.push_back(id);
+        totalBytes_ += (size_t)st.st_size;
+    }
+
+    // Restore where the drainer stopped last time.
+    readSeg_ = 0;
+    readOff_ = kSegHeaderSize;
+    uint32_t cursorSeg = 0;
+    cursorFd_ = ::open((dir_ + "/cursor").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0660);
+    if (cursorFd_ >= 0) {
+        char buf[16];
+        if (preadAll(cursorFd_, buf, sizeof(buf), 0) && memcmp(buf, kCursorMagic, 4) == 0) {
+            uint32_t seg;
+            uint64_t off;
+            memcpy(&seg, buf + 4, 4);
+            memcpy(&off, buf + 8, 8);
+            cursorSeg = seg;
+            // Segments older than the cursor were fully uploaded but not deleted yet (crash in between).
+            while (!segments_.empty() && segments_.front() < seg) {
+                removeOldestSegment();
+            }
+            if (!segments_.empty() && segments_.front() == seg && off > (uint64_t)kSegHeaderSize) {
+                readSeg_ = seg;
+                readOff_ = (off_t)off;
+            }
+        }
+    }
+
+    // Never append to a segment from a previous run (its tail may be torn), always start a new one.
+    // Ids are never reused, also once every segment is gone: a new segment with the id of the cursor would be
+    // read from the old offset, and one below it would be dropped as already uploaded.
+    lastSync_ = std::chrono::steady_clock::now();
+    const uint32_t nextId = std::max(segments_.empty() ? 1u : segments_.back() + 1u, cursorSeg + 1u);
+    if (!startSegment(nextId)) {
+        if (cursorFd_ >= 0) { ::close(cursorFd_); cursorFd_ = -1; }
+        return false;
+    }
+    open_ = true;
+
+    if (segments_.size() > 1) {
+        LOGI("UploadSpool: found %zu pending segment(s), %zu bytes in %s",
+             segments_.size() - 1, totalBytes_.load(), dir_.c_str());
+    }
+    return true;
+}
+
+void UploadSpool::close() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (!open_) return;
+    syncLocked();
+    writeIo_.attach(-1);
+    if (writeFd_ >= 0) {
+        ::ftruncate(writeFd_, writeOff_); // preallocated space
+        ::close(writeFd_);
+        writeFd_ = -1;
+    }
+    if (readFd_ >= 0) { ::close(readFd_); readFd_ = -1; }
+    if (cursorFd_ >= 0) { ::close(cursorFd_); cursorFd_ = -1; }
+    segments_.clear();
+    totalBytes_ = 0;
+    peekNext_ = 0;
+    open_ = false;
+}
+
+bool UploadSpool::isOpen() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return open_;
+}
+
+bool UploadSpool::startSegment(uint32_t id) {
+    // Seal the previous write segment: everything in it must be on disk before we move on.
+    if (writeFd_ >= 0) {
+        syncLocked();
+        writeIo_.attach(-1);
+        // Release the preallocated space after the last record
+        if (::ftruncate(writeFd_, writeOff_) != 0) {
+            LOGE("UploadSpool: ftruncate failed (errno=%d: %s)", errno, strerror(errno));
+        }
+        ::close(writeFd_);
+        writeFd_ = -1;
+    }
+    const std::string path = segmentPath(id);
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0660);
+    if (fd < 0) {
+        LOGE("UploadSpool: cannot create %s (errno=%d: %s)", path.c_str(), errno, strerror(errno));
+        return false;
+    }
+    char header[kSegHeaderSize];
+    memcpy(header, kSegMagic, 4);
+    memcpy(header + 4, &kSegVersion, 4);
+    if (!pwriteAll(fd, header, sizeof(header), 0)) {
+        LOGE("UploadSpool: cannot write segment header (errno=%d: %s)", errno, strerror(errno));
+        ::close(fd);
+        ::unlink(path.c_str());
+        return false;
+    }
+    AsyncFile::preallocate(fd, kSegmentBytes);
+    writeIo_.attach(fd);
+    writeFd_ = fd;
+    writeSeg_ = id;
+    writeOff_ = kSegHeaderSize;
+    segments_.push_back(id);
+    totalBytes_ += kSegHeaderSize;
+    return true;
+}
+
+bool UploadSpool::openReadSegment() {
+    while (!segments_.empty()) {
+        const uint32_t id = segments_.front();
+        if (readFd_ >= 0 && readSeg_ == id) return true;
+        if (readFd_ >= 0) { ::close(readFd_); readFd_ = -1; }
+
+        if (readSeg_ != id) {
+            readSeg_ = id;
+            readOff_ = kSegHeaderSize;
+        }
+        readFd_ = ::open(segmentPath(id).c_str(), O_RDONLY | O_CLOEXEC);
+        char header[kSegHeaderSize];
+        uint32_t version = 0;
+        if (readFd_ >= 0 && preadAll(readFd_, header, sizeof(header), 0)) {
+            memcpy(&version, header + 4, 4);
+        }
+        if (readFd_ < 0 || memcmp(header, kSegMagic, 4) != 0 || version != kSegVersion) {
+            LOGE("UploadSpool: segment %u unreadable or corrupted, discarding it", id);
+            if (id == writeSeg_) return false;
+            removeOldestSegment();
+            continue;
+        }
+        if (id != writeSeg_) {
+            struct stat st;
+            readSegSize_ = (::fstat(readFd_, &st) == 0) ? st.st_size : 0;
+        }
+        return true;
+    }
+    return false;
+}
+
+void UploadSpool::removeOldestSegment() {
+    if (segments_.empty()) return;
+    const uint32_t id = segments_.front();
+    if (id == writeSeg_ && writeFd_ >= 0) return; // never drop the segment we are writing to
+    const std::string path = segmentPath(id);
+    struct stat st;
+    if (::stat(path.c_str(), &st) == 0) {
+        totalBytes_ -= std::min(totalBytes_.load(), (size_t)st.st_size);
+    }
+    ::unlink(path.c_str());
+    segments_.pop_front();
+    if (readSeg_ == id) {
+        if (readFd_ >= 0) { ::close(readFd_); readFd_ = -1; }
+        readSeg_ = 0;
+        readOff_ = kSegHeaderSize;
+        peekNext_ = 0;
+    }
+}
+
+void UploadSpool::saveCursor() {
+    if (cursorFd_ < 0) return;
+    char buf[16];
+    const uint64_t off = (uint64_t)readOff_;
+    memcpy(buf, kCursorMagic, 4);
+    memcpy(buf + 4, &readSeg_, 4);
+    memcpy(buf + 8, &off, 8);
+    // Not synced: losing the cursor only means re-sending the last uploaded record.
+    pwriteAll(cursorFd_, buf, sizeof(buf), 0);
+}
+
+bool UploadSpool::append(const std::string& payload) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (!open_ || writeFd_ < 0) return false;
+    if (payload.size() > kMaxRecordSize) {
+        LOGE("UploadSpool: record of %zu bytes is too big, dropping it", payload.size());
+        return false;
+    }
+    const size_t recSize = kRecHeaderSize + payload.size();
+
+    // Roll to a new segment when the current one is full (unless it is still empty).
+    if (writeOff_ > kSegHeaderSize && writeOff_ + (off_t)recSize > kSegmentBytes) {
+        if (!startSegment(writeSeg_ + 1)) return false;
+    }
+    // Disk budget: drop the oldest data first, same policy as the in-memory queue.
+    while (maxBytes_ > 0 && totalBytes_ + recSize > maxBytes_ && segments_.size() > 1) {
+        LOGE("UploadSpool: over %zu bytes, dropping oldest segment %u", maxBytes_, segments_.front());
+        removeOldestSegment();
+    }
+
+    const uint32_t len = (uint32_t)payload.size();
+    const uint32_t crc = crc32(payload.data(), payload.size());
+    scratch_.resize(recSize);
+    memcpy(scratch_.data(), &len, 4);
+    memcpy(scratch_.data() + 4, &crc, 4);
+    memcpy(scratch_.data() + kRecHeaderSize, payload.data(), payload.size());
+    if (!writeIo_.write(scratch_.data(), recSize, writeOff_) || !writeIo_.submit()) {
+        // The error sticks to the segment (an earlier record may be the one that failed): continue in a new
+        // one, the reader skips the torn tail of this one by its crc
+        LOGE("UploadSpool: write to segment %u failed", writeSeg_);
+        startSegment(writeSeg_ + 1);
+        return false;
+    }
+    writeOff_ += (off_t)recSize;
+    totalBytes_ += recSize;
+    unsyncedBytes_ += recSize;
+
+    if (unsyncedBytes_ >= kSyncBytes || std::chrono::steady_clock::now() - lastSync_ >= kSyncInterval) {
+        syncLocked();
+    }
+    return true;
+}
+
+bool UploadSpool::peek(std::string& out) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (!open_) return false;
+    while (!emptyLocked()) {
+        if (!openReadSegment()) return false;
+        const bool isWriteSeg = (readSeg_ == writeSeg_);
+        const off_t end = isWriteSeg ? writeOff_ : readSegSize_;
+        // Records of the write segment may still be in flight
+        if (isWriteSeg && !writeIo_.flush()) {
+            LOGE("UploadSpool: write to segment %u failed", writeSeg_);
+        }
+
+        if (readOff_ + (off_t)kRecHeaderSize > end) {
+            if (isWriteSeg) return false;
+            removeOldestSegment(); // fully consumed
+            continue;
+        }
+        char header[kRecHeaderSize];
+        uint32_t len = 0, crc = 0;
+        if (preadAll(readFd_, header, sizeof(header), readOff_)) {
+            memcpy(&len, header, 4);
+            memcpy(&crc, header + 4, 4);
+        }
+        const off_t next = readOff_ + (off_t)kRecHeaderSize + (off_t)len;
+        if (len == 0 || len > kMaxRecordSize || next > end) {
+            // Torn tail from a crash: the rest of this segment is unusable.
+            LOGE("UploadSpool: truncated record in segment %u at %lld, skipping rest of segment",
+                 readSeg_, (long long)readOff_);
+            if (isWriteSeg) return false;
+            removeOldestSegment();
+            continue;
+        }
+        out.resize(len);
+        if (!preadAll(readFd_, &out[0], len, readOff_ + (off_t)kRecHeaderSize)) {
+            LOGE("UploadSpool: pread failed (errno=%d: %s)", errno, strerror(errno));
+            return false;
+        }
+        if (crc32(out.data(), out.size()) != crc) {
+            LOGE("UploadSpool: bad crc in segment %u at %lld, skipping record", readSeg_, (long long)readOff_);
+            readOff_ = next;
+            saveCursor();
+            continue;
+        }
+        peekNext_ = next;
+        return true;
+    }
+    return false;
+}
+
+void UploadSpool::pop() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (!open_ || peekNext_ == 0) return;
+    readOff_ = peekNext_;
+    peekNext_ = 0;
+    saveCursor();
+    if (readSeg_ != writeSeg_ && readOff_ >= readSegSize_) {
+        removeOldestSegment();
+    }
+}
+
+bool UploadSpool::emptyLocked() const {
+    if (!open_ || segments_.empty()) return true;
+    if (segments_.size() > 1) return false;
+    // Only the write segment is left.
+    if (readSeg_ == writeSeg_) return readOff_ >= writeOff_;
+    return writeOff_ <= kSegHeaderSize;
+}
+
+bool UploadSpool::empty() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return emptyLocked();
+}
+
+size_t UploadSpool::sizeBytes() const {
+    return totalBytes_.load(std::memory_order_relaxed);
+}
+
+void UploadSpool::sync() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    syncLocked();
+}
+
+void UploadSpool::syncLocked() {
+    if (writeFd_ >= 0 && unsyncedBytes_ > 0) {
+        if (!writeIo_.sync()) {
+            LOGE("UploadSpool: sync of segment %u failed", writeSeg_);
+        }
+    }
+    unsyncedBytes_ = 0;
+    lastSync_ = std::chrono::steady_clock::now();
+}
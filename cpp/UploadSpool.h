@@ -0,0 +1,105 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <atomic>
+#include <cstdint>
+#include <sys/types.h>
+
+#include "AsyncFile.h"
+
+// Append-only disk spool for encoded JSON chunks that could not be uploaded right away
+// (network down or upload queue over its limit). It lives in a directory next to initialConfig.json
+// and survives app restarts, so the next session can still send what the previous one recorded offline.
+//
+// Layout: numbered segment files (seg_00000001.spool, seg_00000002.spool, ...). Each segment starts with
+// an 8 byte header ("TSPL" + version) followed by records:
+//   u32 length | u32 crc32(payload) | payload bytes
+// Records are always consumed in order (oldest segment first). A small "cursor" file remembers how far
+// the oldest segment was already uploaded, so after a restart we only resend at most one record.
+class UploadSpool {
+public:
+    UploadSpool() = default;
+    // Closes the spool (syncing pending writes) if it is still open.
+    ~UploadSpool();
+
+    // Write backend of the segments ("threads", "uring" or "sync", see AsyncIo.h). Call before open().
+    void setIoBackend(const std::string& kind);
+
+    // Opens (or creates) the spool in dir. Existing segments from previous runs are kept for draining.
+    // - maxBytes: disk budget, when exceeded the oldest segment is deleted to make room.
+    // Returns false if the directory cannot be created or read (spool stays disabled).
+    bool open(const std::string& dir, size_t maxBytes);
+
+    // Syncs pending writes and closes every file descriptor. Safe to call more than once.
+    void close();
+
+    bool isOpen() const;
+
+    // Appends one record to the current segment. The write is started in the background (AsyncFile) and made
+    // durable with fdatasync in batches (by size or time), so a single append never waits for the disk.
+    bool append(const std::string& payload);
+
+    // Copies the oldest record into out without removing it. Returns false if the spool is empty.
+    bool peek(std::string& out);
+
+    // Removes the record returned by the last peek() (call it once the record was uploaded).
+    void pop();
+
+    // True if there is nothing left to drain.
+    bool empty() const;
+
+    // Bytes currently stored on disk (all segments, including already consumed records of the oldest one).
+    // Lock free, callable from any thread.
+    size_t sizeBytes() const;
+
+    // Forces a fdatasync of the records appended since the last sync.
+    void sync();
+
+private:
+    mutable std::mutex mtx_;
+    std::string dir_;
+    size_t maxBytes_ = 0;
+    bool open_ = false;
+
+    // Segment ids currently on disk, oldest first. The last one is the write segment.
+    std::deque<uint32_t> segments_;
+    // Size in bytes of all segments on disk (atomic so sizeBytes() does not wait for a sync in progress).
+    std::atomic<size_t> totalBytes_{0};
+    // Size of the oldest segment when it is not the write segment (avoids a fstat per peek).
+    off_t readSegSize_ = 0;
+
+    // --- Write side ---
+    int writeFd_ = -1;
+    uint32_t writeSeg_ = 0;
+    off_t writeOff_ = 0;
+    size_t unsyncedBytes_ = 0;
+    std::chrono::steady_clock::time_point lastSync_;
+    // Reused buffer holding record header + payload so each append is a single write.
+    std::vector<char> scratch_;
+    // Background writes to writeFd_. Records are submitted one by one (no coalescing across appends), so an
+    // app crash only loses the writes still in flight, like before.
+    AsyncFile writeIo_{64 * 1024, 4};
+
+    // --- Read side (always the oldest segment) ---
+    int readFd_ = -1;
+    uint32_t readSeg_ = 0;
+    off_t readOff_ = 0;
+    // Offset of the record after the one returned by peek(), 0 if nothing was peeked.
+    off_t peekNext_ = 0;
+    int cursorFd_ = -1;
+
+    std::string segmentPath(uint32_t id) const;
+    // Creates a new empty segment and makes it the write segment.
+    bool startSegment(uint32_t id);
+    // Opens the oldest segment for reading (no-op if already open).
+    bool openReadSegment();
+    // Drops the oldest segment from disk and moves the read side to the next one.
+    void removeOldestSegment();
+    // Stores readSeg_/readOff_ in the cursor file.
+    void saveCursor();
+    void syncLocked();
+    bool emptyLocked() const;
+};
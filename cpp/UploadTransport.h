@@ -0,0 +1,37 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <functional>
+#include "TiposTelemetria.h"
+
+// HTTP headers as key-value pairs, in the order they are sent.
+using HttpHeaders = std::vector<std::pair<std::string, std::string>>;
+
+// Interface of the component that actually sends the HTTP POST for AndroidUploader.
+// AndroidUploader builds the body and the headers; the transport only moves bytes and reports an UploadResult.
+// Implementations:
+//   - JniHttpTransport:    AyudanteHttp (HttpURLConnection) through JNI, needed for HTTPS backends like Supabase.
+//   - SocketHttpTransport: native HTTP/1.1 keep-alive over TCP or a unix socket, for local plain-HTTP collectors.
+class UploadTransport {
+public:
+    // Completion callback of postAsync (runs on a transport thread).
+    using Callback = std::function<void(const UploadResult& result)>;
+
+    virtual ~UploadTransport() = default;
+
+    // Prepares the transport for the endpoint in cfg. Returns false if it cannot be used.
+    virtual bool initialize(const UploaderConfig& cfg) = 0;
+
+    // Releases resources. Requests still pending are dropped and their callbacks are not called.
+    virtual void shutdown() = 0;
+
+    // Blocking POST of body to the configured endpoint. Returns false if no HTTP response was received
+    // (result.httpStatus stays -1); a response with an error status still returns true.
+    virtual bool post(const std::string& body, const HttpHeaders& headers, UploadResult& result) = 0;
+
+    // Starts a POST and returns right away. Returns false if it could not be started (done is never called).
+    virtual bool postAsync(const std::string& body, const HttpHeaders& headers, Callback done) = 0;
+
+    // True if postAsync can be used.
+    virtual bool supportsAsync() const = 0;
+};
@@ -0,0 +1,149 @@
+#include "UringAsyncIo.h"
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "TelemetriaLog.h"
+
+static int uringSetup(unsigned entries, io_uring_params* p) {
+    return (int)::syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int uringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return (int)::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0);
+}
+
+UringAsyncIo::~UringAsyncIo() {
+    teardown();
+}
+
+void UringAsyncIo::teardown() {
+    if (sqesMap_) ::munmap(sqesMap_, sqesMapSize_);
+    if (cqMap_ && cqMap_ != sqMap_) ::munmap(cqMap_, cqMapSize_);
+    if (sqMap_) ::munmap(sqMap_, sqMapSize_);
+    if (ringFd_ >= 0) ::close(ringFd_);
+    sqesMap_ = cqMap_ = sqMap_ = nullptr;
+    ringFd_ = -1;
+}
+
+bool UringAsyncIo::setup(unsigned depth) {
+    io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    ringFd_ = uringSetup(depth, &p);
+    if (ringFd_ < 0) {
+        LOGI("UringAsyncIo: io_uring_setup not available: %s", strerror(errno));
+        ringFd_ = -1;
+        return false;
+    }
+    // IORING_OP_WRITE and this feature bit both came with 5.6
+    if (!(p.features & IORING_FEAT_RW_CUR_POS)) {
+        LOGI("UringAsyncIo: kernel too old for IORING_OP_WRITE");
+        teardown();
+        return false;
+    }
+
+    sqMapSize_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cqMapSize_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    const bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single && cqMapSize_ > sqMapSize_) sqMapSize_ = cqMapSize_;
+
+    sqMap_ = ::mmap(nullptr, sqMapSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    ringFd_, IORING_OFF_SQ_RING);
+    if (sqMap_ == MAP_FAILED) {
+        sqMap_ = nullptr;
+        LOGE("UringAsyncIo: mmap of the SQ ring failed: %s", strerror(errno));
+        teardown();
+        return false;
+    }
+    if (single) {
+        cqMap_ = sqMap_;
+    } else {
+        cqMap_ = ::mmap(nullptr, cqMapSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ringFd_, IORING_OFF_CQ_RING);
+        if (cqMap_ == MAP_FAILED) {
+            cqMap_ = nullptr;
+            LOGE("UringAsyncIo: mmap of the CQ ring failed: %s", strerror(errno));
+            teardown();
+            return false;
+        }
+    }
+    sqesMapSize_ = p.sq_entries * sizeof(io_uring_sqe);
+    sqesMap_ = ::mmap(nullptr, sqesMapSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ringFd_, IORING_OFF_SQES);
+    if (sqesMap_ == MAP_FAILED) {
+        sqesMap_ = nullptr;
+        LOGE("UringAsyncIo: mmap of the SQEs failed: %s", strerror(errno));
+        teardown();
+        return false;
+    }
+
+    char* sq = (char*)sqMap_;
+    sqHead_ = (unsigned*)(sq + p.sq_off.head);
+    sqTail_ = (unsigned*)(sq + p.sq_off.tail);
+    sqMask_ = *(unsigned*)(sq + p.sq_off.ring_mask);
+    sqEntries_ = p.sq_entries;
+    sqArray_ = (unsigned*)(sq + p.sq_off.array);
+    sqes_ = (io_uring_sqe*)sqesMap_;
+    char* cq = (char*)cqMap_;
+    cqHead_ = (unsigned*)(cq + p.cq_off.head);
+    cqTail_ = (unsigned*)(cq + p.cq_off.tail);
+    cqMask_ = *(unsigned*)(cq + p.cq_off.ring_mask);
+    cqes_ = (io_uring_cqe*)(cq + p.cq_off.cqes);
+    return true;
+}
+
+bool UringAsyncIo::submit(int fd, const char* data, size_t len, off_t off, uint32_t tag) {
+    const unsigned tail = *sqTail_;
+    if (tail - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_) return false;
+
+    const unsigned index = tail & sqMask_;
+    io_uring_sqe* sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)data;
+    sqe->len = (uint32_t)len;
+    sqe->off = (uint64_t)off;
+    sqe->user_data = tag;
+    sqArray_[index] = index;
+    __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+
+    int n;
+    do {
+        n = uringEnter(ringFd_, 1, 0, 0);
+    } while (n < 0 && errno == EINTR);
+    if (n == 1) return true;
+
+    // Not consumed by the kernel (an error, or 0 submitted): take it back so the caller can write the buffer
+    // itself without the entry being picked up by a later io_uring_enter
+    if (n < 0) {
+        LOGE("UringAsyncIo: io_uring_enter failed: %s", strerror(errno));
+    } else {
+        LOGE("UringAsyncIo: io_uring_enter submitted %d of 1 writes", n);
+    }
+    __atomic_store_n(sqTail_, tail, __ATOMIC_RELEASE);
+    return false;
+}
+
+void UringAsyncIo::waitOne(uint32_t& tag, ssize_t& result) {
+    for (;;) {
+        const unsigned head = *cqHead_;
+        if (head != __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE)) {
+            const io_uring_cqe* cqe = &cqes_[head & cqMask_];
+            tag = (uint32_t)cqe->user_data;
+            result = cqe->res;
+            __atomic_store_n(cqHead_, head + 1, __ATOMIC_RELEASE);
+            return;
+        }
+        if (uringEnter(ringFd_, 0, 1, IORING_ENTER_GETEVENTS) < 0
+                && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            LOGE("UringAsyncIo: waiting for completions failed: %s", strerror(errno));
+            tag = kAsyncIoBroken;
+            result = -errno;
+            return;
+        }
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "AsyncIo.h"
+
+// AsyncIo on io_uring, set up with raw syscalls (no liburing in the NDK). Writes are queued on the
+// submission ring and handed to the kernel with one io_uring_enter; completions are read from the
+// completion ring, so no extra threads are needed.
+//
+// Needs Linux 5.6 (IORING_OP_WRITE). The default seccomp filter of Android apps does not allow the
+// io_uring syscalls on most releases, so this backend is opt-in (ioBackend "uring") and createAsyncIo
+// falls back to ThreadPoolAsyncIo when setup() fails.
+class UringAsyncIo : public AsyncIo {
+public:
+    UringAsyncIo() = default;
+    ~UringAsyncIo() override;
+
+    UringAsyncIo(const UringAsyncIo&) = delete;
+    UringAsyncIo& operator=(const UringAsyncIo&) = delete;
+
+    // Creates the rings with room for depth writes. Returns false if io_uring is not usable here.
+    bool setup(unsigned depth);
+
+    const char* name() const override { return "uring"; }
+    bool submit(int fd, const char* data, size_t len, off_t off, uint32_t tag) override;
+    void waitOne(uint32_t& tag, ssize_t& result) override;
+
+private:
+    int ringFd_ = -1;
+
+    void* sqMap_ = nullptr;
+    size_t sqMapSize_ = 0;
+    void* cqMap_ = nullptr; // same as sqMap_ with IORING_FEAT_SINGLE_MMAP
+    size_t cqMapSize_ = 0;
+    void* sqesMap_ = nullptr;
+    size_t sqesMapSize_ = 0;
+
+    // Pointers into the mapped rings
+    unsigned* sqHead_ = nullptr;
+    unsigned* sqTail_ = nullptr;
+    unsigned sqMask_ = 0;
+    unsigned sqEntries_ = 0;
+    unsigned* sqArray_ = nullptr;
+    struct io_uring_sqe* sqes_ = nullptr;
+    unsigned* cqHead_ = nullptr;
+    unsigned* cqTail_ = nullptr;
+    unsigned cqMask_ = 0;
+    struct io_uring_cqe* cqes_ = nullptr;
+
+    void teardown();
+};
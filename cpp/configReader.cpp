@@ -1,22 +1,39 @@
 #include "configReader.h"
-#include <android/log.h>
 #include <fstream>
 #include <sstream>
 #include <vector>
 #include <cstdio>
+#include <cstdlib>
 #include <cerrno>
 #include <cstring>
+#include <algorithm>
+#include <sys/stat.h>
 
-#define LOG_TAG "telemetria"
-#define LOGI(...) __android_log_print(ANDROID_LOG_INFO,  LOG_TAG, __VA_ARGS__)
-#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#include "TelemetriaLog.h"
 
 // Default config in case JSON file is missing or they are not defined
 static constexpr const char* kDefaultEndpoint = "http://localhost:1414";
 static constexpr const char* kDefaultApiKey = "non_existant";
 static constexpr int kDefaultFramesPerFile = 200;
 static constexpr int kDefaultFrameRate = 60;
+static constexpr int kDefaultSpoolMaxMB = 256;
+static constexpr int kDefaultCoalesceWindowMs = 250;
+static constexpr int kDefaultMaxRequestKB = 1024;
+static constexpr const char* kDefaultTransport = "auto";
+static constexpr const char* kDefaultIoBackend = "threads";
+static constexpr int kDefaultC3DPartFrames = 65535;
+static constexpr int kDefaultC3DPartSeconds = 600;
+static constexpr int kDefaultC3DCheckpointSeconds = 5;
+static constexpr int kDefaultC3DConvertThreads = 0; // automatic
+static constexpr int kMaxC3DConvertThreads = 16;
+static constexpr const char* kDefaultC3DFormat = "float";
+static constexpr const char* kDefaultLogLevel = "info";
+static constexpr int kDefaultLogRateLimit = 20;
 
+// Overrides the files dir on every platform (host runs, tests, adb shell tools without a package name).
+static constexpr const char* kFilesDirEnv = "TELEMETRIA_FILES_DIR";
+
+#ifdef __ANDROID__
 // The package name is obtained from /proc/self/cmdline. On Android, the process name
 // is usually the same as the app package name.
 static bool getPackageNameFromProc(std::string& outPkg) {
@@ -34,6 +51,20 @@ static bool getPackageNameFromProc(std::string& outPkg) {
     outPkg = buf;
     return !outPkg.empty();
 }
+#else
+// mkdir -p, for the default files dir (~/.local/share may not exist yet).
+static bool makeDirs(const std::string& dir) {
+    for (size_t pos = 1; pos <= dir.size(); ++pos) {
+        if (pos != dir.size() && dir[pos] != '/') continue;
+        const std::string part = dir.substr(0, pos);
+        if (::mkdir(part.c_str(), 0700) != 0 && errno != EEXIST) {
+            LOGE("configReader: cannot create '%s': %s", part.c_str(), strerror(errno));
+            return false;
+        }
+    }
+    return true;
+}
+#endif
 
 // Helpers for tiny JSON parsing. We do not use a full JSON library
 // because initialConfig.json has a simple, predictable structure so we keep it simple (and smaller future aar).
@@ -45,7 +76,7 @@ namespace {
         if (p == std::string::npos) return false;
 
         p = text.find(':', p + q.size());
-        if (p == std::string::npos) return false
+        if (p == std::string::npos) return false;
 
         // Skip colon and whitespace
         while (p < text.size() && (text[p] == ':' || text[p] == ' ' || text[p] == '\t' || text[p] == '\r' || text[p] == '\n')) ++p;
@@ -116,14 +147,72 @@ namespace {
 
 namespace configReader {
 
-    // Build expected path: /sdcard/Android/data/<package>/files/initialConfig.json
-    bool getExpectedConfigPath(std::string& outPath) {
+    // Files dir: $TELEMETRIA_FILES_DIR if set, otherwise the platform default. On Android
+    // /sdcard/Android/data/<package>/files (package from /proc/self/cmdline); on Linux
+    // $XDG_DATA_HOME/telemetria or ~/.local/share/telemetria, created if missing.
+    bool getFilesDir(std::string& outDir) {
+        const char* env = getenv(kFilesDirEnv);
+        if (env && *env) {
+            outDir = env;
+            while (outDir.size() > 1 && outDir.back() == '/') outDir.pop_back();
+            return true;
+        }
+#ifdef __ANDROID__
         std::string pkg;
         if (!getPackageNameFromProc(pkg)) {
             LOGE("configReader: could not get package from /proc/self/cmdline");
             return false;
         }
-        outPath = std::string("/sdcard/Android/data/") + pkg + "/files/initialConfig.json";
+        outDir = std::string("/sdcard/Android/data/") + pkg + "/files";
+        return true;
+#else
+        const char* xdg = getenv("XDG_DATA_HOME");
+        const char* home = getenv("HOME");
+        if (xdg && *xdg) {
+            outDir = std::string(xdg) + "/telemetria";
+        } else if (home && *home) {
+            outDir = std::string(home) + "/.local/share/telemetria";
+        } else {
+            LOGE("configReader: neither %s, XDG_DATA_HOME nor HOME is set", kFilesDirEnv);
+            return false;
+        }
+        return makeDirs(outDir);
+#endif
+    }
+
+    // Build expected path: <files dir>/initialConfig.json
+    bool getExpectedConfigPath(std::string& outPath) {
+        std::string dir;
+        if (!getFilesDir(dir)) return false;
+        outPath = dir + "/initialConfig.json";
+        return true;
+    }
+
+    bool getInternalFilesDir(std::string& outDir) {
+#ifdef __ANDROID__
+        if (!getenv(kFilesDirEnv)) {
+            std::string pkg;
+            if (!getPackageNameFromProc(pkg)) {
+                LOGE("configReader: could not get package from /proc/self/cmdline");
+                return false;
+            }
+            outDir = std::string("/data/data/") + pkg + "/files";
+            // Android creates it on the first Context.getFilesDir(), which the engine may never call
+            if (::mkdir(outDir.c_str(), 0700) != 0 && errno != EEXIST) {
+                LOGE("configReader: cannot create '%s': %s", outDir.c_str(), strerror(errno));
+                return false;
+            }
+            return true;
+        }
+#endif
+        // No app-private storage (Linux, or a files dir given by the environment): a subdirectory of the files dir
+        std::string dir;
+        if (!getFilesDir(dir)) return false;
+        outDir = dir + "/internal";
+        if (::mkdir(outDir.c_str(), 0700) != 0 && errno != EEXIST) {
+            LOGE("configReader: cannot create '%s': %s", outDir.c_str(), strerror(errno));
+            return false;
+        }
         return true;
     }
 
@@ -167,6 +256,24 @@ namespace configReader {
         outCfg.grip          = false;
         outCfg.trigger       = false;
         outCfg.joystick      = false;
+        outCfg.spoolEnabled  = true;
+        outCfg.spoolMaxMB    = kDefaultSpoolMaxMB;
+        outCfg.coalesceWindowMs = kDefaultCoalesceWindowMs;
+        outCfg.maxRequestKB  = kDefaultMaxRequestKB;
+        outCfg.debugHttp     = false;
+        outCfg.transport     = kDefaultTransport;
+        outCfg.unixSocketPath.clear();
+        outCfg.stageInternal = false;
+        outCfg.ioBackend     = kDefaultIoBackend;
+        outCfg.c3dPartFrames = kDefaultC3DPartFrames;
+        outCfg.c3dPartSeconds = kDefaultC3DPartSeconds;
+        outCfg.c3dCheckpointSeconds = kDefaultC3DCheckpointSeconds;
+        outCfg.c3dConvertThreads = kDefaultC3DConvertThreads;
+        outCfg.c3dFormat     = kDefaultC3DFormat;
+        outCfg.c3dPointResolutionUm = 0;
+        outCfg.trace         = false;
+        outCfg.logLevel      = kDefaultLogLevel;
+        outCfg.logRateLimit  = kDefaultLogRateLimit;
 
         std::string path, text;
         if (!getExpectedConfigPath(path)) {
@@ -212,6 +319,49 @@ namespace configReader {
         if (extractJsonBool(text, "trigger", vb))       outCfg.trigger       = vb;
         if (extractJsonBool(text, "joystick", vb))      outCfg.joystick      = vb;
 
+        // Offline spool options
+        if (extractJsonBool(text, "spoolEnabled", vb))  outCfg.spoolEnabled  = vb;
+        if (extractJsonInt(text, "spoolMaxMB", vi) && vi > 0) outCfg.spoolMaxMB = vi;
+
+        // Request coalescing options (0 disables the coalescing window)
+        if (extractJsonInt(text, "coalesceWindowMs", vi) && vi >= 0) outCfg.coalesceWindowMs = vi;
+        if (extractJsonInt(text, "maxRequestKB", vi) && vi > 0) outCfg.maxRequestKB = vi;
+        if (extractJsonBool(text, "debugHttp", vb))     outCfg.debugHttp     = vb;
+
+        // HTTP transport ("auto", "jni" or "socket"); unknown values keep "auto"
+        if (extractJsonString(text, "transport", tmp)) {
+            if (tmp == "auto" || tmp == "jni" || tmp == "socket") outCfg.transport = tmp;
+            else LOGI("configReader: transport '%s' desconocido; usando '%s'", tmp.c_str(), kDefaultTransport);
+        }
+        if (extractJsonString(text, "unixSocket", tmp)) outCfg.unixSocketPath = tmp;
+
+        if (extractJsonBool(text, "stageInternal", vb)) outCfg.stageInternal = vb;
+        // File write backend ("threads", "uring" or "sync"); unknown values keep "threads"
+        if (extractJsonString(text, "ioBackend", tmp)) {
+            if (tmp == "threads" || tmp == "uring" || tmp == "sync") outCfg.ioBackend = tmp;
+            else LOGI("configReader: ioBackend '%s' desconocido; usando '%s'", tmp.c_str(), kDefaultIoBackend);
+        }
+
+        // C3D part limits (frames capped to the 16-bit C3D header field)
+        if (extractJsonInt(text, "c3dPartFrames", vi) && vi > 0) outCfg.c3dPartFrames = std::min(vi, kDefaultC3DPartFrames);
+        if (extractJsonInt(text, "c3dPartSeconds", vi) && vi >= 0) outCfg.c3dPartSeconds = vi;
+        if (extractJsonInt(text, "c3dCheckpointSeconds", vi) && vi >= 0) outCfg.c3dCheckpointSeconds = vi;
+        if (extractJsonInt(text, "c3dConvertThreads", vi) && vi >= 0) outCfg.c3dConvertThreads = std::min(vi, kMaxC3DConvertThreads);
+        // C3D storage ("float" or "int16"); unknown values keep float
+        if (extractJsonString(text, "c3dFormat", tmp)) {
+            if (tmp == "float" || tmp == "int16") outCfg.c3dFormat = tmp;
+            else LOGI("configReader: c3dFormat '%s' desconocido; usando '%s'", tmp.c_str(), kDefaultC3DFormat);
+        }
+        if (extractJsonInt(text, "c3dPointResolutionUm", vi) && vi >= 0) outCfg.c3dPointResolutionUm = vi;
+        if (extractJsonBool(text, "trace", vb))         outCfg.trace         = vb;
+        // Logging; unknown levels keep "info"
+        if (extractJsonString(text, "logLevel", tmp)) {
+            int level;
+            if (TelemetriaLog::parseLevel(tmp.c_str(), level)) outCfg.logLevel = tmp;
+            else LOGI("configReader: logLevel '%s' desconocido; usando '%s'", tmp.c_str(), kDefaultLogLevel);
+        }
+        if (extractJsonInt(text, "logRateLimit", vi) && vi >= 0) outCfg.logRateLimit = vi;
+
         // Reading was done (even if some keys were missing).
         return true;
     }
@@ -4,6 +4,7 @@
 
 // Reader for the initial configuration stored in:
 //   /sdcard/Android/data/<package>/files/initialConfig.json
+// (see getFilesDir for Linux and the TELEMETRIA_FILES_DIR override)
 //
 // This JSON file typically contains (tag names must be the same):
 //   - "endpoint":     base URL for the REST API
@@ -14,15 +15,47 @@
 //   - "primaryButton":  boolean,
 //   - "secondaryButton": boolean,
 //   - "grip", "trigger", "joystick": booleans,
+//   - "spoolEnabled": boolean (default true), keep failed uploads on disk and retry them later
+//   - "spoolMaxMB":   disk budget for the upload spool in MB (default 256)
+//   - "coalesceWindowMs": time the uploader waits to merge queued chunks into one request (default 250, 0 = off)
+//   - "maxRequestKB": maximum size of a merged request body in KB (default 1024)
+//   - "debugHttp":    boolean (default false), backend echoes inserted rows and a response preview is logged
+//   - "transport":    "auto" (default), "jni" or "socket". auto uses the native socket transport for http://
+//                     endpoints (local collectors, no TLS) and AyudanteHttp through JNI for everything else
+//   - "unixSocket":   path of a unix socket to send to instead of TCP (socket transport, selected by auto)
+//   - "stageInternal": boolean (default false), write C3D parts and the upload spool to internal storage;
+//                     finished C3D parts are moved to the external files dir by a low-priority thread
+//   - "ioBackend":    "threads" (default), "uring" or "sync": how C3D parts and spool segments are written.
+//                     threads = background pwrite, uring = io_uring (Linux 5.6+, usually blocked by the app
+//                     sandbox, falls back to threads), sync = blocking writes on the recording threads
+//   - "c3dPartFrames": frames per C3D part file (default and maximum 65535)
+//   - "c3dPartSeconds": seconds per C3D part file (default 600, 0 = only the frame limit)
+//   - "c3dCheckpointSeconds": interval of the crash checkpoints of the open C3D part (default 5, 0 = off)
+//   - "c3dConvertThreads": threads converting queued C3D blocks (default 0 = automatic, up to 4; 1 = writer thread only)
+//   - "c3dFormat":    "float" (default) or "int16" (half the size; quaternions at 1/32000, RealTime relative to the
+//                     part start with a step of c3dPartSeconds/65534 s, worst error per channel logged per part)
+//   - "c3dPointResolutionUm": int16 point step in micrometers (default 0 = from the range of the first frames)
+//   - "trace":        boolean (default false), record pipeline spans for telemetry_trace_dump (Chrome trace JSON)
+//   - "logLevel":     "debug", "info" (default), "warn", "error" or "off". debug adds one line per upload and batch
+//   - "logRateLimit": messages per second allowed from each log call site (default 20, 0 = no limit)
 
 
 namespace configReader {
-    // Builds the expected path for initialConfig.json based on /proc/self/cmdline.
-    // On Android, the process name matches the package name, so we use:
-    //   /sdcard/Android/data/<package>/files/initialConfig.json
+    // Builds the expected path for initialConfig.json: <files dir>/initialConfig.json.
     // Returns true on success and writes the full path into outPath.
     bool getExpectedConfigPath(std::string& outPath);
 
+    // Directory that contains initialConfig.json. Other per-app files (C3D output, upload spool) are stored there too.
+    //   - $TELEMETRIA_FILES_DIR if set (any platform: host runs, soak tests, tools started from adb shell)
+    //   - Android: /sdcard/Android/data/<package>/files, the process name in /proc/self/cmdline is the package
+    //   - Linux: $XDG_DATA_HOME/telemetria or ~/.local/share/telemetria, created if missing
+    bool getFilesDir(std::string& outDir);
+
+    // App-internal directory (/data/data/<package>/files), created if missing. Much lower write latency than
+    // the external files dir (no FUSE), but only the app itself can read it: used to stage files (stageInternal).
+    // Without app storage (Linux or $TELEMETRIA_FILES_DIR) it is <files dir>/internal.
+    bool getInternalFilesDir(std::string& outDir);
+
     // Reads a file completely into a string (opaque binary or text).
     // Returns true on success.
     bool readFileToString(const std::string& path, std::string& outText);
@@ -0,0 +1,90 @@
+// C3DConverter::convertBlock against c3dConvertFrameReference, bit for bit, with every kernel set the CPU can
+// run. Input from SyntheticMotion: hands and controllers with frequent tracking losses, the same stream without
+// hands (controllers in the FIN slots), and a few frames with devices at the origin (points left missing).
+// Blocks of C3DRecorder::kBlockFrames and uneven sizes, so the chunk and vector tails are covered too.
+
+#include "TestCheck.h"
+
+#include "C3DConvert.h"
+#include "C3DRecorder.h"
+#include "SyntheticMotion.h"
+#include "TelemetriaLog.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+constexpr size_t kPoints = 59;   // C3DRecorder::buildPointNames
+constexpr size_t kAnalogs = 213; // C3DRecorder::buildAnalogNames
+constexpr size_t kStride = kPoints * 4 + kAnalogs;
+
+std::vector<VRFrameDataPlain> makeFrames(bool hands, size_t n) {
+    SyntheticMotion::Options options;
+    options.seed = hands ? 7 : 8;
+    options.dropoutsPerMinute = 60.0;
+    options.hands = hands;
+    SyntheticMotion motion(options);
+    std::vector<VRFrameDataPlain> frames;
+    motion.generate(frames, n);
+    // Devices reported at the origin: no point is written for them
+    for (size_t i = 5; i < n; i += 41) {
+        VRFrameDataPlain& f = frames[i];
+        std::memset(f.leftCtrl.pose.position, 0, sizeof(f.leftCtrl.pose.position));
+        if (f.rightHandJointCount > 0) {
+            f.rightHandJoints[0].px = f.rightHandJoints[0].py = f.rightHandJoints[0].pz = 0.0f;
+            f.rightHandJoints[9].px = f.rightHandJoints[9].py = f.rightHandJoints[9].pz = 0.0f;
+        }
+    }
+    return frames;
+}
+
+// Converts frames in blocks of blockFrames and returns the number of records that differ from the reference.
+size_t countMismatches(const std::vector<VRFrameDataPlain>& frames, size_t blockFrames) {
+    C3DConverter converter;
+    std::vector<float> records(blockFrames * kStride);
+    std::vector<float> expected(kStride);
+    size_t mismatches = 0;
+    for (size_t off = 0; off < frames.size(); off += blockFrames) {
+        const size_t n = std::min(blockFrames, frames.size() - off);
+        converter.convertBlock(&frames[off], n, records.data(), kPoints, kAnalogs);
+        for (size_t i = 0; i < n; ++i) {
+            c3dConvertFrameReference(frames[off + i], expected.data(), kPoints, kAnalogs);
+            const float* rec = &records[i * kStride];
+            if (std::memcmp(rec, expected.data(), kStride * sizeof(float)) == 0) continue;
+            if (mismatches++ < 3) {
+                size_t v = 0;
+                while (std::memcmp(&rec[v], &expected[v], sizeof(float)) == 0) ++v;
+                std::fprintf(stderr, "%s: frame %zu value %zu is %.9g, reference %.9g\n", C3DConverter::kernelName(),
+                             off + i, v, rec[v], expected[v]);
+            }
+        }
+    }
+    return mismatches;
+}
+
+} // namespace
+
+int main() {
+    TelemetriaLog::setLevel(kLogWarn);
+    const std::vector<VRFrameDataPlain> withHands = makeFrames(true, 4000);
+    const std::vector<VRFrameDataPlain> controllersOnly = makeFrames(false, 1000);
+
+    const std::vector<const char*> kernels = C3DConverter::kernelNames();
+    CHECK(!kernels.empty());
+    for (const char* name : kernels) {
+        CHECK(C3DConverter::forceKernels(name));
+        CHECK(std::strcmp(C3DConverter::kernelName(), name) == 0);
+        for (size_t block : {C3DRecorder::kBlockFrames, (size_t)37, (size_t)1}) {
+            CHECK_EQ(countMismatches(withHands, block), 0);
+        }
+        CHECK_EQ(countMismatches(controllersOnly, C3DRecorder::kBlockFrames), 0);
+    }
+    CHECK(!C3DConverter::forceKernels("none"));
+    CHECK(C3DConverter::forceKernels(nullptr));
+    CHECK(std::strcmp(C3DConverter::kernelName(), kernels.front()) == 0);
+
+    TelemetriaLog::flush();
+    return testResult();
+}
@@ -0,0 +1,193 @@
+// Files written by C3DWriter, read back with ezc3d (the reference reader, only used here): float and int16 parts
+// must decode to the records that were appended. Checked: point / analog counts and labels, rate, frame count,
+// missing markers, and every coordinate and analog value of every frame (int16 within half a quantization step,
+// with fixed scales and with the scales C3DWriter picks from the first frames).
+
+#include "TestCheck.h"
+
+#include "C3DWriter.h"
+#include "TelemetriaLog.h"
+
+#include <ezc3d/ezc3d.h>
+#include <ezc3d/Header.h>
+#include <ezc3d/Data.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t kPoints = 12;
+constexpr size_t kAnalogs = 9;
+constexpr size_t kStride = kPoints * 4 + kAnalogs;
+constexpr size_t kFrames = 1000;
+constexpr size_t kFirstAppend = 256; // the int16 scales left at 0 are chosen from these frames
+constexpr float kRate = 90.0f;
+
+C3DWriter::Layout makeLayout() {
+    C3DWriter::Layout layout;
+    char name[16];
+    for (size_t i = 0; i < kPoints; ++i) {
+        std::snprintf(name, sizeof(name), "P%02zu", i);
+        layout.pointNames.emplace_back(name);
+    }
+    for (size_t i = 0; i < kAnalogs; ++i) {
+        std::snprintf(name, sizeof(name), "A%02zu", i);
+        layout.analogNames.emplace_back(name);
+        layout.analogUnits.emplace_back(i == kAnalogs - 1 ? "s" : "");
+    }
+    layout.frameRate = kRate;
+    return layout;
+}
+
+// Points moving around a room (mm, period of 100 frames so the first append covers the whole range), one of
+// them missing now and then; analogs as the recorder stores them: unit quaternions, triggers 0..1 and the
+// time of the frame.
+std::vector<float> makeRecords() {
+    std::vector<float> records(kFrames * kStride);
+    for (size_t f = 0; f < kFrames; ++f) {
+        float* rec = &records[f * kStride];
+        const double t = f / (double)kRate;
+        for (size_t p = 0; p < kPoints; ++p) {
+            float* r = rec + p * 4;
+            const bool missing = p == 3 && (f / 50) % 4 == 1;
+            const double phase = 2.0 * M_PI * (double)f / 100.0 + p;
+            r[0] = missing ? 0.0f : (float)(1500.0 * std::sin(phase) + 10.0 * p);
+            r[1] = missing ? 0.0f : (float)(900.0 + 700.0 * std::cos(phase * 0.5));
+            r[2] = missing ? 0.0f : (float)(-2000.0 * std::sin(phase + 1.0));
+            r[3] = missing ? -1.0f : 0.0f;
+        }
+        float* a = rec + kPoints * 4;
+        for (size_t q = 0; q < 2; ++q) {
+            const double angle = 2.0 * M_PI * (double)f / 100.0 + q;
+            a[q * 4 + 0] = (float)std::cos(angle * 0.5);
+            a[q * 4 + 1] = (float)(std::sin(angle * 0.5) * 0.6);
+            a[q * 4 + 2] = (float)(std::sin(angle * 0.5) * 0.8);
+            a[q * 4 + 3] = 0.0f;
+        }
+        a[kAnalogs - 1] = (float)t;
+    }
+    // Triggers instead of the last quaternion component
+    for (size_t f = 0; f < kFrames; ++f) records[f * kStride + kPoints * 4 + 7] = (float)((f % 100) / 99.0);
+    return records;
+}
+
+// ezc3d pads labels with spaces, compare without them.
+std::string trimRight(std::string s) {
+    while (!s.empty() && s.back() == ' ') s.pop_back();
+    return s;
+}
+
+// step: quantization step of the value in int16 files, 0 for float files. Plus float rounding (the writer
+// quantizes in float, ezc3d decodes in double).
+bool sameValue(double decoded, float written, float step) {
+    const double tolerance = 0.5 * step + 1e-6 * std::max(1.0, std::fabs((double)written));
+    return std::fabs(decoded - (double)written) <= tolerance;
+}
+
+// Writes the records to path with integer (int16 format, scales as given) and reads them back with ezc3d.
+void roundTrip(const std::string& path, const C3DWriter::IntegerFormat& integer) {
+    const std::vector<float> records = makeRecords();
+    C3DWriter::Layout layout = makeLayout();
+    layout.integer = integer;
+
+    C3DWriter writer;
+    CHECK(writer.open(path, layout, kFrames));
+    CHECK(writer.appendFrames(records.data(), kFirstAppend));
+    // The rest in uneven appends, as the recorder blocks and the final flush do
+    for (size_t f = kFirstAppend; f < kFrames;) {
+        const size_t n = std::min<size_t>(kFrames - f, 97);
+        CHECK(writer.appendFrames(&records[f * kStride], n));
+        f += n;
+    }
+    const C3DWriter::IntegerFormat used = writer.integerFormat();
+    CHECK(writer.finalize());
+
+    ezc3d::c3d c3d(path);
+    CHECK_EQ(c3d.header().nb3dPoints(), kPoints);
+    CHECK_EQ(c3d.header().nbAnalogs(), kAnalogs);
+    CHECK_EQ(c3d.data().nbFrames(), kFrames);
+    CHECK(std::fabs(c3d.header().frameRate() - kRate) < 1e-3);
+    const auto& pointNames = c3d.pointNames();
+    CHECK_EQ(pointNames.size(), kPoints);
+    for (size_t i = 0; i < kPoints && i < pointNames.size(); ++i) {
+        CHECK(trimRight(pointNames[i]) == layout.pointNames[i]);
+    }
+    const auto& channelNames = c3d.channelNames();
+    CHECK_EQ(channelNames.size(), kAnalogs);
+    for (size_t i = 0; i < kAnalogs && i < channelNames.size(); ++i) {
+        CHECK(trimRight(channelNames[i]) == layout.analogNames[i]);
+    }
+    if (c3d.data().nbFrames() != kFrames || pointNames.size() != kPoints || channelNames.size() != kAnalogs) return;
+
+    const float pointStep = used.enabled ? used.pointScale : 0.0f;
+    int pointErrors = 0, missingErrors = 0, analogErrors = 0;
+    for (size_t f = 0; f < kFrames; ++f) {
+        const float* rec = &records[f * kStride];
+        const auto& frame = c3d.data().frame(f);
+        for (size_t p = 0; p < kPoints; ++p) {
+            const float* r = rec + p * 4;
+            const auto& pt = frame.points().point(p);
+            if (r[3] < 0.0f) {
+                if (!(pt.residual() < 0.0)) ++missingErrors;
+                continue;
+            }
+            if (!sameValue(pt.x(), r[0], pointStep) || !sameValue(pt.y(), r[1], pointStep) ||
+                !sameValue(pt.z(), r[2], pointStep)) {
+                if (pointErrors++ < 5) {
+                    std::fprintf(stderr, "%s: frame %zu point %zu is (%f %f %f), written (%f %f %f)\n", path.c_str(),
+                                 f, p, pt.x(), pt.y(), pt.z(), r[0], r[1], r[2]);
+                }
+            }
+        }
+        const auto& sub = frame.analogs().subframe(0);
+        for (size_t a = 0; a < kAnalogs; ++a) {
+            const float written = rec[kPoints * 4 + a];
+            const float step = used.enabled ? used.analogScales[a] : 0.0f;
+            if (!sameValue(sub.channel(a).data(), written, step) && analogErrors++ < 5) {
+                std::fprintf(stderr, "%s: frame %zu channel %zu is %f, written %f\n", path.c_str(), f, a,
+                             sub.channel(a).data(), written);
+            }
+        }
+    }
+    CHECK_EQ(pointErrors, 0);
+    CHECK_EQ(missingErrors, 0);
+    CHECK_EQ(analogErrors, 0);
+}
+
+} // namespace
+
+int main() {
+    TelemetriaLog::setLevel(kLogWarn);
+    const testcheck::TempDir tempDir("c3d_roundtrip");
+    const std::string& dir = tempDir.path();
+
+    C3DWriter::IntegerFormat floatFormat;
+    roundTrip(dir + "/float.c3d", floatFormat);
+
+    // int16 with the scales of C3DRecorder: 0.1 mm points, quaternions at 1/32000
+    C3DWriter::IntegerFormat fixed;
+    fixed.enabled = true;
+    fixed.pointScale = 0.1f;
+    fixed.analogScales.assign(kAnalogs, 1.0f / 32000.0f);
+    fixed.analogOffsets.assign(kAnalogs, 0);
+    fixed.analogScales[kAnalogs - 1] = (kFrames / kRate) / 65534.0f;
+    fixed.analogOffsets[kAnalogs - 1] = -32767;
+    roundTrip(dir + "/int16_fixed.c3d", fixed);
+
+    // int16 with the scales chosen by C3DWriter from the first append; the time keeps growing after it, so it
+    // gets its scale here as the recorder does
+    C3DWriter::IntegerFormat automatic;
+    automatic.enabled = true;
+    automatic.analogScales.assign(kAnalogs, 0.0f);
+    automatic.analogOffsets.assign(kAnalogs, 0);
+    automatic.analogScales[kAnalogs - 1] = fixed.analogScales[kAnalogs - 1];
+    automatic.analogOffsets[kAnalogs - 1] = fixed.analogOffsets[kAnalogs - 1];
+    roundTrip(dir + "/int16_auto.c3d", automatic);
+
+    TelemetriaLog::flush();
+    return testResult();
+}
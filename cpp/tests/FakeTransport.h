@@ -0,0 +1,145 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "UploadTransport.h"
+
+// In-memory UploadTransport for the host tests: no sockets, no JVM. Asynchronous requests are completed from
+// the fake's own thread (like the HTTP threads of the real transports) with the current status, or kept
+// pending while hold is set so a test can look at the in-flight state and complete them one by one.
+// Blocking posts (spool drainer) are answered right away with the current status.
+// Only requests answered with a 2xx status count as delivered.
+class FakeTransport : public UploadTransport {
+public:
+    FakeTransport() : completer_(&FakeTransport::completerLoop, this) {}
+
+    ~FakeTransport() override {
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        completer_.join();
+    }
+
+    bool initialize(const UploaderConfig&) override { return true; }
+
+    // Pending requests are dropped and their callbacks are not called, as the interface says.
+    void shutdown() override {
+        std::lock_guard<std::mutex> lk(mtx_);
+        pending_.clear();
+    }
+
+    bool post(const std::string& body, const HttpHeaders&, UploadResult& result) override {
+        std::lock_guard<std::mutex> lk(mtx_);
+        ++posts_;
+        result = answerLocked(body, status_);
+        return true;
+    }
+
+    bool postAsync(const std::string& body, const HttpHeaders&, Callback done) override {
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            ++asyncPosts_;
+            pending_.emplace_back(body, std::move(done));
+            if (pending_.size() > maxPending_) maxPending_ = pending_.size();
+        }
+        cv_.notify_all();
+        return true;
+    }
+
+    bool supportsAsync() const override { return true; }
+
+    // Status of the following answers (async ones still pending included).
+    void setStatus(int status) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        status_ = status;
+    }
+    // While set, asynchronous requests stay pending until completeOne() or until hold is cleared.
+    void setHold(bool hold) {
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            hold_ = hold;
+        }
+        cv_.notify_all();
+    }
+    // Completes the oldest pending asynchronous request with the current status. False if there is none.
+    bool completeOne() {
+        std::pair<std::string, Callback> req;
+        UploadResult result;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            if (pending_.empty()) return false;
+            req = std::move(pending_.front());
+            pending_.pop_front();
+            result = answerLocked(req.first, status_);
+        }
+        req.second(result);
+        return true;
+    }
+
+    size_t pending() const {
+        std::lock_guard<std::mutex> lk(mtx_);
+        return pending_.size();
+    }
+    size_t maxPending() const {
+        std::lock_guard<std::mutex> lk(mtx_);
+        return maxPending_;
+    }
+    unsigned long long posts() const {
+        std::lock_guard<std::mutex> lk(mtx_);
+        return posts_;
+    }
+    unsigned long long asyncPosts() const {
+        std::lock_guard<std::mutex> lk(mtx_);
+        return asyncPosts_;
+    }
+    unsigned long long framesDelivered() const {
+        std::lock_guard<std::mutex> lk(mtx_);
+        return framesDelivered_;
+    }
+
+private:
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<std::pair<std::string, Callback>> pending_;
+    size_t maxPending_ = 0;
+    int status_ = 201;
+    bool hold_ = false;
+    bool stop_ = false;
+    unsigned long long posts_ = 0;
+    unsigned long long asyncPosts_ = 0;
+    unsigned long long framesDelivered_ = 0;
+    std::thread completer_;
+
+    UploadResult answerLocked(const std::string& body, int status) {
+        UploadResult result;
+        result.httpStatus = status;
+        result.bytesSent = (long long)body.size();
+        if (result.ok()) framesDelivered_ += countFrames(body);
+        return result;
+    }
+
+    // Rows of a toJsonFlat array: every frame object starts with its session id.
+    static unsigned long long countFrames(const std::string& body) {
+        static const char kRow[] = "{\"session_id\"";
+        unsigned long long n = 0;
+        for (size_t pos = body.find(kRow); pos != std::string::npos; pos = body.find(kRow, pos + 1)) ++n;
+        return n;
+    }
+
+    void completerLoop() {
+        std::unique_lock<std::mutex> lk(mtx_);
+        for (;;) {
+            cv_.wait(lk, [&] { return stop_ || (!hold_ && !pending_.empty()); });
+            if (stop_) return;
+            lk.unlock();
+            completeOne();
+            lk.lock();
+        }
+    }
+};
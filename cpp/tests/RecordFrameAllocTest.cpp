@@ -0,0 +1,84 @@
+// telemetry_record_frame must not allocate once the pipeline is warm (AllocStats.h). The whole public path, built
+// with TELEMETRIA_ALLOC_STATS: initialize -> 32 C3D blocks of SyntheticMotion frames, paced so the writer and the
+// uploads keep up as on the headset -> shutdown, uploading to a SoakCollector without faults.
+// Every call after the warm-up is checked; one that allocates fails the test.
+
+#include "TestCheck.h"
+
+#include "SoakCollector.h"
+#include "SyntheticMotion.h"
+#include "TelemetriaAPI.h"
+#include "C3DRecorder.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+namespace {
+
+constexpr unsigned long long kFrames = 32 * C3DRecorder::kBlockFrames;
+constexpr int kFramesPerMs = 2; // 2 kHz, 4 s of recording
+
+// Time runs about 8 times faster than on a 240 Hz headset, so the coalescing window is 8 times shorter too:
+// with the default 250 ms the worker would hold more sealed chunks than recordFrame keeps spare buffers for.
+bool writeConfig(const std::string& dir, int port) {
+    const std::string path = dir + "/initialConfig.json";
+    FILE* f = std::fopen(path.c_str(), "w");
+    if (!f) return false;
+    std::fprintf(f, "{\"endpoint\":\"http://127.0.0.1:%d\",\"apiKey\":\"test\",\"transport\":\"socket\","
+                    "\"frameRate\":240,\"coalesceWindowMs\":30,\"logLevel\":\"warn\"}\n", port);
+    return std::fclose(f) == 0;
+}
+
+} // namespace
+
+int main() {
+    SoakCollector collector;
+    CHECK(collector.start(SoakCollector::Faults(), 1));
+    const testcheck::TempDir tempDir("record_frame_alloc");
+    const std::string& dir = tempDir.path();
+    setenv("TELEMETRIA_FILES_DIR", dir.c_str(), 1);
+    CHECK(writeConfig(dir, collector.port()));
+
+    TelemetryConfigPlain cfg = {"alloc-test", "host"};
+    const int rate = telemetry_initialize(&cfg);
+    CHECK(rate > 0);
+    if (rate <= 0) return testResult();
+
+    SyntheticMotion::Options options;
+    options.rateHz = rate;
+    SyntheticMotion motion(options);
+    VRFrameDataPlain frame;
+    auto deadline = std::chrono::steady_clock::now();
+    for (unsigned long long i = 0; i < kFrames; ++i) {
+        motion.next(frame);
+        telemetry_record_frame(&frame);
+        if ((i + 1) % kFramesPerMs == 0) {
+            deadline += std::chrono::milliseconds(1);
+            std::this_thread::sleep_until(deadline);
+        }
+    }
+
+    TelemetryAllocStatsPlain alloc;
+    telemetry_get_alloc_stats(&alloc);
+    CHECK_EQ(alloc.enabled, 1);
+    // The warm-up is a few JSON chunks and C3D blocks, most of the calls are checked
+    CHECK(alloc.recordFrameChecked >= kFrames / 2);
+    CHECK_EQ(alloc.recordFrameAllocating, 0);
+    if (alloc.recordFrameAllocating > 0) {
+        std::fprintf(stderr, "%llu of %llu checked calls allocated (%llu allocations, %llu bytes in record_frame)\n",
+                     alloc.recordFrameAllocating, alloc.recordFrameChecked, alloc.recordFrame.count,
+                     alloc.recordFrame.bytes);
+    }
+
+    telemetry_shutdown();
+    CHECK_EQ(telemetry_c3d_wait(30000), TELEMETRY_C3D_DONE);
+    TelemetryStatsPlain stats;
+    telemetry_get_stats(&stats);
+    CHECK_EQ(stats.framesRecorded, kFrames);
+    CHECK_EQ(stats.c3dFramesWritten, kFrames);
+    collector.stop();
+    return testResult();
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdio>
+#include <cstdlib>
+#include <ftw.h>
+#include <string>
+#include <unistd.h>
+
+// Minimal checks for the host tests registered with ctest. No test framework: the library is built with
+// -fno-exceptions, and every test is a small executable whose exit status is the result.
+//   CHECK(cond)      logs the failed condition with its location and marks the test failed
+//   CHECK_EQ(a, b)   same, printing both values (integers)
+//   testcheck::TempDir dir("name");  scratch directory, removed at the end of its scope if nothing failed
+//   return testResult();  at the end of main
+namespace testcheck {
+inline int& failures() {
+    static int n = 0;
+    return n;
+}
+
+// Fresh scratch directory under $TMPDIR (or /tmp), e.g. for TELEMETRIA_FILES_DIR.
+inline std::string makeTempDir(const char* name) {
+    const char* base = std::getenv("TMPDIR");
+    std::string path = std::string(base && *base ? base : "/tmp") + "/" + name + "_XXXXXX";
+    if (!mkdtemp(&path[0])) {
+        std::fprintf(stderr, "cannot create %s\n", path.c_str());
+        std::exit(1);
+    }
+    return path;
+}
+
+// Scratch directory (makeTempDir) removed with everything in it when the guard goes away, unless a check failed
+// by then: it is kept for debugging and its path is printed.
+class TempDir {
+public:
+    explicit TempDir(const char* name) : path_(makeTempDir(name)) {}
+    ~TempDir() {
+        if (failures() > 0) {
+            std::fprintf(stderr, "keeping %s\n", path_.c_str());
+            return;
+        }
+        nftw(path_.c_str(), [](const char* p, const struct stat*, int, struct FTW*) { return ::remove(p); }, 16,
+             FTW_DEPTH | FTW_PHYS);
+    }
+
+    TempDir(const TempDir&) = delete;
+    TempDir& operator=(const TempDir&) = delete;
+
+    const std::string& path() const { return path_; }
+
+private:
+    std::string path_;
+};
+} // namespace testcheck
+
+#define CHECK(cond)                                                                          \
+    do {                                                                                     \
+        if (!(cond)) {                                                                       \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond);    \
+            ++testcheck::failures();                                                         \
+        }                                                                                    \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                                       \
+    do {                                                                                     \
+        const long long va_ = (long long)(a), vb_ = (long long)(b);                          \
+        if (va_ != vb_) {                                                                    \
+            std::fprintf(stderr, "%s:%d: CHECK_EQ failed: %s == %s (%lld vs %lld)\n",        \
+                         __FILE__, __LINE__, #a, #b, va_, vb_);                              \
+            ++testcheck::failures();                                                         \
+        }                                                                                    \
+    } while (0)
+
+inline int testResult() {
+    if (testcheck::failures() == 0) return 0;
+    std::fprintf(stderr, "%d check(s) failed\n", testcheck::failures());
+    return 1;
+}
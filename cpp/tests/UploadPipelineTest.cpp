@@ -0,0 +1,171 @@
+// Asynchronous upload path of GestorTelemetria (sendBody / onUploadComplete) against FakeTransport:
+//   - at most maxInFlight_ (2) requests run at once, the worker waits for a free slot;
+//   - a failed upload goes to the disk spool and the drainer delivers it once the backend is back;
+//   - shutdown waits for the requests still in flight.
+
+#include "TestCheck.h"
+#include "FakeTransport.h"
+
+#include "AndroidUploader.h"
+#include "GestorTelemetria.h"
+#include "TelemetriaLog.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <thread>
+
+namespace {
+
+// Polls cond every 10 ms for at most timeoutMs. Returns its last value.
+bool waitFor(const std::function<bool()>& cond, int timeoutMs) {
+    const auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (!cond()) {
+        if (std::chrono::steady_clock::now() >= until) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+}
+
+TelemetryStatsPlain statsOf(const GestorTelemetria& gestor) {
+    TelemetryStatsPlain s;
+    std::memset(&s, 0, sizeof(s));
+    gestor.getStats(s);
+    return s;
+}
+
+void recordFrames(GestorTelemetria& gestor, int n) {
+    VRFrameDataPlain frame;
+    std::memset(&frame, 0, sizeof(frame));
+    for (int i = 0; i < n; ++i) {
+        frame.timestampSec = i / 90.0;
+        gestor.recordFrame(frame);
+    }
+}
+
+// Small chunks, one request per chunk (a 10-frame chunk is larger than 1 KB), no coalescing wait.
+// The spool goes to dir (TELEMETRIA_FILES_DIR).
+UploaderConfig makeConfig(const testcheck::TempDir& dir) {
+    setenv("TELEMETRIA_FILES_DIR", dir.path().c_str(), 1);
+    UploaderConfig cfg;
+    cfg.endpointUrl = "http://fake.invalid/";
+    cfg.apiKey = "test";
+    cfg.sessionId = "test";
+    cfg.deviceInfo = "host";
+    cfg.framesPerFile = 10;
+    cfg.coalesceWindowMs = 0;
+    cfg.maxRequestKB = 1;
+    return cfg;
+}
+
+void testInFlightLimit() {
+    const testcheck::TempDir dir("upload_inflight");
+    FakeTransport* fake = new FakeTransport();
+    fake->setHold(true);
+    AndroidUploader uploader;
+    uploader.setTransport(std::unique_ptr<UploadTransport>(fake));
+    const UploaderConfig cfg = makeConfig(dir);
+    CHECK(uploader.initialize(cfg));
+    GestorTelemetria gestor;
+    CHECK(gestor.initialize(cfg, &uploader));
+
+    // 5 chunks; the first two one by one, a burst would fill queue_ and go to the spool
+    recordFrames(gestor, 10);
+    CHECK(waitFor([&] { return fake->pending() == 1; }, 2000));
+    recordFrames(gestor, 10);
+    CHECK(waitFor([&] { return fake->pending() == 2; }, 2000));
+    recordFrames(gestor, 30);
+    // The worker is blocked on the third request: nothing else starts while both slots are taken
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    CHECK_EQ(fake->pending(), 2);
+    CHECK_EQ(statsOf(gestor).uploadsInFlight, 2);
+
+    // Each completion frees a slot for the next request
+    for (int i = 0; i < 5; ++i) {
+        CHECK(waitFor([&] { return fake->pending() > 0; }, 2000));
+        CHECK(fake->completeOne());
+    }
+    CHECK(waitFor([&] { return statsOf(gestor).chunksUploaded == 5; }, 2000));
+    CHECK_EQ(fake->maxPending(), 2);
+    CHECK_EQ(fake->asyncPosts(), 5);
+    CHECK_EQ(fake->framesDelivered(), 50);
+    const TelemetryStatsPlain s = statsOf(gestor);
+    CHECK_EQ(s.uploadsInFlight, 0);
+    CHECK_EQ(s.chunksFailed, 0);
+    gestor.shutdown();
+    uploader.shutdown();
+}
+
+void testFailureGoesToSpool() {
+    const testcheck::TempDir dir("upload_spool");
+    FakeTransport* fake = new FakeTransport();
+    fake->setStatus(503);
+    AndroidUploader uploader;
+    uploader.setTransport(std::unique_ptr<UploadTransport>(fake));
+    const UploaderConfig cfg = makeConfig(dir);
+    CHECK(uploader.initialize(cfg));
+    GestorTelemetria gestor;
+    CHECK(gestor.initialize(cfg, &uploader));
+
+    recordFrames(gestor, 10);
+    CHECK(waitFor([&] { return statsOf(gestor).chunksSpooled == 1; }, 2000));
+    TelemetryStatsPlain s = statsOf(gestor);
+    CHECK_EQ(s.chunksFailed, 1);
+    CHECK(s.spoolBytes > 0);
+    CHECK_EQ(fake->framesDelivered(), 0);
+
+    // Offline: the next chunk goes behind the spooled one instead of being sent
+    recordFrames(gestor, 10);
+    CHECK(waitFor([&] { return statsOf(gestor).chunksSpooled == 2; }, 2000));
+
+    // Backend back: the drainer sends both records in order after its backoff (2 s, 4 s after a failed retry)
+    fake->setStatus(201);
+    CHECK(waitFor([&] { return statsOf(gestor).spoolRecordsUploaded == 2; }, 15000));
+    s = statsOf(gestor);
+    CHECK_EQ(fake->framesDelivered(), 20);
+    CHECK_EQ(s.framesDropped, 0);
+    CHECK_EQ(s.uploadsInFlight, 0);
+    gestor.shutdown();
+    uploader.shutdown();
+}
+
+void testShutdownWaitsForInFlight() {
+    const testcheck::TempDir dir("upload_shutdown");
+    FakeTransport* fake = new FakeTransport();
+    fake->setHold(true);
+    AndroidUploader uploader;
+    uploader.setTransport(std::unique_ptr<UploadTransport>(fake));
+    const UploaderConfig cfg = makeConfig(dir);
+    CHECK(uploader.initialize(cfg));
+    GestorTelemetria gestor;
+    CHECK(gestor.initialize(cfg, &uploader));
+
+    recordFrames(gestor, 15); // one full chunk, shutdown flushes the other 5 frames
+    CHECK(waitFor([&] { return fake->pending() == 1; }, 2000));
+    std::atomic<bool> done{false};
+    std::thread closer([&] {
+        gestor.shutdown();
+        done = true;
+    });
+    CHECK(waitFor([&] { return fake->pending() == 2; }, 2000));
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    CHECK(!done);
+    fake->setHold(false);
+    CHECK(waitFor([&] { return done.load(); }, 2000));
+    closer.join();
+    CHECK_EQ(fake->framesDelivered(), 15);
+    CHECK_EQ(statsOf(gestor).chunksUploaded, 2);
+    uploader.shutdown();
+}
+
+} // namespace
+
+int main() {
+    TelemetriaLog::setLevel(kLogWarn);
+    testInFlightLimit();
+    testFailureGoesToSpool();
+    testShutdownWaitsForInFlight();
+    TelemetriaLog::flush();
+    return testResult();
+}
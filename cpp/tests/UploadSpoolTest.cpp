@@ -0,0 +1,84 @@
+// UploadSpool across restarts (close + open on the same directory, as a new app session would):
+//   - records left by one run are drained by the next, a partial drain resumes after the last popped record;
+//   - once the spool was emptied and its segments removed, records appended by later runs are all drained
+//     (the cursor of the old segments must not skip or drop them).
+
+#include "TestCheck.h"
+
+#include "TelemetriaLog.h"
+#include "UploadSpool.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string record(int run, int i) {
+    return "run" + std::to_string(run) + "-record" + std::to_string(i);
+}
+
+void appendRun(const std::string& dir, int run, int n) {
+    UploadSpool spool;
+    CHECK(spool.open(dir, 0));
+    for (int i = 0; i < n; ++i) CHECK(spool.append(record(run, i)));
+    spool.close();
+}
+
+// Pops at most max records (all with a negative max) and returns them in order.
+std::vector<std::string> drainRun(const std::string& dir, int max) {
+    UploadSpool spool;
+    CHECK(spool.open(dir, 0));
+    std::vector<std::string> out;
+    std::string payload;
+    while ((max < 0 || (int)out.size() < max) && spool.peek(payload)) {
+        out.push_back(payload);
+        spool.pop();
+    }
+    spool.close();
+    return out;
+}
+
+void testResumeAfterRestart() {
+    const testcheck::TempDir tempDir("spool_resume");
+    const std::string& dir = tempDir.path();
+    appendRun(dir, 1, 5);
+    std::vector<std::string> first = drainRun(dir, 2);
+    CHECK_EQ(first.size(), 2);
+    std::vector<std::string> rest = drainRun(dir, -1);
+    CHECK_EQ(rest.size(), 3);
+    for (size_t i = 0; i < rest.size(); ++i) CHECK(rest[i] == record(1, (int)i + 2));
+    CHECK(drainRun(dir, -1).empty());
+}
+
+// The sequence that used to lose data: drained, one empty run, then offline again.
+void testAppendAfterEmptied() {
+    const testcheck::TempDir tempDir("spool_reopen");
+    const std::string& dir = tempDir.path();
+    appendRun(dir, 1, 3);
+    CHECK_EQ(drainRun(dir, -1).size(), 3);
+    appendRun(dir, 3, 0);
+    appendRun(dir, 4, 3);
+    std::vector<std::string> got = drainRun(dir, -1);
+    CHECK_EQ(got.size(), 3);
+    for (size_t i = 0; i < got.size(); ++i) CHECK(got[i] == record(4, (int)i));
+
+    // And once more, with a partial drain in between
+    appendRun(dir, 6, 4);
+    CHECK_EQ(drainRun(dir, 1).size(), 1);
+    CHECK_EQ(drainRun(dir, -1).size(), 3);
+    appendRun(dir, 8, 0);
+    appendRun(dir, 9, 2);
+    got = drainRun(dir, -1);
+    CHECK_EQ(got.size(), 2);
+    for (size_t i = 0; i < got.size(); ++i) CHECK(got[i] == record(9, (int)i));
+}
+
+} // namespace
+
+int main() {
+    TelemetriaLog::setLevel(kLogWarn);
+    testResumeAfterRestart();
+    testAppendAfterEmptied();
+    TelemetriaLog::flush();
+    return testResult();
+}